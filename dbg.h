@@ -1,6 +1,7 @@
 #ifndef __dbg_h__
 #define __dbg_h__
 
+#include "nnb_log.h"
 #include <errno.h>
 #include <pthread.h>
 #include <stdio.h>
@@ -27,25 +28,28 @@ static inline char *nano_get_time()
 #ifdef NDEBUG
 #define debug(M, ...)
 #else
-#define debug(M, ...) \
-    fprintf(stderr, "[DEBUG] %s:%d: " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+#define debug(M, ...)                                                    \
+    nnb_log(NNB_LOG_DEBUG, "[DEBUG] %s:%d: " M "\n", __FILE__, __LINE__, \
+            ##__VA_ARGS__)
 #endif
 
 #define clean_errno() (errno == 0 ? "None" : strerror(errno))
 
-#define log_err(M, ...)                                                       \
-    fprintf(stderr, "[ERROR] (%s:%d: errno: %s) " M "\n", __FILE__, __LINE__, \
-            clean_errno(), ##__VA_ARGS__)
+// queued through nnb_log once it is started, see nnb_log.h
+#define log_err(M, ...)                                                  \
+    nnb_log(NNB_LOG_ERR, "[ERROR] (%s:%d: errno: %s) " M "\n", __FILE__, \
+            __LINE__, clean_errno(), ##__VA_ARGS__)
 
-#define log_warn(M, ...)                                                     \
-    fprintf(stderr, "[WARN] (%s:%d: errno: %s) " M "\n", __FILE__, __LINE__, \
-            clean_errno(), ##__VA_ARGS__)
+#define log_warn(M, ...)                                                 \
+    nnb_log(NNB_LOG_WARN, "[WARN] (%s:%d: errno: %s) " M "\n", __FILE__, \
+            __LINE__, clean_errno(), ##__VA_ARGS__)
 // #define NOLOG
 #ifdef NOLOG
 #define log_info(M, ...)
 #else
-#define log_info(M, ...) \
-    fprintf(stderr, "[INFO] (%s:%d) " M "\n", __FILE__, __LINE__, ##__VA_ARGS__)
+#define log_info(M, ...)                                                \
+    nnb_log(NNB_LOG_INFO, "[INFO] (%s:%d) " M "\n", __FILE__, __LINE__, \
+            ##__VA_ARGS__)
 
 #endif
 
@@ -1,10 +1,37 @@
 #include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_blast.h"
+#include "nnb_churn.h"
+#include "nnb_crc.h"
+#include "nnb_cred.h"
+#include "nnb_frame.h"
+#include "nnb_hist.h"
+#include "nnb_id.h"
+#include "nnb_log.h"
+#include "nnb_lwt.h"
+#include "nnb_metrics.h"
 #include "nnb_opt.h"
+#include "nnb_payload.h"
+#include "nnb_pool.h"
+#include "nnb_proc.h"
+#include "nnb_proxy.h"
+#include "nnb_rawsub.h"
+#include "nnb_resub.h"
+#include "nnb_retain.h"
+#include "nnb_search.h"
+#include "nnb_session.h"
+#include "nnb_share.h"
+#include "nnb_slab.h"
+#include "nnb_topic.h"
+#include "nnb_transport.h"
+#include "nnb_trace.h"
+#include "nnb_util.h"
 #include <limits.h>
 #include <nng/nng.h>
 #include <nng/supplemental/tls/tls.h>
 #include <nng/supplemental/util/options.h>
 #include <nng/supplemental/util/platform.h>
+#include <signal.h>
 #include <stdarg.h>
 #include <stdatomic.h>
 
@@ -13,13 +40,41 @@
 #endif
 
 static atomic_int acnt          = 0;
-static atomic_int topic_cnt     = 0;
+static atomic_int disc_cnt      = 0;
+static atomic_int live_cnt      = 0; // acnt - disc_cnt, for the gauge
 static atomic_int recv_cnt      = 0;
 static atomic_int last_recv_cnt = 0;
-static atomic_int send_cnt      = 0;
+static atomic_int send_cnt      = 0; // started, one ahead per client
+static atomic_int sent_cnt      = 0; // completed
 static atomic_int send_limit    = 0;
 static atomic_int last_send_cnt = 0;
-static atomic_int index_cnt     = 0;
+
+static atomic_ullong send_bytes      = 0;
+static atomic_ullong last_send_bytes = 0;
+static nnb_hist      size_hist; // payload sizes actually sent
+static uint64_t      start_us;
+
+static nnb_tree   pub_tree;
+static nnb_frame  pub_frame; // layout of every publish template
+static nnb_tree   sub_tree;
+static nnb_hist   suback_hist; // SUBSCRIBE to SUBACK, usec
+static atomic_int sub_client_cnt  = 0;
+static atomic_int suback_fail_cnt = 0;
+static atomic_int filter_cnt[3]   = { 0 }; // by nnb_filter_kind
+
+static nnb_hist   recv_lat_hist; // stamped publish to delivery, usec
+static atomic_int pub_client_cnt = 0;
+
+static int conn_client_cnt = 0;
+
+static nnb_ids  ids;               // <prefix><n> of this process's clients
+static nnb_cred cred;              // --cred-file rows, count 0 if none
+static nnb_hist connack_hist;      // dial to first CONNACK, usec
+static nnb_hist connack_fail_hist; // same, refused or dropped first
+static nnb_hist reconnect_hist;    // --reconnect drop to CONNACK, usec
+static bool     conn_reconnect;    // conn --reconnect
+
+static volatile sig_atomic_t stopped = 0;
 
 typedef enum { INIT, RECV, WAIT, SEND } nnb_state_flag_t;
 
@@ -29,14 +84,38 @@ typedef enum {
 	PUB,
 } nnb_opt_flag_t;
 
+// Client state lives in two slabs so a million idle clients cost a few
+// contiguous records each rather than scattered allocations. A client
+// holds the cold fields touched on connect and subscribe; its works hold
+// what every callback touches.
+struct client {
+	nng_socket sock;
+	int        sub_left; // filters still to subscribe
+	uint64_t   sub_seed; // filter generator state
+	uint64_t   sub_ts;   // SUBSCRIBE submit time, usec
+	uint64_t   dial_us;  // dial time until the first CONNACK, usec
+	uint64_t   drop_us;  // --reconnect drop until the next CONNACK, usec
+	bool       dropped;  // --reconnect already dropped this client
+};
+
 struct work {
 	nng_aio *        aio;
-	nng_msg *        msg;
-	nng_time         last_send_ts; // last logical time stamp we send
+	nng_msg *        msg; // publish template or pending SUBSCRIBE
+	struct client *  client;
 	nng_ctx          ctx;
 	nnb_state_flag_t state;
+	int              span;   // sampled nnb_trace span, -1 if none
+	uint32_t         pub_id; // stamp: publishing client index
+	uint64_t         seed;   // payload size sampler state
+	uint64_t         seq;    // stamp: next sequence number
+	nng_time         last_send_ts; // last logical time stamp we send
 };
 
+#define NNB_SLAB_CHUNK 4096
+
+static nnb_slab client_slab;
+static nnb_slab work_slab;
+
 static nnb_opt_flag_t opt_flag = CONN;
 static nnb_sub_opt *  sub_opt  = NULL;
 static nnb_pub_opt *  pub_opt  = NULL;
@@ -91,41 +170,54 @@ out:
 	return (rv);
 }
 
-char *
-nnb_opt_get_topic(char *opt_topic, char *opt_username, nng_msg *msg)
-{
-	char *topic = NULL;
-	if ((topic = strstr(opt_topic, "\%c")) != NULL) {
-		int         len = topic - opt_topic + 1;
-		const char *client_id =
-		    nng_mqtt_msg_get_connect_client_id(msg);
-		size_t size = len + strlen(client_id) + 1;
-		topic       = (char *) nng_alloc(sizeof(char) * size);
-		char *t     = (char *) nng_alloc(sizeof(char) * len);
-		snprintf(t, len, "%s", opt_topic);
-		snprintf(topic, size, "%s%s", t, client_id);
-		nng_free(t, len);
-	} else if ((topic = strstr(opt_topic, "\%u")) != NULL) {
-		int    len      = topic - opt_topic + 1;
-		char * username = opt_username ? opt_username : "undefined";
-		size_t size     = len + strlen(username) + 1;
-		topic           = (char *) nng_alloc(sizeof(char) * size);
-		char *t         = (char *) nng_alloc(sizeof(char) * len);
-		snprintf(t, len, "%s", opt_topic);
-		snprintf(topic, size, "%s%s", t, username);
-		nng_free(t, len);
-	} else if ((topic = strstr(opt_topic, "\%i")) != NULL) {
-		int    len  = topic - opt_topic + 1;
-		size_t size = len + 5;
-		topic       = (char *) nng_alloc(sizeof(char) * size);
-		char *t     = (char *) nng_alloc(sizeof(char) * len);
-		snprintf(t, len, "%s", opt_topic);
-		snprintf(topic, size, "%s%d", t, topic_cnt++);
-		nng_free(t, len);
-	} else {
-		return opt_topic;
+// Per-client filter generator seed (splitmix64 of the client index), so
+// the fan-out report can regenerate every client's filters afterwards.
+static uint64_t
+sub_filter_seed(int client)
+{
+	uint64_t z = (uint64_t) client + 0x9E3779B97F4A7C15ULL;
+	z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z          = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return ((z ^ (z >> 31)) | 1);
+}
+
+// Packs the next batch of generated filters into one SUBSCRIBE.
+static nng_msg *
+sub_filters_msg(struct client *c, const char *base)
+{
+	nng_msg *           msg;
+	nng_mqtt_topic_qos *topic_qos;
+	nnb_filter          f;
+	char *              bufs;
+	int                 n = sub_opt->sub_batch;
+
+	if (n <= 0 || n > c->sub_left) {
+		n = c->sub_left;
+	}
+	topic_qos = nng_alloc(sizeof(nng_mqtt_topic_qos) * n);
+	bufs      = nng_alloc(NNB_TOPIC_LEN * n);
+	if (topic_qos == NULL || bufs == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		exit(EXIT_FAILURE);
+	}
+	for (int i = 0; i < n; i++) {
+		char *buf = bufs + i * NNB_TOPIC_LEN;
+		nnb_filter_gen(&sub_tree, sub_opt->plus_ratio,
+		    sub_opt->hash_ratio, &c->sub_seed, &f);
+		nnb_filter_render(&sub_tree, &f, base, buf, NNB_TOPIC_LEN);
+		++filter_cnt[f.kind];
+		topic_qos[i].qos          = sub_opt->qos;
+		topic_qos[i].topic.buf    = (uint8_t *) buf;
+		topic_qos[i].topic.length = strlen(buf);
 	}
-	return topic;
+	c->sub_left -= n;
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, n);
+	nng_free(topic_qos, sizeof(nng_mqtt_topic_qos) * n);
+	nng_free(bufs, NNB_TOPIC_LEN * n);
+	return (msg);
 }
 
 void
@@ -133,26 +225,20 @@ sub_cb(void *arg)
 {
 	struct work *work = arg;
 	nng_msg *    msg;
+	uint8_t *    codes;
+	uint32_t     count;
 	int          rv;
 
+	nnb_pool_callback();
 	switch (work->state) {
 	case INIT:
-		// subscribe to topics
-		if (index_cnt == 0) {
-			nng_mqtt_msg_alloc(&msg, 0);
-			nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
-			char *topic = nnb_opt_get_topic(
-			    sub_opt->topic, sub_opt->username, work->msg);
-			// log_info("topic: %s", topic);
-			nng_mqtt_topic_qos topic_qos[] = {
-				{ .qos     = sub_opt->qos,
-				    .topic = { .buf = (uint8_t *) topic,
-				        .length     = strlen(topic) } },
-			};
-
-			nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+		// the first work of a client carries its SUBSCRIBE, the
+		// others only receive
+		if ((msg = work->msg) != NULL) {
+			work->msg = NULL;
 			nng_aio_set_msg(work->aio, msg);
-			work->state = SEND;
+			work->state          = SEND;
+			work->client->sub_ts = nnb_clock_us();
 			nng_ctx_send(work->ctx, work->aio);
 		} else {
 			work->state = RECV;
@@ -161,11 +247,34 @@ sub_cb(void *arg)
 		break;
 
 	case SEND:
-		// we are done with subscribing
+		// the send aio completes once the SUBACK has arrived
 		if ((rv = nng_aio_result(work->aio)) != 0) {
-			nng_msg_free(work->msg);
 			nng_fatal("nng_send_aio", rv);
 		}
+		nnb_hist_add(
+		    &suback_hist, nnb_clock_us() - work->client->sub_ts);
+		if ((msg = nng_aio_get_msg(work->aio)) != NULL) {
+			if (nng_mqtt_msg_get_packet_type(msg) ==
+			    NNG_MQTT_SUBACK) {
+				codes = nng_mqtt_msg_get_suback_return_codes(
+				    msg, &count);
+				for (uint32_t i = 0; i < count; i++) {
+					if (codes[i] >= 0x80) {
+						++suback_fail_cnt;
+					}
+				}
+			}
+			nng_aio_set_msg(work->aio, NULL);
+			nng_msg_free(msg);
+		}
+		if (work->client->sub_left > 0) {
+			// keep the SUBSCRIBE pipeline one packet deep
+			nng_aio_set_msg(work->aio,
+			    sub_filters_msg(work->client, sub_opt->topic));
+			work->client->sub_ts = nnb_clock_us();
+			nng_ctx_send(work->ctx, work->aio);
+			break;
+		}
 		work->state = RECV;
 		nng_ctx_recv(work->ctx, work->aio);
 		break;
@@ -176,50 +285,110 @@ sub_cb(void *arg)
 			nng_fatal("nng_recv_aio", rv);
 		}
 		++recv_cnt;
-		msg         = nng_aio_get_msg(work->aio);
+		msg = nng_aio_get_msg(work->aio);
+		if (msg != NULL) {
+			nnb_stamp st;
+			uint32_t  len;
+			uint8_t * payload =
+			    nng_mqtt_msg_get_publish_payload(msg, &len);
+			bool stamped = nnb_stamp_read(payload, len, &st);
+			if (stamped) {
+				uint64_t now = nnb_realtime_us();
+				nnb_hist_add(&recv_lat_hist, now - st.ts_us);
+				if (nnb_trace_sampled(st.seq)) {
+					nnb_trace_deliver(
+					    st.pub_id, st.seq, st.ts_us, now);
+				}
+			}
+			if (sub_opt->crc) {
+				uint32_t    tlen;
+				const char *topic =
+				    nng_mqtt_msg_get_publish_topic(msg, &tlen);
+				int pub_id = stamped ? (int) st.pub_id : -1;
+				nnb_crc_count(nnb_crc_check(payload, len),
+				    topic, tlen, pub_id);
+			}
+			nng_aio_set_msg(work->aio, NULL);
+			nng_msg_free(msg);
+		}
 		work->state = RECV;
 		nng_ctx_recv(work->ctx, work->aio);
 		break;
 	}
 }
 
+// Queue the next publish: a copy of the client's frame template cut to
+// the drawn payload size, with a random tree leaf and the stamp written
+// over it in place. Nothing is re-encoded.
+static void
+pub_send(struct work *work)
+{
+	nng_msg *msg;
+	uint64_t seq  = work->seq++;
+	int      span = -1;
+	uint32_t size = nnb_payload_size(&work->seed);
+	int      rv;
+
+	if (nnb_trace_sampled(seq)) {
+		span = nnb_trace_pub(work->pub_id, seq);
+		nnb_trace_mark_set(span, MARK_START);
+	}
+	if ((rv = nnb_frame_copy(&pub_frame, work->msg, size, &msg)) != 0) {
+		nng_fatal("nng_msg_dup", rv);
+		return;
+	}
+	if (pub_tree.depth > 0) {
+		nnb_tree_leaf(&pub_tree,
+		    nnb_rand(&work->seed) % pub_tree.leaves,
+		    nnb_frame_leaf(&pub_frame, msg));
+	}
+	nnb_trace_mark_set(span, MARK_RENDERED);
+	if (pub_opt->stamp &&
+	    size >= NNB_STAMP_LEN + (pub_opt->crc ? NNB_CRC_LEN : 0)) {
+		nnb_stamp st = { .pub_id = work->pub_id,
+			.seq             = seq,
+			.ts_us           = nnb_realtime_us() };
+		nnb_stamp_write(nnb_frame_payload(msg, size), &st);
+	}
+	if (pub_opt->crc) {
+		nnb_crc_seal(nnb_frame_payload(msg, size), size);
+	}
+	nnb_hist_add(&size_hist, size);
+	send_bytes += size;
+
+	// the completion mark is set by pub_cb, possibly before
+	// nng_ctx_send returns, so the span index is handed over first
+	work->span = span;
+	nnb_trace_mark_set(span, MARK_STAMPED);
+	nng_aio_set_msg(work->aio, msg);
+	nng_ctx_send(work->ctx, work->aio);
+	nnb_trace_mark_set(span, MARK_SUBMITTED);
+}
+
 void
 pub_cb(void *arg)
 {
 	struct work *work = arg;
-	nng_msg *    msg;
 	int          rv;
 
+	nnb_pool_callback();
 	switch (work->state) {
 	case INIT:
 
 		if (++send_cnt > send_limit) {
 			break;
 		}
-		// nng_mqtt_msg_alloc(&work->msg, 0);
-		nng_mqtt_msg_set_packet_type(work->msg, NNG_MQTT_PUBLISH);
-		if (work->msg == NULL) { }
-		char *topic = nnb_opt_get_topic(
-		    pub_opt->topic, pub_opt->username, work->msg);
-		nng_mqtt_msg_set_publish_topic(work->msg, topic);
-		nng_mqtt_msg_set_publish_qos(work->msg, pub_opt->qos);
-		nng_mqtt_msg_set_publish_retain(work->msg, pub_opt->retain);
-		char *payload =
-		    (char *) nng_alloc(sizeof(char) * pub_opt->size);
-		memset(payload, 'A', pub_opt->size);
-		nng_mqtt_msg_set_publish_payload(
-		    work->msg, (uint8_t *) payload, pub_opt->size);
-		nng_mqtt_msg_encode(work->msg);
-
-		nng_msg_dup(&msg, work->msg);
-		nng_aio_set_msg(work->aio, msg);
-		msg                = NULL;
 		work->state        = WAIT;
 		work->last_send_ts = nng_clock();
-		nng_ctx_send(work->ctx, work->aio);
+		pub_send(work);
 		break;
 
 	case WAIT:
+		++sent_cnt;
+		if (work->span >= 0) {
+			nnb_trace_mark_set(work->span, MARK_COMPLETED);
+			work->span = -1;
+		}
 		work->state = SEND;
 		// NOTE: nng_sleep_aio will sleep for more than you wanted
 		if (pub_opt->interval_of_msg >= 1) {
@@ -244,208 +413,468 @@ pub_cb(void *arg)
 	case SEND:
 		// send packets
 		if ((rv = nng_aio_result(work->aio)) != 0) {
-			nng_msg_free(work->msg);
+			// the copy made by pub_send, never the template
+			nng_msg *msg = nng_aio_get_msg(work->aio);
+			if (msg != NULL) {
+				nng_aio_set_msg(work->aio, NULL);
+				nng_msg_free(msg);
+			}
 			nng_fatal("nng_send_aio", rv);
 		}
 
 		if (++send_cnt > send_limit) {
 			break;
 		}
-		nng_msg_dup(&msg, work->msg);
-		nng_aio_set_msg(work->aio, msg);
-		msg         = NULL;
 		work->state = WAIT;
-		nng_ctx_send(work->ctx, work->aio);
+		pub_send(work);
 		break;
 	}
 }
 
+static struct client *
+alloc_client(const char *host, int port, tls_opt *tls)
+{
+	struct client *c;
+	int            rv;
+
+	if ((c = nnb_slab_alloc(&client_slab)) == NULL) {
+		nng_fatal("nnb_slab_alloc", NNG_ENOMEM);
+		exit(EXIT_FAILURE);
+	}
+	if ((rv = nnb_client_open(&c->sock, host, port, tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+	}
+	return (c);
+}
+
 struct work *
-alloc_work(nng_socket sock, void cb(void *))
+alloc_work(struct client *c, void cb(void *))
 {
 	struct work *w;
 	int          rv;
 
-	if ((w = nng_alloc(sizeof(*w))) == NULL) {
-		nng_fatal("nng_alloc", NNG_ENOMEM);
+	if ((w = nnb_slab_alloc(&work_slab)) == NULL) {
+		nng_fatal("nnb_slab_alloc", NNG_ENOMEM);
+		exit(EXIT_FAILURE);
 	}
 	if ((rv = nng_aio_alloc(&w->aio, cb, w)) != 0) {
 		nng_fatal("nng_aio_alloc", rv);
 	}
-	if ((rv = nng_ctx_open(&w->ctx, sock)) != 0) {
+	if ((rv = nng_ctx_open(&w->ctx, c->sock)) != 0) {
 		nng_fatal("nng_ctx_open", rv);
 	}
-	w->state = INIT;
+	w->client = c;
+	w->state  = INIT;
+	w->seed  = ((uint64_t) nng_random() << 32) | nng_random() | 1;
+	w->seq   = 0;
+	w->span  = -1;
 	return (w);
 }
 
-// Connack message callback function
+// Connack message callback function. arg is the client, whose first
+// CONNACK is timed by its reason code.
 static void
 connect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
 {
-	switch (opt_flag) {
-	case SUB:;
-		// nnb_sub_opt *opt = (nnb_sub_opt *) arg;
-		// if (arg != NULL) {
-		printf("connected: %d. Topics: [\"%s\"]\n", ++acnt,
-		    sub_opt->topic);
-		// }
-
-		// // Connected succeed
-		// nng_msg *msg;
-		// nng_mqtt_msg_alloc(&msg, 0);
-		// nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
-		// nng_mqtt_msg_set_subscribe_topics(msg, topic_qos,
-		// topic_qos_count);
-
-		// // Send subscribe message
-		// nng_sendmsg(sock, msg, NNG_FLAG_NONBLOCK);
-
-		// printf("connected: %d.\n", ++acnt);
-		break;
-	case PUB:
-		printf("connected: %d.\n", ++acnt);
-		break;
-	case CONN:
-		printf("connected: %d.\n", ++acnt);
-		break;
+	struct client *c      = arg;
+	int            reason = 0;
+
+	nnb_pool_callback();
+	nng_pipe_get_int(p, NNG_OPT_MQTT_CONNECT_REASON, &reason);
+	if (c != NULL && c->dial_us != 0) {
+		nnb_hist_add(reason == 0 ? &connack_hist : &connack_fail_hist,
+		    nnb_clock_us() - c->dial_us);
+		c->dial_us = 0;
+	}
+	if (reason != 0) {
+		log_warn("connect refused, reason code %d", reason);
+		return;
+	}
+	if (c != NULL && c->drop_us != 0) {
+		nnb_hist_add(&reconnect_hist, nnb_clock_us() - c->drop_us);
+		c->drop_us = 0;
+		return;
+	}
+	if (c != NULL && conn_reconnect && !c->dropped) {
+		// the dialer redials at once, over a resumed QUIC session
+		// with --quic-0rtt
+		c->dropped = true;
+		c->drop_us = nnb_clock_us();
+		if (nng_pipe_close(p) != 0) {
+			// QUIC has no pipe to close, have the broker close it
+			nng_msg *msg;
+			nng_mqtt_msg_alloc(&msg, 0);
+			nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_DISCONNECT);
+			nng_sendmsg(c->sock, msg, NNG_FLAG_NONBLOCK);
+		}
 	}
+	// counted, and reported once a second by the nnb_log thread
+	++acnt;
+	++live_cnt;
+	nnb_log_event(NNB_EV_CONNECTED);
 }
 
 static void
 disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
 {
-	printf("disconnected!\n");
+	struct client *c = arg;
+
+	nnb_pool_callback();
+	// closed before any CONNACK, as some brokers do on a bad login
+	if (c != NULL && c->dial_us != 0) {
+		nnb_hist_add(&connack_fail_hist, nnb_clock_us() - c->dial_us);
+		c->dial_us = 0;
+	}
+	if (c != NULL && c->drop_us != 0) {
+		return; // our own --reconnect drop
+	}
+	++disc_cnt;
+	--live_cnt;
+	nnb_log_event(NNB_EV_DISCONNECTED);
+}
+
+nng_msg *
+nnb_connect_msg(
+    int keepalive, bool clean, const char *username, const char *password)
+{
+	nng_msg *msg;
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_CONNECT);
+	nng_mqtt_msg_set_connect_keep_alive(msg, keepalive);
+	nng_mqtt_msg_set_connect_clean_session(msg, clean);
+
+	if (username) {
+		nng_mqtt_msg_set_connect_user_name(msg, username);
+	}
+	if (password) {
+		nng_mqtt_msg_set_connect_password(msg, password);
+	}
+	return (msg);
+}
+
+void
+nnb_connect_will(nng_msg *msg, will_opt *will, int index)
+{
+	char        topic[NNB_TOPIC_LEN];
+	const char *p;
+
+	if (will->topic == NULL) {
+		return;
+	}
+	if ((p = strstr(will->topic, "%i")) != NULL) {
+		snprintf(topic, sizeof(topic), "%.*s%d%s",
+		    (int) (p - will->topic), will->topic, index, p + 2);
+	} else {
+		snprintf(topic, sizeof(topic), "%s", will->topic);
+	}
+	nng_mqtt_msg_set_connect_will_topic(msg, topic);
+	nng_mqtt_msg_set_connect_will_msg(
+	    msg, (uint8_t *) will->payload, strlen(will->payload));
+	nng_mqtt_msg_set_connect_will_qos(msg, will->qos);
+	nng_mqtt_msg_set_connect_will_retain(msg, will->retain);
 }
 
 int
-nnb_connect(nnb_conn_opt *opt)
+nnb_dial(nng_socket sock, const char *host, int port, tls_opt *tls,
+    nng_msg *connmsg)
 {
-	if (opt == NULL) {
-		fprintf(stderr, "Connection parameters init failed!\n");
+	return (nnb_dial_cb(sock, host, port, tls, connmsg, connect_cb,
+	    disconnect_cb, NULL));
+}
+
+int
+nnb_client_open(nng_socket *sock, const char *host, int port, tls_opt *tls)
+{
+#ifdef SUPP_QUIC
+	char url[255];
+	int  rv;
+
+	if (tls->quic) {
+		// the QUIC client dials as it opens, and redials on loss
+		nnb_dial_url(url, sizeof(url), host, port, tls);
+		if ((rv = nng_mqtt_quic_client_open(sock, url)) != 0) {
+			return (rv);
+		}
+		if (tls->quic_0rtt) {
+			nng_socket_set_bool(
+			    *sock, NNG_OPT_QUIC_ENABLE_0RTT, true);
+		}
+		return (0);
+	}
+#endif
+	return (nng_mqtt_client_open(sock));
+}
+
+#ifdef SUPP_QUIC
+// The QUIC client reports CONNACK and connection loss through its own
+// callbacks rather than pipe events; these forward them to the pipe
+// callbacks the modes install, with no pipe. A refused CONNACK goes to
+// on_disconnect, as a broker closing the pipe would.
+typedef struct {
+	nng_pipe_cb on_connect;
+	nng_pipe_cb on_disconnect;
+	void *      arg;
+} quic_cb_arg;
+
+static int
+quic_connect_cb(void *rmsg, void *arg)
+{
+	quic_cb_arg *q = arg;
+	nng_pipe     p = NNG_PIPE_INITIALIZER;
+
+	if (rmsg != NULL && nng_mqtt_msg_get_connack_return_code(rmsg) != 0) {
+		q->on_disconnect(p, NNG_PIPE_EV_REM_POST, q->arg);
+	} else {
+		q->on_connect(p, NNG_PIPE_EV_ADD_POST, q->arg);
+	}
+	return (0);
+}
+
+static int
+quic_disconnect_cb(void *rmsg, void *arg)
+{
+	quic_cb_arg *q = arg;
+	nng_pipe     p = NNG_PIPE_INITIALIZER;
+
+	q->on_disconnect(p, NNG_PIPE_EV_REM_POST, q->arg);
+	return (0);
+}
+
+// Sends CONNECT on a socket from nnb_client_open, which is already
+// dialing. The callback state lives as long as the process.
+static int
+quic_dial(nng_socket sock, nng_msg *connmsg, nng_pipe_cb on_connect,
+    nng_pipe_cb on_disconnect, void *arg)
+{
+	quic_cb_arg *q;
+
+	if ((q = nng_alloc(sizeof(*q))) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	q->on_connect    = on_connect;
+	q->on_disconnect = on_disconnect;
+	q->arg           = arg;
+	nng_mqtt_quic_set_connect_cb(&sock, quic_connect_cb, q);
+	nng_mqtt_quic_set_disconnect_cb(&sock, quic_disconnect_cb, q);
+	return (nng_sendmsg(sock, connmsg, NNG_FLAG_ALLOC));
+}
+#endif
+
+void
+nnb_dial_url(char *url, size_t sz, const char *host, int port, tls_opt *tls)
+{
+	if (tls->quic) {
+		snprintf(url, sz, "mqtt-quic://%s:%d", host, port);
+	} else if (tls->ws) {
+		snprintf(url, sz, "%s://%s:%d%s", tls->enable ? "wss" : "ws",
+		    host, port, tls->ws_path ? tls->ws_path : "/mqtt");
+	} else if (tls->enable) {
+		snprintf(url, sz, "tls+mqtt-tcp://%s:%d", host, port);
+	} else {
+		snprintf(url, sz, "mqtt-tcp://%s:%d", host, port);
 	}
+}
 
+int
+nnb_dial_cb(nng_socket sock, const char *host, int port, tls_opt *tls,
+    nng_msg *connmsg, nng_pipe_cb on_connect, nng_pipe_cb on_disconnect,
+    void *arg)
+{
 	char       url[255];
-	nng_socket sock;
 	nng_dialer dialer;
-	int        i;
 	int        rv;
 
-	if (opt->tls.enable) {
-		sprintf(url, "tls+mqtt-tcp://%s:%d", opt->host, opt->port);
-	} else {
-		sprintf(url, "mqtt-tcp://%s:%d", opt->host, opt->port);
-	}
-	if ((rv = nng_mqtt_client_open(&sock)) != 0) {
-		nng_fatal("nng_socket", rv);
+#ifdef SUPP_QUIC
+	if (tls->quic) {
+		return (quic_dial(
+		    sock, connmsg, on_connect, on_disconnect, arg));
 	}
+#endif
+	nnb_dial_url(url, sizeof(url), host, port, tls);
 
 	if ((rv = nng_dialer_create(&dialer, sock, url)) != 0) {
 		nng_fatal("nng_dialer_create", rv);
+		return (rv);
 	}
 
-	if (opt->tls.enable) {
-		if ((rv = init_dialer_tls(dialer, opt->tls.cacert,
-		              opt->tls.cert, opt->tls.key,
-		              opt->tls.keypass) != 0)) {
+	if (tls->enable) {
+		if ((rv = init_dialer_tls(dialer, tls->cacert, tls->cert,
+		         tls->key, tls->keypass)) != 0) {
 			nng_fatal("init_dialer_tls", rv);
+			return (rv);
 		}
 	}
 
-	// Mqtt connect message
-	nng_msg *msg;
-	nng_mqtt_msg_alloc(&msg, 0);
-	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_CONNECT);
-	nng_mqtt_msg_set_connect_keep_alive(msg, opt->keepalive);
-	nng_mqtt_msg_set_connect_clean_session(msg, opt->clean);
+	nng_mqtt_set_connect_cb(sock, on_connect, arg);
+	nng_mqtt_set_disconnect_cb(sock, on_disconnect, arg);
 
-	nng_mqtt_set_connect_cb(sock, connect_cb, &sock);
-	nng_mqtt_set_disconnect_cb(sock, disconnect_cb, NULL);
+	nng_dialer_set_ptr(dialer, NNG_OPT_MQTT_CONNMSG, connmsg);
+	return (nng_dialer_start(dialer, NNG_FLAG_NONBLOCK));
+}
+
+// CONNECT for client n with its id from the arena, or its own
+// --cred-file row when one is loaded, else the shared username and
+// password.
+static nng_msg *
+client_connect_msg(int n, int keepalive, bool clean, const char *username,
+    const char *password)
+{
+	nng_msg *   msg;
+	const char *id = nnb_ids_get(&ids, n);
+	char        row[NNB_CRED_ROW];
 
-	if (opt->username) {
-		nng_mqtt_msg_set_connect_user_name(msg, opt->username);
+	if (cred.count > 0) {
+		nnb_cred_row(&cred, n, row, &id, &username, &password);
 	}
-	if (opt->password) {
-		nng_mqtt_msg_set_connect_password(msg, opt->password);
+	msg = nnb_connect_msg(keepalive, clean, username, password);
+	if (id != NULL) {
+		nng_mqtt_msg_set_connect_client_id(msg, id);
 	}
+	return (msg);
+}
 
-	nng_dialer_set_ptr(dialer, NNG_OPT_MQTT_CONNMSG, msg);
-	nng_dialer_start(dialer, NNG_FLAG_NONBLOCK);
+// Dials a bench client, timing its first CONNACK.
+static int
+client_dial(struct client *c, const char *host, int port, tls_opt *tls,
+    nng_msg *connmsg)
+{
+	if (conn_reconnect) {
+		// redial right after the drop, not after the backoff
+		nng_socket_set_ms(c->sock, NNG_OPT_RECONNMINT, 1);
+	}
+	c->dial_us = nnb_clock_us();
+	return (nnb_dial_cb(
+	    c->sock, host, port, tls, connmsg, connect_cb, disconnect_cb, c));
 }
 
 int
-nnb_subscribe(nnb_sub_opt *opt)
+nnb_connect(nnb_conn_opt *opt)
 {
 	if (opt == NULL) {
 		fprintf(stderr, "Connection parameters init failed!\n");
 	}
 
-	char         url[255];
-	nng_socket   sock;
-	nng_dialer   dialer;
-	struct work *works[PARALLEL];
-	int          i;
-	int          rv;
+	struct client *c = alloc_client(opt->host, opt->port, &opt->tls);
+	nng_msg *      msg;
+	int            n = opt->startnumber + conn_client_cnt++;
 
-	if (opt->tls.enable) {
-		sprintf(url, "tls+mqtt-tcp://%s:%d", opt->host, opt->port);
-	} else {
-		sprintf(url, "mqtt-tcp://%s:%d", opt->host, opt->port);
-	}
-	if ((rv = nng_mqtt_client_open(&sock)) != 0) {
-		nng_fatal("nng_socket", rv);
-	}
+	// Mqtt connect message
+	msg = client_connect_msg(n, opt->keepalive, opt->clean,
+	    opt->username, opt->password);
+	nnb_connect_will(msg, &opt->will, n);
 
-	for (i = 0; i < PARALLEL; i++) {
-		works[i] = alloc_work(sock, sub_cb);
-	}
+	return (client_dial(c, opt->host, opt->port, &opt->tls, msg));
+}
 
-	if ((rv = nng_dialer_create(&dialer, sock, url)) != 0) {
-		nng_fatal("nng_dialer_create", rv);
+static nng_msg *
+sub_topic_msg(const char *topic)
+{
+	nng_msg *          msg;
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = sub_opt->qos,
+		    .topic = { .buf = (uint8_t *) topic,
+		        .length     = strlen(topic) } },
+	};
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	return (msg);
+}
+
+int
+nnb_subscribe(nnb_sub_opt *opt)
+{
+	if (opt == NULL) {
+		fprintf(stderr, "Connection parameters init failed!\n");
 	}
 
-	if (opt->tls.enable) {
-		if ((rv = init_dialer_tls(dialer, opt->tls.cacert,
-		              opt->tls.cert, opt->tls.key,
-		              opt->tls.keypass) != 0)) {
-			nng_fatal("init_dialer_tls", rv);
-		}
+	struct client *c;
+	struct work *  works[PARALLEL];
+	nng_msg *      msg;
+	char *         topic;
+	int            i;
+	int            n;
+
+	c = alloc_client(opt->host, opt->port, &opt->tls);
+	for (i = 0; i < PARALLEL; i++) {
+		works[i] = alloc_work(c, sub_cb);
 	}
 
 	opt_flag = SUB;
 	sub_opt  = opt;
 
 	// Mqtt connect message
-	nng_msg *msg;
-	nng_mqtt_msg_alloc(&msg, 0);
-	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_CONNECT);
-	nng_mqtt_msg_set_connect_keep_alive(msg, opt->keepalive);
-	nng_mqtt_msg_set_connect_clean_session(msg, opt->clean);
-
-	nng_mqtt_set_connect_cb(sock, connect_cb, &sock);
-	nng_mqtt_set_disconnect_cb(sock, disconnect_cb, NULL);
-
-	if (opt->username) {
-		nng_mqtt_msg_set_connect_user_name(msg, opt->username);
-	}
-
-	if (opt->password) {
-		nng_mqtt_msg_set_connect_password(msg, opt->password);
+	n   = sub_client_cnt++;
+	msg = client_connect_msg(opt->startnumber + n, opt->keepalive,
+	    opt->clean, opt->username, opt->password);
+
+	c->sub_seed = sub_filter_seed(n);
+	if (opt->filters > 0) {
+		// the tree lives under the raw --topic, the same base
+		// publishers use
+		c->sub_left   = opt->filters;
+		works[0]->msg = sub_filters_msg(c, opt->topic);
+	} else {
+		topic = nnb_opt_get_topic(opt->topic, opt->username, msg);
+		works[0]->msg = sub_topic_msg(topic);
+		if (topic != opt->topic) {
+			nng_free(topic, strlen(topic) + 1);
+		}
 	}
 
-	nng_dialer_set_ptr(dialer, NNG_OPT_MQTT_CONNMSG, msg);
-	nng_dialer_start(dialer, NNG_FLAG_NONBLOCK);
-	works[0]->msg = msg;
-
-	// printf("dialer start after\n");
+	client_dial(c, opt->host, opt->port, &opt->tls, msg);
 	for (i = 0; i < PARALLEL; i++) {
-		index_cnt = i;
 		sub_cb(works[i]);
 	}
 
 	return 0;
 }
 
+// Frame template of a client, see nnb_frame.h: the largest payload and
+// the first tree leaf, encoded once. Every client shares one template
+// unless the topic has per-client variables.
+static nng_msg *
+pub_template(nnb_pub_opt *opt, nng_msg *connmsg)
+{
+	static nng_msg *shared = NULL;
+	nng_msg *       msg;
+	char *          topic;
+	char            leaf[NNB_TOPIC_LEN];
+	bool            share;
+
+	share = strstr(opt->topic, "%c") == NULL &&
+	    strstr(opt->topic, "%i") == NULL;
+
+	if (share && shared != NULL) {
+		return (shared);
+	}
+	topic = nnb_opt_get_topic(opt->topic, opt->username, connmsg);
+	if (pub_tree.depth > 0) {
+		nnb_tree_topic(&pub_tree, topic, 0, leaf, sizeof(leaf));
+	}
+	pub_frame.payload_max = nnb_payload_max();
+	pub_frame.leaf_len    = pub_tree.depth > 0 ? pub_tree.leaf_len : 0;
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(
+	    msg, pub_tree.depth > 0 ? leaf : topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_retain(msg, opt->retain);
+	nng_mqtt_msg_set_publish_payload(
+	    msg, nnb_payload_buf(), pub_frame.payload_max);
+	nng_mqtt_msg_encode(msg);
+	if (topic != opt->topic) {
+		nng_free(topic, strlen(topic) + 1);
+	}
+	if (share) {
+		shared = msg;
+	}
+	return (msg);
+}
+
 int
 nnb_publish(nnb_pub_opt *opt)
 {
@@ -453,109 +882,513 @@ nnb_publish(nnb_pub_opt *opt)
 		fprintf(stderr, "Connection parameters init failed!\n");
 	}
 
-	char         url[255];
-	nng_socket   sock;
-	nng_dialer   dialer;
-	struct work *w;
-	int          i;
-	int          rv;
+	struct client *c;
+	struct work *  w;
+	nng_msg *      msg;
 
-	if (opt->tls.enable) {
-		sprintf(url, "tls+mqtt-tcp://%s:%d", opt->host, opt->port);
-	} else {
-		sprintf(url, "mqtt-tcp://%s:%d", opt->host, opt->port);
+	c         = alloc_client(opt->host, opt->port, &opt->tls);
+	w         = alloc_work(c, pub_cb);
+	w->pub_id = pub_client_cnt++;
+
+	opt_flag = PUB;
+	pub_opt  = opt;
+
+	// Mqtt connect message
+	msg = client_connect_msg(opt->startnumber + w->pub_id, opt->keepalive,
+	    opt->clean, opt->username, opt->password);
+
+	w->msg = pub_template(opt, msg);
+	client_dial(c, opt->host, opt->port, &opt->tls, msg);
+
+	pub_cb(w);
+
+	return 0;
+}
+
+// Expected fan-out per publish: for a sample of tree leaves, count the
+// generated filters and the distinct clients matching each leaf. Every
+// client's filters are regenerated from its seed instead of being kept.
+static void
+sub_fanout_report(void)
+{
+	int         clients = sub_client_cnt;
+	int         samples = sub_tree.leaves < 1024 ? sub_tree.leaves : 1024;
+	uint64_t    seed    = 0x2545F4914F6CDD1DULL;
+	int *       digits;
+	int *       hit;
+	nnb_filter  f;
+	nnb_hist    filter_fanout;
+	nnb_hist    client_fanout;
+	uint64_t *  filter_hits;
+	uint64_t *  client_hits;
+
+	digits      = nng_alloc(sizeof(int) * NNB_TREE_MAX_DEPTH * samples);
+	hit         = nng_alloc(sizeof(int) * samples);
+	filter_hits = nng_alloc(sizeof(uint64_t) * samples);
+	client_hits = nng_alloc(sizeof(uint64_t) * samples);
+	if (!digits || !hit || !filter_hits || !client_hits) {
+		return;
 	}
-	if ((rv = nng_mqtt_client_open(&sock)) != 0) {
-		nng_fatal("nng_socket", rv);
+	memset(filter_hits, 0, sizeof(uint64_t) * samples);
+	memset(client_hits, 0, sizeof(uint64_t) * samples);
+	for (int s = 0; s < samples; s++) {
+		uint64_t leaf = samples == (int) sub_tree.leaves
+		    ? (uint64_t) s
+		    : nnb_rand(&seed) % sub_tree.leaves;
+		nnb_tree_digits(
+		    &sub_tree, leaf, digits + s * NNB_TREE_MAX_DEPTH);
 	}
 
-	w = alloc_work(sock, pub_cb);
+	for (int c = 0; c < clients; c++) {
+		uint64_t cs = sub_filter_seed(c);
+		memset(hit, 0, sizeof(int) * samples);
+		for (int i = 0; i < sub_opt->filters; i++) {
+			nnb_filter_gen(&sub_tree, sub_opt->plus_ratio,
+			    sub_opt->hash_ratio, &cs, &f);
+			for (int s = 0; s < samples; s++) {
+				if (nnb_filter_match(&f, &sub_tree,
+				        digits + s * NNB_TREE_MAX_DEPTH)) {
+					filter_hits[s]++;
+					hit[s] = 1;
+				}
+			}
+		}
+		for (int s = 0; s < samples; s++) {
+			client_hits[s] += hit[s];
+		}
+	}
 
-	if ((rv = nng_dialer_create(&dialer, sock, url)) != 0) {
-		nng_fatal("nng_dialer_create", rv);
+	nnb_hist_init(&filter_fanout);
+	nnb_hist_init(&client_fanout);
+	for (int s = 0; s < samples; s++) {
+		nnb_hist_add(&filter_fanout, filter_hits[s]);
+		nnb_hist_add(&client_fanout, client_hits[s]);
 	}
+	printf("fan-out per publish over %d of %llu leaves:\n", samples,
+	    (unsigned long long) sub_tree.leaves);
+	nnb_hist_summary(&filter_fanout, "  matching filters", "subs");
+	nnb_hist_summary(&client_fanout, "  matching clients", "msgs");
+
+	nng_free(digits, sizeof(int) * NNB_TREE_MAX_DEPTH * samples);
+	nng_free(hit, sizeof(int) * samples);
+	nng_free(filter_hits, sizeof(uint64_t) * samples);
+	nng_free(client_hits, sizeof(uint64_t) * samples);
+}
 
-	if (opt->tls.enable) {
-		if ((rv = init_dialer_tls(dialer, opt->tls.cacert,
-		              opt->tls.cert, opt->tls.key,
-		              opt->tls.keypass) != 0)) {
-			nng_fatal("init_dialer_tls", rv);
+static void
+nnb_stop(int sig)
+{
+	stopped = 1;
+}
+
+bool
+nnb_stopped(void)
+{
+	return (stopped != 0);
+}
+
+// One of v and v64 is the counter to wait on.
+static bool
+bench_wait(atomic_int *v, atomic_ullong *v64, long long target,
+    const char *what, int timeout)
+{
+	long long last     = -1;
+	nng_time  progress = nng_clock();
+	nng_time  report   = progress;
+
+	for (;;) {
+		long long cur =
+		    v != NULL ? atomic_load(v) : (long long) atomic_load(v64);
+		nng_time now = nng_clock();
+
+		if (cur >= target) {
+			printf("%s: %lld/%lld\n", what, cur, target);
+			return (true);
+		}
+		if (cur != last) {
+			last     = cur;
+			progress = now;
+		} else if (now - progress > (nng_time) timeout * 1000) {
+			log_warn("%s stalled at %lld/%lld", what, cur, target);
+			return (false);
 		}
+		if (stopped) {
+			return (false);
+		}
+		if (now - report >= 1000) {
+			report = now;
+			printf("%s: %lld/%lld\n", what, cur, target);
+		}
+		nng_msleep(10);
 	}
+}
 
-	opt_flag = PUB;
-	pub_opt  = opt;
+bool
+nnb_wait(atomic_int *v, int target, const char *what, int timeout)
+{
+	return (bench_wait(v, NULL, target, what, timeout));
+}
 
-	// Mqtt connect message
-	nng_msg *msg;
-	nng_mqtt_msg_alloc(&msg, 0);
-	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_CONNECT);
-	nng_mqtt_msg_set_connect_keep_alive(msg, opt->keepalive);
-	nng_mqtt_msg_set_connect_clean_session(msg, opt->clean);
+bool
+nnb_wait64(atomic_ullong *v, uint64_t target, const char *what, int timeout)
+{
+	return (bench_wait(NULL, v, (long long) target, what, timeout));
+}
+
+// Messages sent or received so far, the unit of the per-message costs.
+static uint64_t
+nnb_msgs(void)
+{
+	switch (opt_flag) {
+	case SUB:
+		if (sub_opt->share_groups > 0) {
+			return (nnb_share_recv());
+		}
+		return (recv_cnt);
+	case PUB:
+		return (nnb_hist_total(&size_hist));
+	case CONN:
+		break;
+	}
+	return (0);
+}
 
-	nng_mqtt_set_connect_cb(sock, connect_cb, &sock);
-	nng_mqtt_set_disconnect_cb(sock, disconnect_cb, NULL);
+static void
+nnb_report(void)
+{
+	double secs = (nnb_clock_us() - start_us) / 1e6;
 
-	if (opt->username) {
-		nng_mqtt_msg_set_connect_user_name(msg, opt->username);
+	printf("\n");
+	switch (opt_flag) {
+	case SUB:
+		if (sub_opt->share_groups > 0) {
+			nnb_share_report(secs);
+			break;
+		}
+		printf("recv: total=%d in %.1fs, avg rate=%.0f(msg/sec)\n",
+		    (int) recv_cnt, secs, recv_cnt / secs);
+		nnb_hist_summary(&suback_hist, "suback latency", "usec");
+		nnb_hist_summary(&recv_lat_hist, "latency", "usec");
+		if (sub_opt->crc) {
+			nnb_crc_report();
+		}
+		nnb_trace_report();
+		if (sub_opt->filters > 0) {
+			printf("filters: exact=%d, plus=%d, hash=%d, "
+			       "suback failures=%d\n",
+			    (int) filter_cnt[FILTER_EXACT],
+			    (int) filter_cnt[FILTER_PLUS],
+			    (int) filter_cnt[FILTER_HASH],
+			    (int) suback_fail_cnt);
+			sub_fanout_report();
+		}
+		break;
+	case PUB:;
+		unsigned long long bytes = send_bytes;
+		unsigned long long msgs  = nnb_hist_total(&size_hist);
+		printf("sent: total=%llu, bytes=%llu in %.1fs, avg "
+		       "rate=%.0f(msg/sec) %.0f(bytes/sec)\n",
+		    msgs, bytes, secs, msgs / secs, bytes / secs);
+		printf("payload size distribution: %s\n",
+		    nnb_payload_dist_name(pub_opt->size_dist.dist));
+		nnb_hist_print(&size_hist, "payload size", "bytes");
+		nnb_trace_report();
+		break;
+	case CONN:
+		printf("connected: %d in %.1fs\n", (int) acnt, secs);
+		break;
+	}
+	if (nnb_hist_total(&connack_hist) +
+	        nnb_hist_total(&connack_fail_hist) >
+	    0) {
+		nnb_hist_summary(&connack_hist, "connack accepted", "usec");
+		nnb_hist_summary(
+		    &connack_fail_hist, "connack refused", "usec");
+	}
+	if (nnb_hist_total(&reconnect_hist) > 0) {
+		nnb_hist_summary(&reconnect_hist, "reconnect", "usec");
 	}
-	if (opt->password) {
-		nng_mqtt_msg_set_connect_password(msg, opt->password);
+	if (client_slab.used > 0) {
+		size_t used =
+		    nnb_slab_used(&client_slab) + nnb_slab_used(&work_slab);
+		size_t bytes =
+		    nnb_slab_bytes(&client_slab) + nnb_slab_bytes(&work_slab);
+		printf("client state: %d clients, %d works, %.0f "
+		       "bytes/client, %.1f MB reserved in slabs\n",
+		    client_slab.used, work_slab.used,
+		    (double) used / client_slab.used, bytes / 1e6);
 	}
+	nnb_proc_report(nnb_msgs(), acnt);
+	nnb_pool_report();
+}
 
-	nng_msg_dup(&w->msg, msg);
-	nng_dialer_set_ptr(dialer, NNG_OPT_MQTT_CONNMSG, msg);
-	nng_dialer_start(dialer, NNG_FLAG_NONBLOCK);
+static void
+ids_setup(const char *prefix, int start, int count)
+{
+	if (nnb_ids_init(&ids, prefix, start, count) != 0) {
+		nng_fatal("nnb_ids_init", NNG_ENOMEM);
+		exit(EXIT_FAILURE);
+	}
+	printf("client ids: %s%d .. %s%d\n", prefix, start, prefix,
+	    start + count - 1);
+}
 
-	pub_cb(w);
+static void
+cred_setup(const char *file)
+{
+	if (file == NULL) {
+		return;
+	}
+	if (nnb_cred_load(&cred, file) != 0) {
+		exit(EXIT_FAILURE);
+	}
+	printf("credentials: %d clients from %s\n", cred.count, file);
+}
 
-	return 0;
+// Before anything starts nng, which fixes its thread counts.
+static void
+pool_setup(pool_opt *opt, int clients)
+{
+	if (nnb_pool_setup(opt, clients) != 0) {
+		exit(EXIT_FAILURE);
+	}
+}
+
+// From here on the callbacks log through the nnb_log ring.
+static void
+log_setup(int level)
+{
+	int rv;
+
+	nnb_log_set_level(level);
+	if ((rv = nnb_log_start()) != 0) {
+		nng_fatal("nnb_log_start", rv);
+	}
+}
+
+static void
+nnb_metrics_setup(nnb_opt_flag_t flag, const char *listen)
+{
+	if (listen == NULL) {
+		return;
+	}
+	nnb_metrics_counter(
+	    "nnb_connects", "MQTT connections established", &acnt);
+	nnb_metrics_counter(
+	    "nnb_disconnects", "MQTT connections lost", &disc_cnt);
+	nnb_metrics_gauge(
+	    "nnb_connections", "MQTT connections up", &live_cnt);
+	nnb_metrics_hist("nnb_connack_latency_seconds",
+	    "dial to first CONNACK, accepted", &connack_hist, 1e-6);
+	nnb_metrics_hist("nnb_connack_refused_latency_seconds",
+	    "dial to first CONNACK, refused", &connack_fail_hist, 1e-6);
+	nnb_metrics_hist("nnb_reconnect_latency_seconds",
+	    "--reconnect drop to the next CONNACK", &reconnect_hist, 1e-6);
+	switch (flag) {
+	case SUB:
+		nnb_metrics_counter(
+		    "nnb_received_messages", "PUBLISH received", &recv_cnt);
+		nnb_metrics_counter("nnb_suback_failures",
+		    "SUBACK return codes >= 0x80", &suback_fail_cnt);
+		nnb_metrics_hist("nnb_suback_latency_seconds",
+		    "SUBSCRIBE to SUBACK", &suback_hist, 1e-6);
+		nnb_metrics_hist("nnb_latency_seconds",
+		    "stamped publish to delivery", &recv_lat_hist, 1e-6);
+		break;
+	case PUB:
+		nnb_metrics_counter(
+		    "nnb_sent_messages", "PUBLISH sent", &sent_cnt);
+		nnb_metrics_counter64(
+		    "nnb_sent_bytes", "payload bytes sent", &send_bytes);
+		nnb_metrics_hist("nnb_payload_bytes",
+		    "payload size of each PUBLISH sent", &size_hist, 1);
+		break;
+	case CONN:
+		break;
+	}
+	if (nnb_metrics_start(listen) != 0) {
+		exit(EXIT_FAILURE);
+	}
 }
 
 int
 main(int argc, char **argv)
 {
 	if (argc < 2) {
-		fprintf(
-		    stderr, "Usage: nano_bench pub | sub | conn [--help]\n");
+		fprintf(stderr,
+		    "Usage: nano_bench pub | sub | conn | session | retain | "
+		    "search | churn | lwt | resub | transport | blast | proxy "
+		    "[--help]\n");
 		exit(EXIT_FAILURE);
 	}
 
+	signal(SIGINT, nnb_stop);
+	signal(SIGTERM, nnb_stop);
+	start_us = nnb_clock_us();
+	nnb_slab_init(&client_slab, sizeof(struct client), NNB_SLAB_CHUNK);
+	nnb_slab_init(&work_slab, sizeof(struct work), NNB_SLAB_CHUNK);
+	nnb_hist_init(&connack_hist);
+	nnb_hist_init(&connack_fail_hist);
+	nnb_hist_init(&reconnect_hist);
+
 	if (!strcmp(argv[1], "pub")) {
 		nnb_pub_opt *opt = nnb_pub_opt_init(argc - 1, ++argv);
+		pool_setup(&opt->pool, opt->count);
+		if (nnb_payload_init(opt) != 0) {
+			fprintf(stderr, "Payload size init failed!\n");
+			exit(EXIT_FAILURE);
+		}
+		nnb_hist_init(&size_hist);
+		if (opt->crc) {
+			nnb_crc_init();
+		}
+		if (opt->tree && nnb_tree_parse(&pub_tree, opt->tree) != 0) {
+			fprintf(stderr, "Error: bad --tree %s\n", opt->tree);
+			exit(EXIT_FAILURE);
+		}
 		if (0 == opt->limit) {
 			send_limit = INT_MAX;
 		} else {
 			send_limit = opt->limit;
 		}
+		nnb_metrics_setup(PUB, opt->metrics);
+		cred_setup(opt->cred_file);
+		ids_setup(opt->prefix, opt->startnumber, opt->count);
+		nnb_proc_start(opt->broker_pid);
+		if (nnb_trace_init(opt->trace, opt->trace_file, "pub") != 0) {
+			fprintf(stderr, "Trace init failed!\n");
+			exit(EXIT_FAILURE);
+		}
+		log_setup(opt->log_level);
 		for (int i = 0; i < opt->count; i++) {
 			nnb_publish(opt);
 			nng_msleep(opt->interval);
 		}
 	} else if (!strcmp(argv[1], "sub")) {
 		nnb_sub_opt *opt = nnb_sub_opt_init(argc - 1, ++argv);
-		for (int i = 0; i < opt->count; i++) {
-			nnb_subscribe(opt);
-			nng_msleep(opt->interval);
+		pool_setup(&opt->pool, opt->count);
+		nnb_hist_init(&suback_hist);
+		nnb_hist_init(&recv_lat_hist);
+		if (opt->crc) {
+			nnb_crc_init();
+		}
+		if (opt->tree && nnb_tree_parse(&sub_tree, opt->tree) != 0) {
+			fprintf(stderr, "Error: bad --tree %s\n", opt->tree);
+			exit(EXIT_FAILURE);
+		}
+		opt_flag = SUB;
+		sub_opt  = opt;
+		nnb_metrics_setup(SUB, opt->metrics);
+		cred_setup(opt->cred_file);
+		ids_setup(opt->prefix, opt->startnumber, opt->count);
+		nnb_proc_start(opt->broker_pid);
+		if (nnb_trace_init(opt->trace, opt->trace_file, "sub") != 0) {
+			fprintf(stderr, "Trace init failed!\n");
+			exit(EXIT_FAILURE);
+		}
+		log_setup(opt->log_level);
+		if (opt->share_groups > 0) {
+			nnb_share_cfg cfg = { .opt = opt,
+				.ids               = &ids,
+				.cred              = &cred };
+			nnb_share_start(&cfg);
+		} else if (opt->raw) {
+			nnb_rawsub_cfg cfg = { .opt = opt,
+				.ids                = &ids,
+				.cred               = &cred,
+				.connected          = &acnt,
+				.closed             = &disc_cnt,
+				.recv               = &recv_cnt,
+				.suback             = &suback_hist,
+				.lat                = &recv_lat_hist };
+			int rv = nnb_rawsub_start(&cfg);
+			if (rv != 0) {
+				nng_fatal("raw subscribers", rv);
+			}
+		} else {
+			for (int i = 0; i < opt->count; i++) {
+				nnb_subscribe(opt);
+				nng_msleep(opt->interval);
+			}
 		}
-		nnb_sub_opt_destory(opt);
 	} else if (!strcmp(argv[1], "conn")) {
 		nnb_conn_opt *opt = nnb_conn_opt_init(argc - 1, ++argv);
+		pool_setup(&opt->pool, opt->count);
+		nnb_metrics_setup(CONN, opt->metrics);
+		cred_setup(opt->cred_file);
+		ids_setup(opt->prefix, opt->startnumber, opt->count);
+		nnb_proc_start(0);
+		conn_reconnect = opt->reconnect;
+		log_setup(opt->log_level);
 		for (int i = 0; i < opt->count; i++) {
 			nnb_connect(opt);
 			nng_msleep(opt->interval);
 		}
 		nnb_conn_opt_destory(opt);
+	} else if (!strcmp(argv[1], "session")) {
+		nnb_session_opt *opt = nnb_session_opt_init(argc - 1, ++argv);
+		int              rv  = nnb_session_run(opt);
+		nnb_session_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "retain")) {
+		nnb_retain_opt *opt = nnb_retain_opt_init(argc - 1, ++argv);
+		int             rv  = nnb_retain_run(opt);
+		nnb_retain_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "search")) {
+		nnb_search_opt *opt = nnb_search_opt_init(argc - 1, ++argv);
+		int             rv  = nnb_search_run(opt);
+		nnb_search_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "churn")) {
+		nnb_churn_opt *opt = nnb_churn_opt_init(argc - 1, ++argv);
+		int            rv  = nnb_churn_run(opt);
+		nnb_churn_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "lwt")) {
+		nnb_lwt_opt *opt = nnb_lwt_opt_init(argc - 1, ++argv);
+		int          rv  = nnb_lwt_run(opt);
+		nnb_lwt_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "resub")) {
+		nnb_resub_opt *opt = nnb_resub_opt_init(argc - 1, ++argv);
+		int            rv  = nnb_resub_run(opt);
+		nnb_resub_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "transport")) {
+		nnb_transport_opt *opt =
+		    nnb_transport_opt_init(argc - 1, ++argv);
+		int rv = nnb_transport_run(opt);
+		nnb_transport_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "blast")) {
+		nnb_blast_opt *opt = nnb_blast_opt_init(argc - 1, ++argv);
+		int            rv  = nnb_blast_run(opt);
+		nnb_blast_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	} else if (!strcmp(argv[1], "proxy")) {
+		nnb_proxy_opt *opt = nnb_proxy_opt_init(argc - 1, ++argv);
+		int            rv  = nnb_proxy_run(opt);
+		nnb_proxy_opt_destory(opt);
+		exit(rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
 	} else {
-		fprintf(
-		    stderr, "Usage: nano_bench pub | sub | conn [--help]\n");
+		fprintf(stderr,
+		    "Usage: nano_bench pub | sub | conn | session | retain | "
+		    "search | churn | lwt | resub | transport | blast | proxy "
+		    "[--help]\n");
 		exit(EXIT_FAILURE);
 	}
 
-	for (;;) {
+	while (!stopped) {
 		nng_msleep(1000); // neither pause() nor sleep() portable
+		nnb_proc_tick();
+		nnb_pool_tick();
 		switch (opt_flag) {
 		case SUB:;
+			if (sub_opt->share_groups > 0) {
+				nnb_share_tick();
+				break;
+			}
 			int c         = recv_cnt;
 			int l         = last_recv_cnt;
 			last_recv_cnt = c;
@@ -569,17 +1402,27 @@ main(int argc, char **argv)
 			c             = send_cnt;
 			l             = last_send_cnt;
 			last_send_cnt = c;
+			unsigned long long b  = send_bytes;
+			unsigned long long lb = last_send_bytes;
+			last_send_bytes       = b;
 			if (c != l) {
 				printf("sent: total=%d, "
-				       "rate=%d(msg/sec)\n",
-				    c - pub_opt->count, c - l);
+				       "rate=%d(msg/sec), %llu(bytes/sec)\n",
+				    c - pub_opt->count, c - l, b - lb);
 			}
 			break;
 		}
 	}
 
+	nnb_log_stop();
+	nnb_report();
+	nnb_metrics_stop();
+
 	if (opt_flag == PUB) {
+		nnb_payload_fini();
 		nnb_pub_opt_destory(pub_opt);
+	} else if (opt_flag == SUB) {
+		nnb_sub_opt_destory(sub_opt);
 	}
 
 	return 0;
@@ -0,0 +1,49 @@
+#ifndef NNB_BENCH_H
+#define NNB_BENCH_H
+#include "nnb_opt.h"
+#include <stdatomic.h>
+
+// Helpers shared by the bench modes, implemented in mqtt_async.c.
+
+void nng_fatal(const char *msg, int rv);
+
+// True once SIGINT or SIGTERM asked the run to stop.
+bool nnb_stopped(void);
+
+// Waits until *v reaches target, printing progress every second. Gives
+// up after timeout seconds without progress or when the run is stopped.
+bool nnb_wait(atomic_int *v, int target, const char *what, int timeout);
+bool nnb_wait64(
+    atomic_ullong *v, uint64_t target, const char *what, int timeout);
+
+// CONNECT message for one client; ownership passes to nnb_dial.
+nng_msg *nnb_connect_msg(
+    int keepalive, bool clean, const char *username, const char *password);
+
+// Adds will to a CONNECT from nnb_connect_msg, with "%i" in the will
+// topic replaced by index. Does nothing when no will topic is set.
+void nnb_connect_will(nng_msg *msg, will_opt *will, int index);
+
+// Opens an MQTT client socket for the transport in tls. A QUIC socket
+// starts dialing host:port as it opens; the others dial in nnb_dial.
+int nnb_client_open(
+    nng_socket *sock, const char *host, int port, tls_opt *tls);
+
+// Dial URL for host:port over the transport in tls: mqtt-tcp://,
+// tls+mqtt-tcp://, ws:// and wss:// with the websocket path, or
+// mqtt-quic://.
+void nnb_dial_url(
+    char *url, size_t sz, const char *host, int port, tls_opt *tls);
+
+// Creates a dialer for host:port on an open MQTT client socket and
+// starts it in the background with the given CONNECT message.
+int nnb_dial(nng_socket sock, const char *host, int port, tls_opt *tls,
+    nng_msg *connmsg);
+
+// nnb_dial with the caller's connect and disconnect callbacks instead of
+// the bench-wide ones, installed before the dialer starts.
+int nnb_dial_cb(nng_socket sock, const char *host, int port, tls_opt *tls,
+    nng_msg *connmsg, nng_pipe_cb on_connect, nng_pipe_cb on_disconnect,
+    void *arg);
+
+#endif
@@ -0,0 +1,429 @@
+#include "nnb_blast.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_id.h"
+#include "nnb_proc.h"
+#include "nnb_util.h"
+#include "nnb_wire.h"
+#include <errno.h>
+#include <limits.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define BLAST_EVENTS 256
+#define BLAST_IN_LEN 4096 // read and dropped per wakeup
+
+typedef enum {
+	BLAST_CONNECTING, // TCP handshake in progress
+	BLAST_CONNACK,    // CONNECT written, waiting for CONNACK
+	BLAST_SENDING,
+	BLAST_DEAD,
+} blast_state;
+
+typedef struct {
+	int         fd;
+	int         index;
+	blast_state state;
+	uint8_t *   frame; // pre-encoded PUBLISH
+	size_t      frame_len;
+	size_t      off;     // bytes of the current frame already written
+	uint8_t *   connect; // pre-encoded CONNECT
+	size_t      connect_len;
+	size_t      connect_off;
+	uint8_t     in[8]; // CONNACK prefix
+	size_t      in_len;
+} blast_conn;
+
+typedef struct {
+	nng_thread *  thr;
+	int           epfd;
+	int           index;
+	atomic_ullong sent;   // whole frames written
+	atomic_ullong stalls; // writes that hit a full socket buffer
+} blast_worker;
+
+static struct {
+	nnb_blast_opt *opt;
+	blast_conn *   conns;
+	blast_worker * workers;
+	nnb_ids        ids; // <prefix><n> of the connections
+	atomic_int     connected;
+	atomic_int     dead;
+	atomic_bool    stop;
+	uint64_t       start_us; // pacing origin
+} blast;
+
+static void
+blast_kill(blast_conn *c)
+{
+	if (c->state == BLAST_DEAD) {
+		return;
+	}
+	if (c->state == BLAST_SENDING) {
+		--blast.connected;
+	}
+	c->state = BLAST_DEAD;
+	++blast.dead;
+	close(c->fd);
+}
+
+static void
+blast_events(blast_worker *w, blast_conn *c, uint32_t events)
+{
+	struct epoll_event ev = { .events = events, .data.ptr = c };
+
+	epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// Writes the rest of CONNECT once the TCP handshake is done.
+static void
+blast_write_connect(blast_worker *w, blast_conn *c)
+{
+	ssize_t n;
+
+	while (c->connect_off < c->connect_len) {
+		n = write(c->fd, c->connect + c->connect_off,
+		    c->connect_len - c->connect_off);
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				blast_kill(c);
+			}
+			return;
+		}
+		c->connect_off += n;
+	}
+	c->state = BLAST_CONNACK;
+	blast_events(w, c, EPOLLIN);
+}
+
+// Reads the CONNACK, then drops whatever else the broker sends.
+static void
+blast_read(blast_worker *w, blast_conn *c)
+{
+	uint8_t buf[BLAST_IN_LEN];
+	ssize_t n;
+
+	for (;;) {
+		if ((n = read(c->fd, buf, sizeof(buf))) == 0) {
+			blast_kill(c);
+			return;
+		}
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				blast_kill(c);
+			}
+			return;
+		}
+		if (c->state != BLAST_CONNACK) {
+			continue;
+		}
+		// CONNACK is 0x20, length, flags, return code or reason
+		for (ssize_t i = 0; i < n && c->in_len < 4; i++) {
+			c->in[c->in_len++] = buf[i];
+		}
+		if (c->in_len < 4) {
+			continue;
+		}
+		if (c->in[0] != 0x20 || c->in[3] != 0) {
+			log_warn("blast %d: connect refused, reason code %d",
+			    c->index, c->in[3]);
+			blast_kill(c);
+			return;
+		}
+		c->state = BLAST_SENDING;
+		++blast.connected;
+		blast_events(w, c, EPOLLIN | EPOLLOUT);
+	}
+}
+
+// Frames the worker may still send now under --rate, or limit when
+// unpaced.
+static size_t
+blast_budget(blast_worker *w, size_t limit)
+{
+	nnb_blast_opt *opt = blast.opt;
+	double         due;
+
+	if (opt->rate == 0) {
+		return (limit);
+	}
+	due = (double) opt->rate / opt->threads *
+	    (nnb_clock_us() - blast.start_us) / 1e6;
+	if (due <= (double) w->sent) {
+		return (0);
+	}
+	due -= w->sent;
+	return (due < limit ? (size_t) due : limit);
+}
+
+// One writev of up to --batch copies of the frame, the first of them
+// resuming a frame a short write cut off.
+static void
+blast_write(blast_worker *w, blast_conn *c, struct iovec *iov)
+{
+	size_t  nframes = blast_budget(w, blast.opt->batch);
+	size_t  total;
+	ssize_t n;
+
+	if (nframes == 0) {
+		return;
+	}
+	for (size_t i = 0; i < nframes; i++) {
+		iov[i].iov_base = c->frame;
+		iov[i].iov_len  = c->frame_len;
+	}
+	iov[0].iov_base = c->frame + c->off;
+	iov[0].iov_len  = c->frame_len - c->off;
+
+	if ((n = writev(c->fd, iov, nframes)) < 0) {
+		if (errno == EAGAIN) {
+			++w->stalls;
+		} else if (errno != EINTR) {
+			blast_kill(c);
+		}
+		return;
+	}
+	total  = c->off + n;
+	c->off = total % c->frame_len;
+	w->sent += total / c->frame_len;
+}
+
+static void
+blast_loop(void *arg)
+{
+	blast_worker *     w = arg;
+	struct epoll_event evs[BLAST_EVENTS];
+	struct iovec *     iov;
+	int                n;
+
+	if ((iov = nng_alloc(sizeof(struct iovec) * blast.opt->batch)) ==
+	    NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return;
+	}
+	while (!blast.stop) {
+		n = epoll_wait(w->epfd, evs, BLAST_EVENTS, 10);
+		for (int i = 0; i < n; i++) {
+			blast_conn *c = evs[i].data.ptr;
+			uint32_t    e = evs[i].events;
+			int         err;
+			socklen_t   len = sizeof(err);
+
+			if (e & (EPOLLERR | EPOLLHUP)) {
+				blast_kill(c);
+				continue;
+			}
+			if (c->state == BLAST_CONNECTING && (e & EPOLLOUT)) {
+				getsockopt(
+				    c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+				if (err != 0) {
+					blast_kill(c);
+					continue;
+				}
+				blast_write_connect(w, c);
+				continue;
+			}
+			if (e & EPOLLIN) {
+				blast_read(w, c);
+			}
+			if (c->state == BLAST_SENDING && (e & EPOLLOUT)) {
+				blast_write(w, c, iov);
+			}
+		}
+		if (blast.opt->rate > 0 && blast_budget(w, 1) == 0) {
+			nng_msleep(1); // level-triggered EPOLLOUT would spin
+		}
+	}
+	nng_free(iov, sizeof(struct iovec) * blast.opt->batch);
+}
+
+static int
+blast_dial(blast_conn *c, struct addrinfo *ai, blast_worker *w)
+{
+	struct epoll_event ev  = { .events = EPOLLOUT, .data.ptr = c };
+	int                one = 1;
+
+	c->fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (c->fd < 0) {
+		log_err("socket: %s", strerror(errno));
+		return (-1);
+	}
+	// frames are batched already; Nagle would only add latency
+	setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (connect(c->fd, ai->ai_addr, ai->ai_addrlen) != 0 &&
+	    errno != EINPROGRESS) {
+		log_err("connect: %s", strerror(errno));
+		close(c->fd);
+		return (-1);
+	}
+	c->state = BLAST_CONNECTING;
+	return (epoll_ctl(w->epfd, EPOLL_CTL_ADD, c->fd, &ev));
+}
+
+// Topic of connection n, with "%i" replaced by n.
+static void
+blast_topic(char *buf, size_t sz, int n)
+{
+	const char *topic = blast.opt->topic;
+	const char *p     = strstr(topic, "%i");
+
+	if (p == NULL) {
+		snprintf(buf, sz, "%s", topic);
+	} else {
+		snprintf(buf, sz, "%.*s%d%s", (int) (p - topic), topic, n,
+		    p + 2);
+	}
+}
+
+static uint64_t
+blast_sent(void)
+{
+	uint64_t sent = 0;
+
+	for (int i = 0; i < blast.opt->threads; i++) {
+		sent += blast.workers[i].sent;
+	}
+	return (sent);
+}
+
+static uint64_t
+blast_stalls(void)
+{
+	uint64_t stalls = 0;
+
+	for (int i = 0; i < blast.opt->threads; i++) {
+		stalls += blast.workers[i].stalls;
+	}
+	return (stalls);
+}
+
+int
+nnb_blast_run(nnb_blast_opt *opt)
+{
+	struct addrinfo  hints = { .ai_socktype = SOCK_STREAM };
+	struct addrinfo *ai;
+	char             port[16];
+	char             topic[256];
+	nnb_proc_stat    p0, p1;
+	uint64_t         sent0, sent, last, t0, us;
+	size_t           frame_len = 0;
+	int              rv;
+
+	blast.opt     = opt;
+	blast.conns   = nng_alloc(sizeof(blast_conn) * opt->count);
+	blast.workers = nng_alloc(sizeof(blast_worker) * opt->threads);
+	if (blast.conns == NULL || blast.workers == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(blast.conns, 0, sizeof(blast_conn) * opt->count);
+	memset(blast.workers, 0, sizeof(blast_worker) * opt->threads);
+	if (nnb_ids_init(&blast.ids, opt->prefix, opt->startnumber,
+	        opt->count) != 0) {
+		nng_fatal("nnb_ids_init", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+
+	snprintf(port, sizeof(port), "%d", opt->port);
+	if ((rv = getaddrinfo(opt->host, port, &hints, &ai)) != 0) {
+		log_err("%s: %s", opt->host, gai_strerror(rv));
+		return (NNG_EADDRINVAL);
+	}
+
+	blast.start_us = nnb_clock_us();
+	for (int i = 0; i < opt->threads; i++) {
+		blast_worker *w = &blast.workers[i];
+		w->index        = i;
+		if ((w->epfd = epoll_create1(0)) < 0) {
+			log_err("epoll_create1: %s", strerror(errno));
+			return (NNG_ENOMEM);
+		}
+		if ((rv = nng_thread_create(&w->thr, blast_loop, w)) != 0) {
+			nng_fatal("nng_thread_create", rv);
+			return (rv);
+		}
+	}
+
+	for (int i = 0; i < opt->count && !nnb_stopped(); i++) {
+		blast_conn *c = &blast.conns[i];
+		int         n = opt->startnumber + i;
+
+		c->index = n;
+		blast_topic(topic, sizeof(topic), n);
+		c->connect = nnb_wire_connect(opt->version, opt->keepalive,
+		    true, nnb_ids_get(&blast.ids, n), opt->username,
+		    opt->password, &c->connect_len);
+		c->frame   = nnb_wire_publish(
+		    opt->version, topic, opt->size, &c->frame_len);
+		if (c->connect == NULL || c->frame == NULL) {
+			nng_fatal("nng_alloc", NNG_ENOMEM);
+			return (NNG_ENOMEM);
+		}
+		frame_len = c->frame_len;
+		if (blast_dial(c, ai, &blast.workers[i % opt->threads]) != 0) {
+			c->state = BLAST_DEAD;
+			++blast.dead;
+		}
+		nng_msleep(opt->interval);
+	}
+	freeaddrinfo(ai);
+	if (!nnb_wait(&blast.connected, opt->count - blast.dead, "connected",
+	        opt->timeout)) {
+		log_warn("blasting over %d of %d connections",
+		    (int) blast.connected, opt->count);
+	}
+
+	// measure from the moment every connection is up
+	nnb_proc_sample(0, &p0);
+	t0    = nnb_clock_us();
+	sent0 = blast_sent();
+	last  = sent0;
+	for (int s = 0; (opt->duration == 0 || s < opt->duration) &&
+	     !nnb_stopped() && blast.connected > 0;
+	     s++) {
+		nng_msleep(1000);
+		sent = blast_sent();
+		printf("blast: sent=%llu(msg/sec), %.1f(MB/sec), "
+		       "connected=%d, stalls=%llu\n",
+		    (unsigned long long) (sent - last),
+		    (double) (sent - last) * frame_len / 1e6,
+		    (int) blast.connected,
+		    (unsigned long long) blast_stalls());
+		last = sent;
+	}
+	us   = nnb_clock_us() - t0;
+	sent = blast_sent() - sent0;
+	nnb_proc_sample(0, &p1);
+
+	blast.stop = true;
+	for (int i = 0; i < opt->threads; i++) {
+		nng_thread_destroy(blast.workers[i].thr);
+		close(blast.workers[i].epfd);
+	}
+	for (int i = 0; i < opt->count; i++) {
+		blast_conn *c = &blast.conns[i];
+		if (c->state != BLAST_DEAD && c->fd > 0) {
+			close(c->fd);
+		}
+		nng_free(c->connect, c->connect_len);
+		nng_free(c->frame, c->frame_len);
+	}
+	nng_free(blast.ids.buf, blast.ids.stride * blast.ids.count);
+
+	printf("\n%d connections, %d threads, %d byte payloads (%zu byte "
+	       "frames), batch %d\n",
+	    opt->count, opt->threads, opt->size, frame_len, opt->batch);
+	printf("sent: %llu in %.1fs, %.0f(msg/sec), %.1f(MB/sec)\n",
+	    (unsigned long long) sent, us / 1e6, sent * 1e6 / us,
+	    (double) sent * frame_len / us);
+	printf("bench cpu: %.3f(us/msg), lost connections: %d\n",
+	    sent > 0 ? (double) (p1.cpu_us - p0.cpu_us) / sent : 0,
+	    (int) blast.dead);
+	return (sent > 0 ? 0 : NNG_ECONNREFUSED);
+}
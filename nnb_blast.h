@@ -0,0 +1,13 @@
+#ifndef NNB_BLAST_H
+#define NNB_BLAST_H
+#include "nnb_opt.h"
+
+// Raw ingest load: -c plain TCP connections, spread over --threads
+// epoll loops, send QoS 0 PUBLISH frames encoded once per connection
+// with batched writev, bypassing nng messages and aios entirely. Only
+// CONNECT/CONNACK are spoken besides PUBLISH; what the broker sends
+// back is read and dropped. The nng modes remain the reference for
+// latency and delivery; this one measures how much a broker can take.
+int nnb_blast_run(nnb_blast_opt *opt);
+
+#endif
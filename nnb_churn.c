@@ -0,0 +1,418 @@
+#include "nnb_churn.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_payload.h"
+#include "nnb_pump.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <stdatomic.h>
+
+#define CHURN_WINDOW 32 // in-flight publishes per publisher
+#define CHURN_SLICES 10 // churn is spread over the second in slices
+#define CHURN_ID_LEN 64
+#define CHURN_SEEN 1024 // receive window per client, in its messages
+
+typedef struct churn_client churn_client;
+
+// One aio subscribes and one receives, so a client's receive window is
+// only touched from its own callbacks. Its messages come from several
+// publishers with a window in flight each and arrive out of order, so a
+// sequence only counts as lost once it has fallen out of the window, or
+// was published to the client and is still missing at the end of the
+// run.
+struct churn_client {
+	int           index;
+	nng_socket    sock;
+	nng_aio *     sub_aio;
+	nng_ctx       sub_ctx;
+	nng_aio *     recv_aio;
+	nng_ctx       recv_ctx;
+	bool          reconnect; // the current dial is a reconnect
+	uint64_t      dial_us;   // nnb_clock_us() at dial
+	uint64_t      sub_us;    // nnb_clock_us() at SUBSCRIBE
+	atomic_ullong up_rt;     // nnb_realtime_us() at the last CONNACK
+	uint64_t      base; // first sequence not settled, in its messages
+	uint64_t      seen[CHURN_SEEN / 64]; // received, from base on
+};
+
+static struct {
+	nnb_churn_opt *opt;
+	churn_client * clients;
+	nnb_pump       pump;
+	uint8_t *      payload;
+	uint64_t       seed;
+	atomic_int     subacked;
+	atomic_int     connected;
+	atomic_int     reconnects; // completed, CONNACK received
+	atomic_int     churned;    // started
+	atomic_llong   recv;
+	atomic_llong   lost;   // never arrived
+	atomic_llong   dups;   // arrived twice, or behind the window
+	atomic_llong   across; // sent before the client's last CONNACK
+	nnb_hist       reconnect_hist; // dial to CONNACK, usec
+	nnb_hist       resub_hist;     // SUBSCRIBE to SUBACK, usec
+	nnb_hist       steady_hist;    // stamp to delivery, usec
+	nnb_hist       across_hist;    // same, messages across a reconnect
+} churn;
+
+static void
+churn_connect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	churn_client *c = arg;
+
+	c->up_rt = nnb_realtime_us();
+	++churn.connected;
+	if (c->reconnect) {
+		nnb_hist_add(
+		    &churn.reconnect_hist, nnb_clock_us() - c->dial_us);
+		++churn.reconnects;
+	}
+}
+
+static void
+churn_disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	--churn.connected;
+}
+
+static void
+churn_sub_cb(void *arg)
+{
+	churn_client *c = arg;
+	nng_msg *     msg;
+	int           rv;
+
+	if ((msg = nng_aio_get_msg(c->sub_aio)) != NULL) {
+		nng_aio_set_msg(c->sub_aio, NULL);
+		nng_msg_free(msg);
+	}
+	if ((rv = nng_aio_result(c->sub_aio)) != 0) {
+		if (rv != NNG_ECLOSED && rv != NNG_ECANCELED) {
+			nng_fatal("churn_sub_cb", rv);
+		}
+		return;
+	}
+	if (c->reconnect) {
+		nnb_hist_add(&churn.resub_hist, nnb_clock_us() - c->sub_us);
+	} else {
+		++churn.subacked;
+	}
+}
+
+// Moves the window up to sequence to, counting what never arrived.
+static void
+churn_settle(churn_client *c, uint64_t to)
+{
+	long long lost = 0;
+
+	for (; c->base < to; c->base++) {
+		uint64_t  bit = 1ull << (c->base % 64);
+		uint64_t *w   = &c->seen[c->base % CHURN_SEEN / 64];
+
+		if (*w & bit) {
+			*w &= ~bit;
+		} else {
+			lost++;
+		}
+	}
+	churn.lost += lost;
+}
+
+static void
+churn_seen(churn_client *c, uint64_t seq)
+{
+	uint64_t  bit = 1ull << (seq % 64);
+	uint64_t *w;
+
+	if (seq < c->base) {
+		++churn.dups;
+		return;
+	}
+	if (seq >= c->base + CHURN_SEEN) {
+		churn_settle(c, seq - CHURN_SEEN + 1);
+	}
+	w = &c->seen[seq % CHURN_SEEN / 64];
+	if (*w & bit) {
+		++churn.dups;
+		return;
+	}
+	*w |= bit;
+}
+
+// Messages below n that were published to client c.
+static uint64_t
+churn_published(churn_client *c, uint64_t n)
+{
+	uint64_t i     = c->index - churn.opt->startnumber;
+	uint64_t count = churn.opt->count;
+
+	return (n > i ? (n - i + count - 1) / count : 0);
+}
+
+static void
+churn_recv_cb(void *arg)
+{
+	churn_client *c     = arg;
+	int           count = churn.opt->count;
+	nng_msg *     msg;
+	nnb_stamp     st;
+	uint8_t *     payload;
+	uint32_t      len;
+	uint64_t      now;
+	int           rv;
+
+	if ((rv = nng_aio_result(c->recv_aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("churn_recv_cb", rv);
+		nng_ctx_recv(c->recv_ctx, c->recv_aio);
+		return;
+	}
+	if ((msg = nng_aio_get_msg(c->recv_aio)) == NULL) {
+		nng_ctx_recv(c->recv_ctx, c->recv_aio);
+		return;
+	}
+	nng_aio_set_msg(c->recv_aio, NULL);
+	payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+	if (nnb_stamp_read(payload, len, &st)) {
+		now = nnb_realtime_us();
+		++churn.recv;
+		if (st.ts_us < c->up_rt && c->reconnect) {
+			++churn.across;
+			nnb_hist_add(&churn.across_hist, now - st.ts_us);
+		} else {
+			nnb_hist_add(&churn.steady_hist, now - st.ts_us);
+		}
+		// client i gets every count'th message from i on
+		churn_seen(c, st.seq / count);
+	}
+	nng_msg_free(msg);
+	nng_ctx_recv(c->recv_ctx, c->recv_aio);
+}
+
+static nng_msg *
+churn_subscribe_msg(churn_client *c)
+{
+	nng_msg *msg;
+	char     topic[NNB_TOPIC_LEN];
+
+	snprintf(topic, sizeof(topic), "%s/%d", churn.opt->topic, c->index);
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = churn.opt->qos,
+		    .topic = { .buf = (uint8_t *) topic,
+		        .length     = strlen(topic) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	return (msg);
+}
+
+// Opens a socket for the client and dials it. A reconnect with a
+// persistent session relies on the broker restoring the subscription.
+static void
+churn_dial(churn_client *c)
+{
+	nnb_churn_opt *opt = churn.opt;
+	nng_msg *      msg;
+	char           id[CHURN_ID_LEN];
+	int            rv;
+
+	if ((rv = nnb_client_open(
+	         &c->sock, opt->host, opt->port, &opt->tls)) != 0 ||
+	    (rv = nng_ctx_open(&c->sub_ctx, c->sock)) != 0 ||
+	    (rv = nng_ctx_open(&c->recv_ctx, c->sock)) != 0) {
+		nng_fatal("churn_dial", rv);
+		return;
+	}
+	msg = nnb_connect_msg(
+	    opt->keepalive, opt->clean, opt->username, opt->password);
+	snprintf(id, sizeof(id), "nnb_churn_%d", c->index);
+	nng_mqtt_msg_set_connect_client_id(msg, id);
+	c->dial_us = nnb_clock_us();
+	nnb_dial_cb(c->sock, opt->host, opt->port, &opt->tls, msg,
+	    churn_connect_cb, churn_disconnect_cb, c);
+
+	if (!c->reconnect || opt->clean) {
+		c->sub_us = nnb_clock_us();
+		nng_aio_set_msg(c->sub_aio, churn_subscribe_msg(c));
+		nng_ctx_send(c->sub_ctx, c->sub_aio);
+	}
+	nng_ctx_recv(c->recv_ctx, c->recv_aio);
+}
+
+static void
+churn_close(churn_client *c, bool disconnect)
+{
+	nng_msg *msg;
+
+	if (disconnect) {
+		nng_mqtt_msg_alloc(&msg, 0);
+		nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_DISCONNECT);
+		if (nng_sendmsg(c->sock, msg, 0) != 0) {
+			nng_msg_free(msg);
+		}
+	}
+	nng_close(c->sock);
+	nng_aio_stop(c->sub_aio);
+	nng_aio_stop(c->recv_aio);
+}
+
+static void
+churn_one(churn_client *c)
+{
+	++churn.churned;
+	churn_close(c, !churn.opt->abrupt);
+	c->reconnect = true;
+	churn_dial(c);
+}
+
+static nng_msg *
+churn_make(uint64_t n, void *arg)
+{
+	nnb_churn_opt *opt = arg;
+	nng_msg *      msg;
+	nnb_stamp      st = { .pub_id = 0, .seq = n };
+	char           topic[NNB_TOPIC_LEN];
+
+	snprintf(topic, sizeof(topic), "%s/%d", opt->topic,
+	    opt->startnumber + (int) (n % opt->count));
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_payload(msg, churn.payload, opt->size);
+	nng_mqtt_msg_encode(msg);
+	st.ts_us = nnb_realtime_us();
+	nnb_stamp_write(
+	    (uint8_t *) nng_msg_body(msg) + nng_msg_len(msg) - opt->size,
+	    &st);
+	return (msg);
+}
+
+static void
+churn_report(double secs)
+{
+	nnb_churn_opt *opt = churn.opt;
+
+	printf("\nchurn: %d reconnects started, %d completed in %.1fs, "
+	       "%.1f/sec (target %.1f/sec), %s, clean=%s\n",
+	    (int) churn.churned, (int) churn.reconnects, secs,
+	    churn.reconnects / secs, opt->count * opt->churn / 100,
+	    opt->abrupt ? "abrupt" : "DISCONNECT",
+	    opt->clean ? "true" : "false");
+	nnb_hist_summary(&churn.reconnect_hist, "reconnect", "usec");
+	if (opt->clean) {
+		nnb_hist_summary(&churn.resub_hist, "resubscribe", "usec");
+	}
+	printf("traffic: %lld published, %lld received, %lld lost, %lld "
+	       "duplicated, %lld across reconnects\n",
+	    (long long) churn.pump.acked, (long long) churn.recv,
+	    (long long) churn.lost, (long long) churn.dups,
+	    (long long) churn.across);
+	nnb_hist_summary(&churn.steady_hist, "steady latency", "usec");
+	nnb_hist_summary(&churn.across_hist, "across reconnect", "usec");
+}
+
+int
+nnb_churn_run(nnb_churn_opt *opt)
+{
+	nnb_pump_cfg cfg;
+	uint64_t     t0, end;
+	double       carry = 0;
+	int          last  = 0;
+	int          rv;
+
+	churn.opt     = opt;
+	churn.seed    = nnb_clock_us() | 1;
+	churn.clients = nng_alloc(sizeof(churn_client) * opt->count);
+	churn.payload = nng_alloc(opt->size);
+	if (churn.clients == NULL || churn.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(churn.clients, 0, sizeof(churn_client) * opt->count);
+	memset(churn.payload, 'A', opt->size);
+	nnb_hist_init(&churn.reconnect_hist);
+	nnb_hist_init(&churn.resub_hist);
+	nnb_hist_init(&churn.steady_hist);
+	nnb_hist_init(&churn.across_hist);
+
+	for (int i = 0; i < opt->count; i++) {
+		churn_client *c = &churn.clients[i];
+		c->index        = opt->startnumber + i;
+		if ((rv = nng_aio_alloc(&c->sub_aio, churn_sub_cb, c)) != 0 ||
+		    (rv = nng_aio_alloc(&c->recv_aio, churn_recv_cb, c)) !=
+		        0) {
+			nng_fatal("nng_aio_alloc", rv);
+			return (rv);
+		}
+		churn_dial(c);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&churn.subacked, opt->count, "subscribed",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+
+	cfg = (nnb_pump_cfg) {
+		.host      = opt->host,
+		.port      = opt->port,
+		.tls       = &opt->tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_churn_pub_",
+		.clients   = opt->publishers,
+		.window    = CHURN_WINDOW,
+		.total     = 0,
+		.rate      = opt->rate,
+		.make      = churn_make,
+		.arg       = opt,
+	};
+	if ((rv = nnb_pump_start(&churn.pump, &cfg)) != 0) {
+		return (rv);
+	}
+
+	t0 = nnb_clock_us();
+	for (int tick = 1; !nnb_stopped() &&
+	     (opt->duration == 0 || tick <= opt->duration * CHURN_SLICES);
+	     tick++) {
+		carry += opt->count * opt->churn / 100 / CHURN_SLICES;
+		for (; carry >= 1; carry -= 1) {
+			churn_one(&churn.clients[nnb_rand(&churn.seed) %
+			    opt->count]);
+		}
+		nng_msleep(1000 / CHURN_SLICES);
+		if (tick % CHURN_SLICES == 0) {
+			int r = churn.reconnects;
+			// loss is only known once the run has drained
+			printf("churn: reconnects=%d/sec, connected=%d, "
+			       "recv=%lld\n",
+			    r - last, (int) churn.connected,
+			    (long long) churn.recv);
+			last = r;
+		}
+	}
+
+	end = nnb_clock_us();
+	nnb_pump_halt(&churn.pump);
+	nnb_wait64(&churn.pump.done, churn.pump.next, "published",
+	    opt->timeout);
+	nng_msleep(1000); // let in-flight messages land
+	nnb_pump_stop(&churn.pump);
+	for (int i = 0; i < opt->count; i++) {
+		churn_client *c = &churn.clients[i];
+
+		churn_close(c, true);
+		churn_settle(c, churn_published(c, churn.pump.next));
+	}
+	churn_report((end - t0) / 1e6);
+	for (int i = 0; i < opt->count; i++) {
+		nng_aio_free(churn.clients[i].sub_aio);
+		nng_aio_free(churn.clients[i].recv_aio);
+	}
+	return (0);
+}
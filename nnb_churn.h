@@ -0,0 +1,12 @@
+#ifndef NNB_CHURN_H
+#define NNB_CHURN_H
+#include "nnb_opt.h"
+
+// Connection churn: -c subscribers on their own topics receive a steady
+// stamped publish stream while --churn percent of them per second
+// disconnect (DISCONNECT first, or --abrupt) and reconnect with the
+// same client id. Reports achieved churn, reconnect latency and the
+// messages lost or delayed across reconnects.
+int nnb_churn_run(nnb_churn_opt *opt);
+
+#endif
@@ -0,0 +1,295 @@
+#include "nnb_crc.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#ifndef HWCAP_CRC32
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+#define CRC_POLY 0x82f63b78 // Castagnoli, reflected
+#define CRC_SLOTS 1024      // distinct topics or publishers reported
+#define CRC_NAME_LEN 64
+#define CRC_TOP 10
+
+typedef uint32_t (*crc_fn)(uint32_t, const uint8_t *, size_t);
+
+// A corrupted-count slot, claimed by the first corrupted payload of its
+// key; later ones only add to count. Keys that find no free slot land
+// in the overflow count.
+typedef struct {
+	atomic_uint_fast64_t key; // hash | 1, 0 while free
+	atomic_uint_fast64_t count;
+	char                 name[CRC_NAME_LEN];
+} crc_slot;
+
+typedef struct {
+	crc_slot             slots[CRC_SLOTS];
+	atomic_uint_fast64_t overflow;
+} crc_table;
+
+static uint32_t    crc_tab[8][256];
+static crc_fn      crc_impl;
+static const char *crc_impl_name;
+
+static atomic_uint_fast64_t crc_checked;
+static atomic_uint_fast64_t crc_bad;
+static crc_table            crc_topics;
+static crc_table            crc_pubs;
+
+// Slicing-by-8: eight table lookups per 8 bytes instead of one per
+// byte.
+static uint32_t
+crc_sw(uint32_t crc, const uint8_t *p, size_t len)
+{
+	uint32_t lo;
+	uint32_t hi;
+
+	while (len >= 8) {
+		lo = crc ^ ((uint32_t) p[0] | (uint32_t) p[1] << 8 |
+		         (uint32_t) p[2] << 16 | (uint32_t) p[3] << 24);
+		hi = (uint32_t) p[4] | (uint32_t) p[5] << 8 |
+		    (uint32_t) p[6] << 16 | (uint32_t) p[7] << 24;
+		crc = crc_tab[7][lo & 0xff] ^ crc_tab[6][(lo >> 8) & 0xff] ^
+		    crc_tab[5][(lo >> 16) & 0xff] ^ crc_tab[4][lo >> 24] ^
+		    crc_tab[3][hi & 0xff] ^ crc_tab[2][(hi >> 8) & 0xff] ^
+		    crc_tab[1][(hi >> 16) & 0xff] ^ crc_tab[0][hi >> 24];
+		p += 8;
+		len -= 8;
+	}
+	while (len-- > 0) {
+		crc = crc_tab[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	}
+	return (crc);
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t
+crc_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+	uint64_t c = crc;
+	uint64_t v;
+
+	while (len >= 8) {
+		memcpy(&v, p, 8);
+		c = _mm_crc32_u64(c, v);
+		p += 8;
+		len -= 8;
+	}
+	while (len-- > 0) {
+		c = _mm_crc32_u8((uint32_t) c, *p++);
+	}
+	return ((uint32_t) c);
+}
+
+static bool
+crc_hw_ok(void)
+{
+	return (__builtin_cpu_supports("sse4.2"));
+}
+#elif defined(__aarch64__)
+__attribute__((target("+crc"))) static uint32_t
+crc_hw(uint32_t crc, const uint8_t *p, size_t len)
+{
+	uint64_t v;
+
+	while (len >= 8) {
+		memcpy(&v, p, 8);
+		crc = __crc32cd(crc, v);
+		p += 8;
+		len -= 8;
+	}
+	while (len-- > 0) {
+		crc = __crc32cb(crc, *p++);
+	}
+	return (crc);
+}
+
+static bool
+crc_hw_ok(void)
+{
+	return ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0);
+}
+#endif
+
+void
+nnb_crc_init(void)
+{
+	for (uint32_t i = 0; i < 256; i++) {
+		uint32_t c = i;
+		for (int k = 0; k < 8; k++) {
+			c = c & 1 ? (c >> 1) ^ CRC_POLY : c >> 1;
+		}
+		crc_tab[0][i] = c;
+	}
+	for (int t = 1; t < 8; t++) {
+		for (int i = 0; i < 256; i++) {
+			uint32_t c    = crc_tab[t - 1][i];
+			crc_tab[t][i] = crc_tab[0][c & 0xff] ^ (c >> 8);
+		}
+	}
+	crc_impl      = crc_sw;
+	crc_impl_name = "table";
+#if defined(__x86_64__)
+	if (crc_hw_ok()) {
+		crc_impl      = crc_hw;
+		crc_impl_name = "sse4.2";
+	}
+#elif defined(__aarch64__)
+	if (crc_hw_ok()) {
+		crc_impl      = crc_hw;
+		crc_impl_name = "armv8 crc";
+	}
+#endif
+}
+
+const char *
+nnb_crc_impl(void)
+{
+	return (crc_impl_name);
+}
+
+uint32_t
+nnb_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+	return (~crc_impl(~crc, buf, len));
+}
+
+void
+nnb_crc_seal(uint8_t *payload, uint32_t len)
+{
+	uint32_t crc = nnb_crc32c(0, payload, len - NNB_CRC_LEN);
+
+	payload += len - NNB_CRC_LEN;
+	payload[0] = crc & 0xff;
+	payload[1] = (crc >> 8) & 0xff;
+	payload[2] = (crc >> 16) & 0xff;
+	payload[3] = crc >> 24;
+}
+
+bool
+nnb_crc_check(const uint8_t *payload, uint32_t len)
+{
+	const uint8_t *t;
+
+	if (len < NNB_CRC_LEN) {
+		return (false);
+	}
+	t = payload + len - NNB_CRC_LEN;
+	return (nnb_crc32c(0, payload, len - NNB_CRC_LEN) ==
+	    ((uint32_t) t[0] | (uint32_t) t[1] << 8 | (uint32_t) t[2] << 16 |
+	        (uint32_t) t[3] << 24));
+}
+
+// FNV-1a, good enough to spread topic names over the slots.
+static uint64_t
+crc_hash(const char *s, size_t len)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		h = (h ^ (uint8_t) s[i]) * 0x100000001b3ULL;
+	}
+	return (h | 1);
+}
+
+static void
+crc_file(crc_table *t, const char *name, size_t len)
+{
+	uint64_t key = crc_hash(name, len);
+
+	for (int i = 0; i < CRC_SLOTS; i++) {
+		crc_slot *s    = &t->slots[(key + i) % CRC_SLOTS];
+		uint64_t  want = 0;
+
+		if (atomic_load(&s->key) == key) {
+			++s->count;
+			return;
+		}
+		if (atomic_compare_exchange_strong(&s->key, &want, key)) {
+			// truncated to the slot, snprintf stops there
+			snprintf(s->name, sizeof(s->name), "%.*s", (int) len,
+			    name);
+			++s->count;
+			return;
+		}
+		if (want == key) {
+			++s->count;
+			return;
+		}
+	}
+	++t->overflow;
+}
+
+void
+nnb_crc_count(bool ok, const char *topic, size_t tlen, int pub_id)
+{
+	char name[32];
+
+	++crc_checked;
+	if (ok) {
+		return;
+	}
+	++crc_bad;
+	crc_file(&crc_topics, topic, tlen);
+	if (pub_id < 0) {
+		snprintf(name, sizeof(name), "unknown");
+	} else {
+		snprintf(name, sizeof(name), "%d", pub_id);
+	}
+	crc_file(&crc_pubs, name, strlen(name));
+}
+
+static int
+crc_slot_cmp(const void *a, const void *b)
+{
+	uint64_t ca = (*(crc_slot *const *) a)->count;
+	uint64_t cb = (*(crc_slot *const *) b)->count;
+
+	return (ca < cb ? 1 : ca > cb ? -1 : 0);
+}
+
+// The CRC_TOP keys with the most corrupted payloads.
+static void
+crc_table_report(crc_table *t, const char *what)
+{
+	crc_slot *top[CRC_SLOTS];
+	int       n = 0;
+
+	for (int i = 0; i < CRC_SLOTS; i++) {
+		if (t->slots[i].key != 0) {
+			top[n++] = &t->slots[i];
+		}
+	}
+	if (n == 0) {
+		return;
+	}
+	qsort(top, n, sizeof(top[0]), crc_slot_cmp);
+	printf("corrupted by %s:\n", what);
+	for (int i = 0; i < n && i < CRC_TOP; i++) {
+		printf("  %-40s %llu\n", top[i]->name,
+		    (unsigned long long) top[i]->count);
+	}
+	if (n > CRC_TOP || t->overflow > 0) {
+		printf("  (%d more, %llu not tracked)\n",
+		    n > CRC_TOP ? n - CRC_TOP : 0,
+		    (unsigned long long) t->overflow);
+	}
+}
+
+void
+nnb_crc_report(void)
+{
+	printf("integrity (crc32c, %s): checked=%llu, corrupted=%llu\n",
+	    crc_impl_name, (unsigned long long) crc_checked,
+	    (unsigned long long) crc_bad);
+	crc_table_report(&crc_topics, "topic");
+	crc_table_report(&crc_pubs, "publisher");
+}
@@ -0,0 +1,34 @@
+#ifndef NNB_CRC_H
+#define NNB_CRC_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// With --crc, publishers end every payload with the CRC32C of the bytes
+// before it, little endian, and subscribers check it, so a broker
+// truncating or corrupting payloads shows up as a count instead of
+// going unnoticed. pub refuses --crc unless every payload has room for
+// the CRC, so one shorter than NNB_CRC_LEN is a truncation. The stamp,
+// if any, is written first and is covered.
+#define NNB_CRC_LEN 4
+
+// Picks the SSE4.2 or ARMv8 CRC instructions when the CPU has them,
+// slicing-by-8 tables otherwise. Call once before any other function.
+void nnb_crc_init(void);
+
+// Name of the implementation nnb_crc_init picked.
+const char *nnb_crc_impl(void);
+
+// CRC32C (Castagnoli) of len bytes continuing crc; start from 0.
+uint32_t nnb_crc32c(uint32_t crc, const void *buf, size_t len);
+
+void nnb_crc_seal(uint8_t *payload, uint32_t len);
+bool nnb_crc_check(const uint8_t *payload, uint32_t len);
+
+// Checked and corrupted payload counts. A corrupted payload is filed
+// under its topic and under its publisher, pub_id -1 when the stamp
+// did not survive either.
+void nnb_crc_count(bool ok, const char *topic, size_t tlen, int pub_id);
+void nnb_crc_report(void);
+
+#endif
@@ -0,0 +1,130 @@
+#include "nnb_cred.h"
+#include "dbg.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <nng/nng.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static int
+cred_map(nnb_cred *cred, const char *path)
+{
+	struct stat st;
+	void *      p;
+	int         fd;
+
+	if ((fd = open(path, O_RDONLY)) < 0) {
+		log_err("%s: %s", path, strerror(errno));
+		return (-1);
+	}
+	if (fstat(fd, &st) != 0) {
+		log_err("%s: %s", path, strerror(errno));
+		close(fd);
+		return (-1);
+	}
+	if (st.st_size == 0) {
+		close(fd);
+		return (0);
+	}
+	p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (p == MAP_FAILED) {
+		log_err("mmap %s: %s", path, strerror(errno));
+		close(fd);
+		return (-1);
+	}
+	cred->base = p;
+	cred->len  = st.st_size;
+	close(fd);
+	return (0);
+}
+
+int
+nnb_cred_load(nnb_cred *cred, const char *path)
+{
+	const char *    p;
+	const char *    end;
+	const char *    eol;
+	const char *    c1;
+	const char *    c2;
+	nnb_cred_index *row;
+	size_t          len;
+	size_t          lines = 1;
+	int             line  = 0;
+
+	memset(cred, 0, sizeof(*cred));
+	if (cred_map(cred, path) != 0) {
+		return (-1);
+	}
+	end = cred->base + cred->len;
+	if (cred->len > 0) {
+		madvise((void *) cred->base, cred->len, MADV_SEQUENTIAL);
+	}
+	for (p = cred->base; p < end && (p = memchr(p, '\n', end - p)) != NULL;
+	     p++) {
+		lines++;
+	}
+	if ((cred->rows = nng_alloc(sizeof(nnb_cred_index) * lines)) ==
+	    NULL) {
+		return (-1);
+	}
+
+	for (p = cred->base; p < end; p = eol + 1) {
+		line++;
+		if ((eol = memchr(p, '\n', end - p)) == NULL) {
+			eol = end;
+		}
+		len = eol - p;
+		if (len > 0 && p[len - 1] == '\r') {
+			len--;
+		}
+		if (len == 0 || *p == '#') {
+			continue;
+		}
+		if ((c1 = memchr(p, ',', len)) == NULL || c1 == p ||
+		    (c2 = memchr(c1 + 1, ',', p + len - c1 - 1)) == NULL) {
+			log_err("%s:%d: expected clientid,username,password",
+			    path, line);
+			return (-1);
+		}
+		if (len >= NNB_CRED_ROW) {
+			log_err("%s:%d: row longer than %d bytes", path, line,
+			    NNB_CRED_ROW - 1);
+			return (-1);
+		}
+
+		row           = &cred->rows[cred->count++];
+		row->off      = p - cred->base;
+		row->id_len   = c1 - p;
+		row->user_len = c2 - c1 - 1;
+		row->pass_len = p + len - c2 - 1;
+	}
+	if (cred->count == 0) {
+		log_err("%s: no credentials", path);
+		return (-1);
+	}
+	madvise((void *) cred->base, cred->len, MADV_RANDOM);
+	return (0);
+}
+
+void
+nnb_cred_row(nnb_cred *cred, int n, char *buf, const char **id,
+    const char **username, const char **password)
+{
+	nnb_cred_index *row = &cred->rows[n % cred->count];
+	const char *    p   = cred->base + row->off;
+	char *          u   = buf + row->id_len + 1;
+	char *          w   = u + row->user_len + 1;
+
+	memcpy(buf, p, row->id_len);
+	buf[row->id_len] = '\0';
+	memcpy(u, p + row->id_len + 1, row->user_len);
+	u[row->user_len] = '\0';
+	memcpy(w, p + row->id_len + row->user_len + 2, row->pass_len);
+	w[row->pass_len] = '\0';
+
+	*id       = buf;
+	*username = row->user_len > 0 ? u : NULL;
+	*password = row->pass_len > 0 ? w : NULL;
+}
@@ -0,0 +1,35 @@
+#ifndef NNB_CRED_H
+#define NNB_CRED_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Per-client credentials from a "clientid,username,password" file, one
+// row per line. The file is mapped read only and indexed once by
+// offset and field lengths; it is never written, so its pages stay in
+// the page cache rather than being copied. A row is copied out into the
+// caller's buffer only when its CONNECT is built. Blank lines and lines
+// starting with '#' are skipped; the password is the rest of the line.
+#define NNB_CRED_ROW 1024 // longest row, and the buffer nnb_cred_row fills
+
+typedef struct {
+	size_t   off; // of the client id from the start of the file
+	uint16_t id_len;
+	uint16_t user_len;
+	uint16_t pass_len;
+} nnb_cred_index;
+
+typedef struct {
+	const char *    base; // mapping
+	size_t          len;  // bytes mapped
+	nnb_cred_index *rows;
+	int             count;
+} nnb_cred;
+
+int nnb_cred_load(nnb_cred *cred, const char *path);
+
+// Fields of row n modulo the row count, copied NUL terminated into buf
+// of NNB_CRED_ROW bytes. Empty username or password come back as NULL.
+void nnb_cred_row(nnb_cred *cred, int n, char *buf, const char **id,
+    const char **username, const char **password);
+
+#endif
@@ -0,0 +1,35 @@
+#include "nnb_frame.h"
+#include "nnb_wire.h"
+
+int
+nnb_frame_copy(nnb_frame *f, nng_msg *tmpl, uint32_t size, nng_msg **mp)
+{
+	nng_msg *msg;
+	uint8_t  hdr[5];
+	size_t   n;
+	int      rv;
+
+	if ((rv = nng_msg_dup(&msg, tmpl)) != 0) {
+		return (rv);
+	}
+	if (size < f->payload_max) {
+		nng_msg_chop(msg, f->payload_max - size);
+		// the first byte (type and flags) stays, the remaining
+		// length after it is the new body length
+		hdr[0] = *(uint8_t *) nng_msg_header(msg);
+		n      = 1 + nnb_wire_varint(hdr + 1, nng_msg_len(msg));
+		nng_msg_header_clear(msg);
+		nng_msg_header_append(msg, hdr, n);
+	}
+	*mp = msg;
+	return (0);
+}
+
+char *
+nnb_frame_leaf(nnb_frame *f, nng_msg *msg)
+{
+	uint8_t *body = nng_msg_body(msg);
+	size_t   tlen = (size_t) body[0] << 8 | body[1];
+
+	return ((char *) body + 2 + tlen - f->leaf_len);
+}
@@ -0,0 +1,32 @@
+#ifndef NNB_FRAME_H
+#define NNB_FRAME_H
+#include <nng/nng.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A PUBLISH template is encoded once, with its payload at the largest
+// size the run can draw and its topic at the common length of every
+// topic it may carry. A message is a copy of the template cut down to
+// the drawn payload size; the fields that vary per message are then
+// written over the copy in place, so its cost does not depend on the
+// topic or on re-encoding. Only the remaining length in the fixed
+// header is rewritten, and only when the payload is shorter.
+typedef struct {
+	uint32_t payload_max; // payload bytes in every template
+	size_t   leaf_len;    // trailing topic bytes written per message
+} nnb_frame;
+
+// Copy of the encoded template tmpl carrying size payload bytes.
+int nnb_frame_copy(nnb_frame *f, nng_msg *tmpl, uint32_t size, nng_msg **mp);
+
+// The last leaf_len bytes of the topic of msg.
+char *nnb_frame_leaf(nnb_frame *f, nng_msg *msg);
+
+// The size payload bytes of msg, the tail of its body.
+static inline uint8_t *
+nnb_frame_payload(nng_msg *msg, uint32_t size)
+{
+	return ((uint8_t *) nng_msg_body(msg) + nng_msg_len(msg) - size);
+}
+
+#endif
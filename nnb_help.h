@@ -10,9 +10,22 @@ static char pub_info[] =
                        [-q [<qos>]] [-r [<retain>]]                \n\
                        [-k [<keepalive>]] [-C [<clean>]]           \n\
                        [-L [<limit>]] [-S [<ssl>]]                 \n\
+                       [--ws] [--ws-path <path>]                   \n\
+                       [--quic] [--quic-0rtt]                      \n\
                        [--certfile <certfile>]                     \n\
-                       [--keyfile <keyfile>] [--ws [<ws>]]         \n\
+                       [--keyfile <keyfile>]                       \n\
                        [--ifaddr <ifaddr>] [--prefix <prefix>]     \n\
+                       [--shard <k/n>]                             \n\
+                       [--size-dist <dist>] [--size-min <min>]     \n\
+                       [--size-max <max>] [--size-sigma <sigma>]   \n\
+                       [--size-file <file>] [--tree <fanouts>]     \n\
+                       [--stamp] [--crc] [--metrics-listen <addr>] \n\
+                       [--trace <n>] [--trace-file <file>]         \n\
+                       [--broker-pid <pid>] [--cred-file <file>]   \n\
+                       [--log-level <level>]                       \n\
+                       [--task-threads <n>] [--poller-threads <n>] \n\
+                       [--resolver-threads <n>] [--nng-auto]       \n\
+                       [--nng-cpus <list>]                         \n\
                                                                    \n\
   --help                 help information                          \n\
   -h, --host             mqtt server hostname or IP address        \n\
@@ -21,7 +34,7 @@ static char pub_info[] =
   -V, --version          mqtt protocol version: 3 | 4 | 5 [default:\n\
                          4]                                        \n\
   -c, --count            max count of clients [default: 200]       \n\
-  -n, --startnumber      start number [default: 0]                 \n\
+  -n, --startnumber      number of the first client id [default: 0]\n\
   -i, --interval         interval of connecting to the broker      \n\
                          [default: 10]                             \n\
   -I, --interval_of_msg  interval of publishing message(ms)        \n\
@@ -47,9 +60,58 @@ static char pub_info[] =
                          required by server                        \n\
   --keypass              client private key's password for         \n\
                          authentication                            \n\
-  --ws                   websocket transport [default: false]      \n\
+  --ws                   websocket transport, wss with --ssl       \n\
+                         [default: false]                          \n\
+  --ws-path              websocket endpoint path [default: /mqtt]  \n\
+  --quic                 mqtt over quic, needs a build with        \n\
+                         -DNNG_ENABLE_QUIC=ON [default: false]     \n\
+  --quic-0rtt            --quic, resuming the session with 0-RTT   \n\
+                         on redial                                 \n\
   --ifaddr               local ipaddress or interface address      \n\
-  --prefix               client id prefix                          \n\
+  --prefix               client id prefix, ids are <prefix><n>     \n\
+                         [default: nnb_pub_]                       \n\
+  --shard                k/n: run slice k of n of the -n/-c id     \n\
+                         range, so n processes never share an id   \n\
+  --size-dist            payload size distribution: fixed | uniform\n\
+                         | lognormal | file [default: fixed]       \n\
+  --size-min             smallest payload size [default: 0]        \n\
+  --size-max             largest payload size [default: --size for \n\
+                         uniform, 262144 for lognormal]            \n\
+  --size-sigma           lognormal shape, --size is the median     \n\
+                         [default: 1.0]                            \n\
+  --size-file            size histogram file, one \"<size> [weight]\"\n\
+                         per line, implies --size-dist file        \n\
+  --tree                 publish to random leaves of a generated   \n\
+                         topic tree under --topic, given as level  \n\
+                         fanouts, e.g. 10,10,10; level names are   \n\
+                         zero padded to one width, e.g. 00..99     \n\
+  --stamp                write publisher id, sequence and send time\n\
+                         into the first 24 bytes of each payload   \n\
+                         for subscriber latency                    \n\
+  --crc                  end each payload with its CRC32C, for sub \n\
+                         --crc to verify; payloads must be 4 bytes \n\
+                         or more, -s or --size-min with a size     \n\
+                         distribution                              \n\
+  --metrics-listen       serve OpenMetrics at http://<addr>/metrics,\n\
+                         e.g. 127.0.0.1:9100                       \n\
+  --trace                trace every n-th publish through render,  \n\
+                         stamp, submit and inflight stages         \n\
+                         [default: 0, off]                         \n\
+  --trace-file           Chrome trace JSON for --trace [default:   \n\
+                         nano_bench_pub_trace.json]                \n\
+  --broker-pid           also sample CPU and RSS of a local broker \n\
+                         for side-by-side efficiency numbers       \n\
+  --cred-file            clientid,username,password per line, one \n\
+                         row per client in order                   \n\
+  --log-level            err | warn | info | debug [default: info] \n\
+  --task-threads         nng task queue threads, which run the     \n\
+                         callbacks [default: 2 per core, max 16]   \n\
+  --poller-threads       nng socket poller threads [default: nng's]\n\
+  --resolver-threads     nng name resolver threads [default: nng's]\n\
+  --nng-cpus             pin nng threads round robin over a cpu    \n\
+                         list, e.g. 0-15,32-47                     \n\
+  --nng-auto             size the nng threads from the cores, or   \n\
+                         --nng-cpus, and -c; given counts win      \n\
 ";
 
 static char sub_info[] =
@@ -59,9 +121,25 @@ static char sub_info[] =
                        [-t <topic>] [-q [<qos>]] [-u <username>]    \n\
                        [-P <password>] [-k [<keepalive>]]           \n\
                        [-C [<clean>]] [-S [<ssl>]]                  \n\
+                       [--ws] [--ws-path <path>]                    \n\
+                       [--quic] [--quic-0rtt]                       \n\
                        [--certfile <certfile>]                      \n\
-                       [--keyfile <keyfile>] [--ws [<ws>]]          \n\
+                       [--keyfile <keyfile>]                        \n\
                        [--ifaddr <ifaddr>] [--prefix <prefix>]      \n\
+                       [--shard <k/n>]                              \n\
+                       [--tree <fanouts>] [--filters <n>]           \n\
+                       [--plus-ratio <pct>] [--hash-ratio <pct>]    \n\
+                       [--sub-batch <n>] [--share-groups <k>]       \n\
+                       [--share-members <m>] [--share-step <sec>]   \n\
+                       [--share-churn <sec>]                        \n\
+                       [--metrics-listen <addr>] [--trace <n>]      \n\
+                       [--trace-file <file>] [--broker-pid <pid>]   \n\
+                       [--cred-file <file>] [--raw]                 \n\
+                       [--threads <n>] [--crc]                      \n\
+                       [--log-level <level>]                        \n\
+                       [--task-threads <n>] [--poller-threads <n>]  \n\
+                       [--resolver-threads <n>] [--nng-auto]        \n\
+                       [--nng-cpus <list>]                          \n\
                                                                     \n\
   --help             help information                               \n\
   -h, --host         mqtt server hostname or IP address [default:   \n\
@@ -69,7 +147,7 @@ static char sub_info[] =
   -p, --port         mqtt server port number [default: 1883]        \n\
   -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
   -c, --count        max count of clients [default: 200]            \n\
-  -n, --startnumber  start number [default: 0]                      \n\
+  -n, --startnumber  number of the first client id [default: 0]     \n\
   -i, --interval     interval of connecting to the broker [default: \n\
                      10]                                            \n\
   -t, --topic        topic subscribe, support %u, %c, %i variables  \n\
@@ -88,9 +166,61 @@ static char sub_info[] =
                      required by server                             \n\
   --keypass          client private key's password for              \n\
                      authentication                                 \n\
-  --ws               websocket transport [default: false]           \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
   --ifaddr           local ipaddress or interface address           \n\
-  --prefix           client id prefix			            \n\
+  --prefix           client id prefix, ids are <prefix><n>          \n\
+                     [default: nnb_sub_]                            \n\
+  --shard            k/n: run slice k of n of the -n/-c id range,   \n\
+                     so n processes never share an id               \n\
+  --tree             generated topic tree under --topic, given as   \n\
+                     level fanouts, e.g. 10,10,10; level names are  \n\
+                     zero padded to one width, e.g. 00..99          \n\
+  --filters          filters per client generated against --tree,   \n\
+                     0 subscribes to --topic only [default: 0]      \n\
+  --plus-ratio       percent of filters with a '+' level [default: 0]\n\
+  --hash-ratio       percent of filters ending in '#' [default: 0]  \n\
+  --sub-batch        filters per SUBSCRIBE packet, 0 sends all in   \n\
+                     one packet [default: 0]                        \n\
+  --share-groups     start k $share/g<i>/<topic> consumer groups of \n\
+                     --share-members each, -c becomes k*m [default: 0]\n\
+  --share-members    members per shared group [default: 1]          \n\
+  --share-step       start with one member per group and add one    \n\
+                     every <sec> seconds up to --share-members      \n\
+  --share-churn      every <sec> seconds a random member leaves, or \n\
+                     the member that left rejoins                   \n\
+  --metrics-listen   serve OpenMetrics at http://<addr>/metrics, e.g.\n\
+                     127.0.0.1:9100                                 \n\
+  --trace            trace delivery of every n-th stamped message,  \n\
+                     use the same n as the publisher [default: 0]   \n\
+  --trace-file       Chrome trace JSON for --trace [default:        \n\
+                     nano_bench_sub_trace.json]                     \n\
+  --broker-pid       also sample CPU and RSS of a local broker for  \n\
+                     side-by-side efficiency numbers                \n\
+  --cred-file        clientid,username,password per line, one row   \n\
+                     per client in order                            \n\
+  --raw              qos 0 subscribers on plain tcp sockets that    \n\
+                     only parse the fixed header, topic length and  \n\
+                     stamp, for receive rates nng cannot keep up    \n\
+                     with; one -t without variables                 \n\
+  --threads          receiving threads for --raw [default: 2]       \n\
+  --crc              verify the CRC32C a pub --crc publisher ends   \n\
+                     each payload with, reporting corrupted counts  \n\
+                     per topic and per publisher                    \n\
+  --log-level        err | warn | info | debug [default: info]      \n\
+  --task-threads     nng task queue threads, which run the          \n\
+                     callbacks [default: 2 per core, max 16]        \n\
+  --poller-threads   nng socket poller threads [default: nng's]     \n\
+  --resolver-threads nng name resolver threads [default: nng's]     \n\
+  --nng-cpus         pin nng threads round robin over a cpu         \n\
+                     list, e.g. 0-15,32-47                          \n\
+  --nng-auto         size the nng threads from the cores, or        \n\
+                     --nng-cpus, and -c; given counts win           \n\
 ";
 
 static char conn_info[] =
@@ -100,8 +230,17 @@ static char conn_info[] =
                         [-u <username>] [-P <password>]             \n\
                         [-k [<keepalive>]] [-C [<clean>]]           \n\
                         [-S [<ssl>]] [--certfile <certfile>]        \n\
+                        [--ws] [--ws-path <path>]                   \n\
+                        [--quic] [--quic-0rtt] [--reconnect]        \n\
                         [--keyfile <keyfile>] [--ifaddr <ifaddr>]   \n\
-                        [--prefix <prefix>]                         \n\
+                        [--prefix <prefix>] [--shard <k/n>]         \n\
+                        [--metrics-listen <addr>]                   \n\
+                        [--will-topic <topic>] [--will-payload <msg>]\n\
+                        [--will-qos <qos>] [--will-retain]          \n\
+                        [--cred-file <file>] [--log-level <level>]  \n\
+                        [--task-threads <n>] [--poller-threads <n>] \n\
+                        [--resolver-threads <n>] [--nng-auto]       \n\
+                        [--nng-cpus <list>]                         \n\
                                                                     \n\
   --help             help information                               \n\
   -h, --host         mqtt server hostname or IP address [default:   \n\
@@ -109,7 +248,7 @@ static char conn_info[] =
   -p, --port         mqtt server port number [default: 1883]        \n\
   -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
   -c, --count        max count of clients [default: 200]            \n\
-  -n, --startnumber  start number [default: 0]                      \n\
+  -n, --startnumber  number of the first client id [default: 0]     \n\
   -i, --interval     interval of connecting to the broker [default: \n\
                      10]                                            \n\
   -u, --username     username for connecting to server              \n\
@@ -126,8 +265,552 @@ static char conn_info[] =
                      required by server                             \n\
   --keypass          client private key's password for              \n\
                      authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --reconnect        drop each connection once after its            \n\
+                     CONNACK and time the redial to the next        \n\
+                     CONNACK                                        \n\
   --ifaddr           local ipaddress or interface address           \n\
-  --prefix           client id prefix			            \n\
+  --prefix           client id prefix, ids are <prefix><n>          \n\
+                     [default: nnb_conn_]                           \n\
+  --shard            k/n: run slice k of n of the -n/-c id range,   \n\
+                     so n processes never share an id               \n\
+  --metrics-listen   serve OpenMetrics at http://<addr>/metrics, e.g.\n\
+                     127.0.0.1:9100                                 \n\
+  --will-topic       last will topic, %i is replaced by the client  \n\
+                     number [default: no will]                      \n\
+  --will-payload     last will payload [default: offline]           \n\
+  --will-qos         last will qos [default: 0]                     \n\
+  --will-retain      retain the last will [default: false]          \n\
+  --cred-file        clientid,username,password per line, one row   \n\
+                     per client in order                            \n\
+  --log-level        err | warn | info | debug [default: info]      \n\
+  --task-threads     nng task queue threads, which run the          \n\
+                     callbacks [default: 2 per core, max 16]        \n\
+  --poller-threads   nng socket poller threads [default: nng's]     \n\
+  --resolver-threads nng name resolver threads [default: nng's]     \n\
+  --nng-cpus         pin nng threads round robin over a cpu         \n\
+                     list, e.g. 0-15,32-47                          \n\
+  --nng-auto         size the nng threads from the cores, or        \n\
+                     --nng-cpus, and -c; given counts win           \n\
+";
+
+static char session_info[] =
+    "nano_bench session [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                           [-V [<version>]] [-c [<count>]]          \n\
+                           [-n [<startnumber>]] [-i [<interval>]]   \n\
+                           [-t <topic>] [-q [<qos>]] [-s [<size>]]  \n\
+                           [-u <username>] [-P <password>]          \n\
+                           [-k [<keepalive>]] [-S [<ssl>]]          \n\
+                           [--ws] [--ws-path <path>]                \n\
+                           [--quic] [--quic-0rtt]                   \n\
+                           [--queued <n>] [--publishers <n>]        \n\
+                           [--broker-pid <pid>] [--timeout <sec>]   \n\
+                                                                    \n\
+  Subscribers connect with clean session false, subscribe to        \n\
+  <topic>/<n> and disconnect. Publishers then queue --queued        \n\
+  messages per offline session and the subscribers reconnect to     \n\
+  drain them.                                                       \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        persistent sessions [default: 200]             \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic prefix [default: nnb/session]            \n\
+  -q, --qos          subscribe and publish qos: 1 | 2 [default: 1]  \n\
+  -s, --size         payload size [default: 256]                    \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --queued           messages queued per offline session            \n\
+                     [default: 100]                                 \n\
+  --publishers       publishing clients [default: 1]                \n\
+  --broker-pid       broker pid, to report its memory growth per    \n\
+                     queued message                                 \n\
+  --timeout          give up a phase after this many seconds        \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char retain_info[] =
+    "nano_bench retain [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                          [-V [<version>]] [-c [<count>]]           \n\
+                          [-n [<startnumber>]] [-i [<interval>]]    \n\
+                          [-t <topic>] [-q [<qos>]] [-s [<size>]]   \n\
+                          [-u <username>] [-P <password>]           \n\
+                          [-k [<keepalive>]] [-S [<ssl>]]           \n\
+                          [--ws] [--ws-path <path>]                 \n\
+                          [--quic] [--quic-0rtt]                    \n\
+                          [--topics <n>] [--publishers <n>]         \n\
+                          [--timeout <sec>]                         \n\
+                                                                    \n\
+  Publishes --topics retained messages to <topic>/<n>, then -c      \n\
+  subscribers to <topic>/# pull the whole retained set, then the    \n\
+  retained topics are cleared with zero-length payloads.            \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        subscribers [default: 200]                     \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic prefix [default: nnb/retain]             \n\
+  -q, --qos          publish and subscribe qos [default: 1]         \n\
+  -s, --size         payload size [default: 256]                    \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --topics           distinct retained topics [default: 10000]      \n\
+  --publishers       publishing clients [default: 1]                \n\
+  --timeout          give up a phase after this many seconds        \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char search_info[] =
+    "nano_bench search [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                          [-V [<version>]] [-c [<count>]]           \n\
+                          [-n [<startnumber>]] [-i [<interval>]]    \n\
+                          [-t <topic>] [-q [<qos>]] [-s [<size>]]   \n\
+                          [-u <username>] [-P <password>]           \n\
+                          [-k [<keepalive>]] [-S [<ssl>]]           \n\
+                          [--ws] [--ws-path <path>]                 \n\
+                          [--quic] [--quic-0rtt]                    \n\
+                          [--subscribers <n>] [--rate-start <rate>] \n\
+                          [--rate-max <rate>] [--hold <sec>]        \n\
+                          [--warmup <sec>] [--refine <n>]           \n\
+                          [--slo-p99 <ms>] [--slo-loss <pct>]       \n\
+                          [--timeout <sec>]                         \n\
+                                                                    \n\
+  Offers a paced publish rate to -t, doubling it from --rate-start  \n\
+  until the SLO breaks and then bisecting, and prints the knee and  \n\
+  the rate-vs-latency curve measured by the subscribers.            \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        publishers [default: 10]                       \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic [default: nnb/search]                    \n\
+  -q, --qos          publish and subscribe qos [default: 0]         \n\
+  -s, --size         payload size, at least 24 [default: 256]       \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --subscribers      subscribers measuring delivery [default: 1]    \n\
+  --rate-start       first offered rate in msg/sec [default: 1000]  \n\
+  --rate-max         highest offered rate [default: 1000000]        \n\
+  --hold             measured seconds per step [default: 10]        \n\
+  --warmup           unmeasured seconds before each step [default: 2]\n\
+  --refine           bisection steps after the ramp [default: 5]    \n\
+  --slo-p99          p99 delivery latency bound in ms [default: 20] \n\
+  --slo-loss         loss bound in percent [default: 0]             \n\
+  --timeout          give up subscribing after this many seconds    \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char churn_info[] =
+    "nano_bench churn [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                         [-V [<version>]] [-c [<count>]]            \n\
+                         [-n [<startnumber>]] [-i [<interval>]]     \n\
+                         [-t <topic>] [-q [<qos>]] [-s [<size>]]    \n\
+                         [-u <username>] [-P <password>]            \n\
+                         [-k [<keepalive>]] [-C [<clean>]]          \n\
+                         [-S [<ssl>]] [--churn <pct>] [--abrupt]    \n\
+                         [--ws] [--ws-path <path>]                  \n\
+                         [--quic] [--quic-0rtt]                     \n\
+                         [--rate <rate>] [--publishers <n>]         \n\
+                         [--duration <sec>] [--timeout <sec>]       \n\
+                                                                    \n\
+  Keeps -c subscribers on <topic>/<n> under a steady publish rate   \n\
+  while --churn percent of them reconnect every second, and prints  \n\
+  reconnect and resubscribe latency, loss and the latency of        \n\
+  messages delivered across a reconnect.                            \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        subscribers [default: 200]                     \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic prefix [default: nnb/churn]              \n\
+  -q, --qos          publish and subscribe qos [default: 1]         \n\
+  -s, --size         payload size, at least 24 [default: 256]       \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -C, --clean        clean session, false keeps the subscription    \n\
+                     across reconnects [default: true]              \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --churn            percent of subscribers reconnecting per second \n\
+                     [default: 1]                                   \n\
+  --abrupt           drop the connection without DISCONNECT         \n\
+  --rate             publishes per second over all subscribers      \n\
+                     [default: one per subscriber]                  \n\
+  --publishers       publishing clients [default: 1]                \n\
+  --duration         seconds to run, 0 until interrupted            \n\
+                     [default: 60]                                  \n\
+  --timeout          give up subscribing after this many seconds    \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char lwt_info[] =
+    "nano_bench lwt [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                       [-V [<version>]] [-c [<count>]]              \n\
+                       [-n [<startnumber>]] [-i [<interval>]]       \n\
+                       [-t <topic>] [-q [<qos>]]                    \n\
+                       [-u <username>] [-P <password>]              \n\
+                       [-k [<keepalive>]] [-S [<ssl>]]              \n\
+                       [--ws] [--ws-path <path>]                    \n\
+                       [--quic] [--quic-0rtt]                       \n\
+                       [--subscribers <n>] [--will-payload <msg>]   \n\
+                       [--will-qos <qos>] [--will-retain]           \n\
+                       [--timeout <sec>]                            \n\
+                                                                    \n\
+  Connects -c clients with a last will on <topic>/<n>, then drops   \n\
+  them all at once without DISCONNECT, like a network partition or  \n\
+  a crashed node. Subscribers on <topic>/+ report the time to the   \n\
+  last will and the will delivery rate.                             \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        clients dropped at once [default: 1000]        \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        will topic prefix [default: nnb/will]          \n\
+  -q, --qos          subscription qos [default: 1]                  \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --subscribers      subscribers waiting for the wills [default: 1] \n\
+  --will-payload     last will payload [default: offline]           \n\
+  --will-qos         last will qos [default: 1]                     \n\
+  --will-retain      retain the last wills [default: false]         \n\
+  --timeout          give up after this many seconds without        \n\
+                     progress [default: 30]                         \n\
+";
+
+static char resub_info[] =
+    "nano_bench resub [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                         [-V [<version>]] [-c [<count>]]            \n\
+                         [-n [<startnumber>]] [-i [<interval>]]     \n\
+                         [-t <topic>] [-q [<qos>]] [-s [<size>]]    \n\
+                         [-u <username>] [-P <password>]            \n\
+                         [-k [<keepalive>]] [-S [<ssl>]]            \n\
+                         [--ws] [--ws-path <path>]                  \n\
+                         [--quic] [--quic-0rtt]                     \n\
+                         [--filters <n>] [--sub-rate <rate>]        \n\
+                         [--rate <rate>] [--publishers <n>]         \n\
+                         [--warmup <sec>] [--duration <sec>]        \n\
+                         [--timeout <sec>]                          \n\
+                                                                    \n\
+  Each of -c clients keeps <topic>/steady/<n> under a steady publish\n\
+  rate, and --sub-rate times a second one of them swaps its other   \n\
+  filter for the next of --filters <topic>/rot/<n>/<k>/# filters    \n\
+  (UNSUBSCRIBE, then SUBSCRIBE). Prints SUBACK and UNSUBACK latency \n\
+  and the steady delivery latency before and during the changes.    \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port number [default: 1883]        \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        subscribing clients [default: 100]             \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic prefix [default: nnb/resub]              \n\
+  -q, --qos          publish and subscribe qos [default: 1]         \n\
+  -s, --size         payload size, at least 24 [default: 256]       \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  -S, --ssl          ssl socoket for connecting to server           \n\
+                     [default: false]                               \n\
+  --cafile           ca certificate for authentication, if          \n\
+                     required by server                             \n\
+  --certfile         client certificate for authentication, if      \n\
+                     required by server                             \n\
+  --keyfile          client private key for authentication, if      \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --ws               websocket transport, wss with --ssl            \n\
+                     [default: false]                               \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic             mqtt over quic, needs a build with             \n\
+                     -DNNG_ENABLE_QUIC=ON [default: false]          \n\
+  --quic-0rtt        --quic, resuming the session with 0-RTT        \n\
+                     on redial                                      \n\
+  --filters          filters in each client's ring [default: 16]    \n\
+  --sub-rate         filter changes per second over all clients     \n\
+                     [default: 100]                                 \n\
+  --rate             steady publishes per second over all clients   \n\
+                     [default: one per client]                      \n\
+  --publishers       publishing clients [default: 1]                \n\
+  --warmup           baseline seconds before the changes start      \n\
+                     [default: 10]                                  \n\
+  --duration         seconds of changes, 0 until interrupted        \n\
+                     [default: 60]                                  \n\
+  --timeout          give up subscribing after this many seconds    \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char transport_info[] =
+    "nano_bench transport [--help <help>] [-h [<host>]]\n\
+                         [-V [<version>]] [-c [<count>]]            \n\
+                         [-n [<startnumber>]] [-i [<interval>]]     \n\
+                         [-t <topic>] [-q [<qos>]] [-s [<size>]]    \n\
+                         [-u <username>] [-P <password>]            \n\
+                         [-k [<keepalive>]] [--transports <list>]   \n\
+                         [--tcp-port <port>] [--tls-port <port>]    \n\
+                         [--ws-port <port>] [--wss-port <port>]     \n\
+                         [--ws-path <path>] [--quic-port <port>]    \n\
+                         [--quic-0rtt] [--subscribers <n>]          \n\
+                         [--rate <rate>] [--warmup <sec>]           \n\
+                         [--duration <sec>] [--timeout <sec>]       \n\
+                                                                    \n\
+  Runs the same paced publish and subscribe workload over each of   \n\
+  --transports in turn and prints throughput, delivery latency and  \n\
+  bench CPU per published message for each, so the cost of TLS,     \n\
+  websocket framing and QUIC can be read off side by side.          \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        publishing clients [default: 1]                \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic [default: nnb/transport]                 \n\
+  -q, --qos          publish and subscribe qos [default: 0]         \n\
+  -s, --size         payload size, at least 24 [default: 256]       \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds [default: 300]           \n\
+  --transports       comma separated, of tcp | tls | ws | wss |     \n\
+                     quic [default: tcp,tls,ws,wss]                 \n\
+  --tcp-port         mqtt-tcp listener port [default: 1883]         \n\
+  --tls-port         mqtt over tls listener port [default: 8883]    \n\
+  --ws-port          websocket listener port [default: 8083]        \n\
+  --wss-port         websocket over tls listener port [default:     \n\
+                     8084]                                          \n\
+  --ws-path          websocket endpoint path [default: /mqtt]       \n\
+  --quic-port        mqtt over quic listener port [default:         \n\
+                     14567]                                         \n\
+  --quic-0rtt        resume the quic session with 0-RTT on          \n\
+                     redial                                         \n\
+  --cafile           ca certificate for tls and wss, if required by \n\
+                     server                                         \n\
+  --certfile         client certificate for tls and wss, if         \n\
+                     required by server                             \n\
+  --keyfile          client private key for tls and wss, if         \n\
+                     required by server                             \n\
+  --keypass          client private key's password for              \n\
+                     authentication                                 \n\
+  --subscribers      in-process subscribers measuring delivery      \n\
+                     [default: 1]                                   \n\
+  --rate             offered msg/sec over all publishers, 0 is      \n\
+                     unpaced [default: 1000]                        \n\
+  --warmup           unmeasured seconds per transport [default: 5]  \n\
+  --duration         measured seconds per transport [default: 10]   \n\
+  --timeout          give up subscribing after this many seconds    \n\
+                     without progress [default: 30]                 \n\
+";
+
+static char blast_info[] =
+    "nano_bench blast [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                         [-V [<version>]] [-c [<count>]]            \n\
+                         [-n [<startnumber>]] [-i [<interval>]]     \n\
+                         [-t <topic>] [-s [<size>]]                 \n\
+                         [-u <username>] [-P <password>]            \n\
+                         [-k [<keepalive>]] [--rate <rate>]         \n\
+                         [--batch <n>] [--threads <n>]              \n\
+                         [--duration <sec>] [--timeout <sec>]       \n\
+                         [--prefix <prefix>] [--shard <k/n>]        \n\
+                                                                    \n\
+  Opens -c plain TCP connections and floods QoS 0 PUBLISH frames    \n\
+  encoded once per connection, written in --batch sized writev      \n\
+  calls from --threads epoll loops, to find the broker's ingest     \n\
+  ceiling rather than the bench's. No TLS, no QoS 1/2 and no        \n\
+  delivery latency; use pub and sub for those.                      \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port [default: 1883]               \n\
+  -V, --version      mqtt protocol version: 3 | 4 | 5 [default: 4]  \n\
+  -c, --count        connections [default: 16]                      \n\
+  -n, --startnumber  start number [default: 0]                      \n\
+  -i, --interval     interval of connecting to the broker [default: \n\
+                     10]                                            \n\
+  -t, --topic        topic, %i is the connection number [default:   \n\
+                     nnb/blast/%i]                                  \n\
+  -s, --size         payload size [default: 16]                     \n\
+  -u, --username     username for connecting to server              \n\
+  -P, --password     password for connecting to server              \n\
+  -k, --keepalive    keep alive in seconds, 0 disables it [default: \n\
+                     0]                                             \n\
+  --rate             msg/sec over all connections, 0 is unpaced     \n\
+                     [default: 0]                                   \n\
+  --batch            frames per writev [default: 64]                \n\
+  --threads          sending threads [default: 4]                   \n\
+  --duration         seconds to send, 0 until interrupted [default: \n\
+                     30]                                            \n\
+  --timeout          give up connecting after this many seconds     \n\
+                     without progress [default: 30]                 \n\
+  --prefix           client id prefix, ids are <prefix><n>          \n\
+                     [default: nnb_blast_]                          \n\
+  --shard            k/n: run slice k of n of the -n/-c id range,   \n\
+                     so n processes never share an id               \n\
+";
+
+static char proxy_info[] =
+    "nano_bench proxy [--help <help>] [-h [<host>]] [-p [<port>]]\n\
+                         [-l [<listen>]] [--groups <n>]             \n\
+                         [--delay <ms>] [--jitter <ms>]             \n\
+                         [--up-rate <bytes>] [--down-rate <bytes>]  \n\
+                         [--drop <percent>] [--shared]              \n\
+                         [--rcvbuf <bytes>] [--threads <n>]         \n\
+                         [--duration <sec>]                         \n\
+                                                                    \n\
+  Relays every connection made to --listen on to the broker over an \n\
+  impaired link, so the other modes can be pointed at it. --delay   \n\
+  is added each way, so a round trip grows by twice it. TCP hides   \n\
+  single packet loss, so --drop resets the connection instead.      \n\
+  --down-rate with a small --rcvbuf plays a slow reader and lets    \n\
+  the broker see the backpressure. Connections are dealt round      \n\
+  robin into --groups; the impairment options take one value, or a  \n\
+  comma list with one value per group.                              \n\
+                                                                    \n\
+  --help             help information                               \n\
+  -h, --host         mqtt server hostname or IP address [default:   \n\
+                     localhost]                                     \n\
+  -p, --port         mqtt server port [default: 1883]               \n\
+  -l, --listen       port to accept clients on [default: 1884]      \n\
+  --groups           connection groups, at most 256 [default: 1]    \n\
+  --delay            ms added each way [default: 0]                 \n\
+  --jitter           up to this many ms more, at random [default: 0]\n\
+  --up-rate          bytes/sec client to broker, 0 uncapped         \n\
+                     [default: 0]                                   \n\
+  --down-rate        bytes/sec broker to client, 0 uncapped         \n\
+                     [default: 0]                                   \n\
+  --drop             percent chance a read resets the connection    \n\
+                     [default: 0]                                   \n\
+  --shared           rate caps are shared by a group, not per       \n\
+                     connection                                     \n\
+  --rcvbuf           socket receive buffer, 0 leaves the kernel's   \n\
+                     [default: 0]                                   \n\
+  --threads          relay threads [default: 2]                     \n\
+  --duration         seconds to run, 0 until interrupted [default:  \n\
+                     0]                                             \n\
 ";
 
 #endif
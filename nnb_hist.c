@@ -0,0 +1,187 @@
+#include "nnb_hist.h"
+#include <string.h>
+
+void
+nnb_hist_init(nnb_hist *h)
+{
+	for (int i = 0; i < NNB_HIST_BUCKETS; i++) {
+		atomic_init(&h->count[i], 0);
+	}
+	atomic_init(&h->total, 0);
+	atomic_init(&h->sum, 0);
+	atomic_init(&h->min, UINT64_MAX);
+	atomic_init(&h->max, 0);
+}
+
+int
+nnb_hist_index(uint64_t v)
+{
+	if (v < NNB_HIST_SUB) {
+		return ((int) v);
+	}
+	int msb = 63 - __builtin_clzll(v);
+	int sub = (int) (v >> (msb - NNB_HIST_SUB_BITS)) & (NNB_HIST_SUB - 1);
+	return ((msb - NNB_HIST_SUB_BITS + 1) * NNB_HIST_SUB + sub);
+}
+
+uint64_t
+nnb_hist_bucket_low(int idx)
+{
+	if (idx < NNB_HIST_SUB) {
+		return ((uint64_t) idx);
+	}
+	int msb = idx / NNB_HIST_SUB + NNB_HIST_SUB_BITS - 1;
+	int sub = idx % NNB_HIST_SUB;
+	return ((uint64_t) (NNB_HIST_SUB + sub) << (msb - NNB_HIST_SUB_BITS));
+}
+
+uint64_t
+nnb_hist_bucket_high(int idx)
+{
+	if (idx < NNB_HIST_SUB) {
+		return ((uint64_t) idx);
+	}
+	int msb = idx / NNB_HIST_SUB + NNB_HIST_SUB_BITS - 1;
+	return (nnb_hist_bucket_low(idx) +
+	    ((uint64_t) 1 << (msb - NNB_HIST_SUB_BITS)) - 1);
+}
+
+void
+nnb_hist_add(nnb_hist *h, uint64_t v)
+{
+	uint64_t m;
+
+	atomic_fetch_add_explicit(
+	    &h->count[nnb_hist_index(v)], 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->total, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->sum, v, memory_order_relaxed);
+
+	m = atomic_load_explicit(&h->min, memory_order_relaxed);
+	while (v < m &&
+	    !atomic_compare_exchange_weak_explicit(&h->min, &m, v,
+	        memory_order_relaxed, memory_order_relaxed))
+		;
+	m = atomic_load_explicit(&h->max, memory_order_relaxed);
+	while (v > m &&
+	    !atomic_compare_exchange_weak_explicit(&h->max, &m, v,
+	        memory_order_relaxed, memory_order_relaxed))
+		;
+}
+
+void
+nnb_hist_merge(nnb_hist *dst, nnb_hist *src)
+{
+	uint64_t v;
+
+	for (int i = 0; i < NNB_HIST_BUCKETS; i++) {
+		v = atomic_load_explicit(&src->count[i], memory_order_relaxed);
+		if (v != 0) {
+			atomic_fetch_add_explicit(
+			    &dst->count[i], v, memory_order_relaxed);
+		}
+	}
+	atomic_fetch_add(&dst->total, atomic_load(&src->total));
+	atomic_fetch_add(&dst->sum, atomic_load(&src->sum));
+	v = atomic_load(&src->min);
+	if (v < atomic_load(&dst->min)) {
+		atomic_store(&dst->min, v);
+	}
+	v = atomic_load(&src->max);
+	if (v > atomic_load(&dst->max)) {
+		atomic_store(&dst->max, v);
+	}
+}
+
+uint64_t
+nnb_hist_total(nnb_hist *h)
+{
+	return (atomic_load_explicit(&h->total, memory_order_relaxed));
+}
+
+double
+nnb_hist_mean(nnb_hist *h)
+{
+	uint64_t n = nnb_hist_total(h);
+	return (n == 0 ? 0.0 : (double) atomic_load(&h->sum) / n);
+}
+
+uint64_t
+nnb_hist_percentile(nnb_hist *h, double p)
+{
+	uint64_t n = nnb_hist_total(h);
+	uint64_t rank;
+	uint64_t seen = 0;
+
+	if (n == 0) {
+		return (0);
+	}
+	rank = (uint64_t) (p / 100.0 * n);
+	if (rank >= n) {
+		rank = n - 1;
+	}
+	for (int i = 0; i < NNB_HIST_BUCKETS; i++) {
+		seen += atomic_load_explicit(
+		    &h->count[i], memory_order_relaxed);
+		if (seen > rank) {
+			uint64_t hi = nnb_hist_bucket_high(i);
+			uint64_t mx = atomic_load(&h->max);
+			return (hi < mx ? hi : mx);
+		}
+	}
+	return (atomic_load(&h->max));
+}
+
+void
+nnb_hist_summary(nnb_hist *h, const char *name, const char *unit)
+{
+	uint64_t n = nnb_hist_total(h);
+
+	if (n == 0) {
+		printf("%s: no samples\n", name);
+		return;
+	}
+	printf("%s(%s): count=%llu, min=%llu, avg=%.1f, p50=%llu, "
+	       "p90=%llu, p99=%llu, p999=%llu, max=%llu\n",
+	    name, unit, (unsigned long long) n,
+	    (unsigned long long) atomic_load(&h->min), nnb_hist_mean(h),
+	    (unsigned long long) nnb_hist_percentile(h, 50),
+	    (unsigned long long) nnb_hist_percentile(h, 90),
+	    (unsigned long long) nnb_hist_percentile(h, 99),
+	    (unsigned long long) nnb_hist_percentile(h, 99.9),
+	    (unsigned long long) atomic_load(&h->max));
+}
+
+void
+nnb_hist_print(nnb_hist *h, const char *name, const char *unit)
+{
+	uint64_t n = nnb_hist_total(h);
+	uint64_t group[64];
+	char     bar[41];
+
+	nnb_hist_summary(h, name, unit);
+	if (n == 0) {
+		return;
+	}
+
+	memset(group, 0, sizeof(group));
+	for (int i = 0; i < NNB_HIST_BUCKETS; i++) {
+		uint64_t low = nnb_hist_bucket_low(i);
+		int      g   = low == 0 ? 0 : 64 - __builtin_clzll(low);
+		group[g] += atomic_load_explicit(
+		    &h->count[i], memory_order_relaxed);
+	}
+	for (int g = 0; g < 64; g++) {
+		if (group[g] == 0) {
+			continue;
+		}
+		uint64_t lo  = g == 0 ? 0 : (uint64_t) 1 << (g - 1);
+		uint64_t hi  = g == 0 ? 0 : ((uint64_t) 1 << g) - 1;
+		double   pct = 100.0 * group[g] / n;
+		int      len = (int) (pct * 40 / 100 + 0.5);
+		memset(bar, '#', len);
+		bar[len] = '\0';
+		printf("  [%10llu, %10llu] %12llu %6.2f%% %s\n",
+		    (unsigned long long) lo, (unsigned long long) hi,
+		    (unsigned long long) group[g], pct, bar);
+	}
+}
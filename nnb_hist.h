@@ -0,0 +1,39 @@
+#ifndef NNB_HIST_H
+#define NNB_HIST_H
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Log-linear histogram: values below 8 are exact, above that every power
+// of two is split into 8 linear sub-buckets (~12.5% relative error).
+// All updates are relaxed atomics so callbacks on any nng thread can
+// record without taking a lock.
+#define NNB_HIST_SUB_BITS 3
+#define NNB_HIST_SUB (1 << NNB_HIST_SUB_BITS)
+#define NNB_HIST_BUCKETS ((64 - NNB_HIST_SUB_BITS + 1) * NNB_HIST_SUB)
+
+typedef struct {
+	atomic_uint_fast64_t count[NNB_HIST_BUCKETS];
+	atomic_uint_fast64_t total;
+	atomic_uint_fast64_t sum;
+	atomic_uint_fast64_t min;
+	atomic_uint_fast64_t max;
+} nnb_hist;
+
+void     nnb_hist_init(nnb_hist *h);
+void     nnb_hist_add(nnb_hist *h, uint64_t v);
+void     nnb_hist_merge(nnb_hist *dst, nnb_hist *src);
+uint64_t nnb_hist_total(nnb_hist *h);
+uint64_t nnb_hist_percentile(nnb_hist *h, double p);
+double   nnb_hist_mean(nnb_hist *h);
+int      nnb_hist_index(uint64_t v);
+uint64_t nnb_hist_bucket_low(int idx);
+uint64_t nnb_hist_bucket_high(int idx);
+
+// One-line summary: count, min, mean, p50, p90, p99, p999, max.
+void nnb_hist_summary(nnb_hist *h, const char *name, const char *unit);
+
+// Bar chart grouped by powers of two.
+void nnb_hist_print(nnb_hist *h, const char *name, const char *unit);
+
+#endif
@@ -0,0 +1,51 @@
+#include "nnb_id.h"
+#include <nng/nng.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+int
+nnb_ids_init(nnb_ids *ids, const char *prefix, int start, int count)
+{
+	char   last[16];
+	size_t plen = strlen(prefix);
+	int    digits;
+
+	memset(ids, 0, sizeof(*ids));
+	if (count <= 0) {
+		return (0);
+	}
+	// the highest number has the most digits
+	digits      = snprintf(last, sizeof(last), "%d", start + count - 1);
+	ids->stride = plen + digits + 1;
+	if ((ids->buf = nng_alloc(ids->stride * count)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	for (int i = 0; i < count; i++) {
+		char *p = ids->buf + (size_t) i * ids->stride;
+		memcpy(p, prefix, plen);
+		snprintf(p + plen, ids->stride - plen, "%d", start + i);
+	}
+	ids->start = start;
+	ids->count = count;
+	return (0);
+}
+
+int
+nnb_ids_shard(const char *shard, int *start, int *count)
+{
+	int     k;
+	int     n;
+	int64_t lo;
+	int64_t hi;
+
+	if (sscanf(shard, "%d/%d", &k, &n) != 2 || n < 1 || k < 0 ||
+	    k >= n) {
+		return (-1);
+	}
+	lo     = (int64_t) *count * k / n;
+	hi     = (int64_t) *count * (k + 1) / n;
+	*start = *start + (int) lo;
+	*count = (int) (hi - lo);
+	return (0);
+}
@@ -0,0 +1,32 @@
+#ifndef NNB_ID_H
+#define NNB_ID_H
+#include <stddef.h>
+
+// Client ids <prefix><n> for n in [start, start + count), rendered once
+// into one fixed-stride arena so every CONNECT and every %c expansion
+// of client n use the same bytes.
+typedef struct {
+	char * buf;
+	size_t stride; // bytes per id including the NUL
+	int    start;
+	int    count;
+} nnb_ids;
+
+int nnb_ids_init(nnb_ids *ids, const char *prefix, int start, int count);
+
+// Id of client n, NULL when n is outside the arena.
+static inline const char *
+nnb_ids_get(nnb_ids *ids, int n)
+{
+	if (n < ids->start || n - ids->start >= ids->count) {
+		return (NULL);
+	}
+	return (ids->buf + (size_t) (n - ids->start) * ids->stride);
+}
+
+// Narrows [*start, *start + *count) to slice k of n for a "k/n" shard
+// argument. Slices are contiguous and disjoint and together cover the
+// range, so n processes given 0/n .. n-1/n never share an id.
+int nnb_ids_shard(const char *shard, int *start, int *count);
+
+#endif
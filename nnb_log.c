@@ -0,0 +1,224 @@
+#include "nnb_log.h"
+#include "nnb_util.h"
+#include <nng/nng.h>
+#include <nng/supplemental/util/platform.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LOG_SLOTS 1024 // power of two
+#define LOG_LINE 256   // longer lines are cut
+#define LOG_POLL_MS 20
+#define LOG_BATCH (64 * 1024)
+
+// Bounded multi-producer ring: a producer claims a position with a CAS
+// on head, formats into the slot and publishes it by setting seq to
+// pos + 1. The writer thread owns tail and hands the slot back for the
+// next lap by setting seq to tail + LOG_SLOTS.
+typedef struct {
+	atomic_size_t seq;
+	char          line[LOG_LINE];
+} log_slot;
+
+atomic_uint_fast64_t nnb_log_events[NNB_EV_COUNT];
+
+static const char *log_ev_names[NNB_EV_COUNT] = {
+	[NNB_EV_CONNECTED]    = "connected",
+	[NNB_EV_DISCONNECTED] = "disconnected",
+};
+
+static const char *log_level_names[] = { "err", "warn", "info", "debug" };
+
+static log_slot             log_ring[LOG_SLOTS];
+static atomic_size_t        log_head;
+static size_t               log_tail;
+static atomic_int           log_level = NNB_LOG_INFO;
+static atomic_bool          log_running;
+static atomic_bool          log_quit;
+static atomic_int           log_taken;   // lines this second
+static atomic_uint_fast64_t log_dropped; // over the rate or ring full
+static uint64_t             log_last[NNB_EV_COUNT];
+static char                 log_buf[LOG_BATCH];
+static nng_thread *         log_thr;
+
+int
+nnb_log_level_parse(const char *name)
+{
+	for (int i = 0; i < (int) (sizeof(log_level_names) /
+	                         sizeof(log_level_names[0]));
+	     i++) {
+		if (strcmp(name, log_level_names[i]) == 0) {
+			return (i);
+		}
+	}
+	return (-1);
+}
+
+void
+nnb_log_set_level(int level)
+{
+	atomic_store(&log_level, level);
+}
+
+void
+nnb_log(int level, const char *fmt, ...)
+{
+	va_list   ap;
+	log_slot *s;
+	size_t    pos;
+	intptr_t  diff;
+	int       n;
+
+	if (level > atomic_load_explicit(&log_level, memory_order_relaxed)) {
+		return;
+	}
+	va_start(ap, fmt);
+	if (!atomic_load_explicit(&log_running, memory_order_acquire)) {
+		vfprintf(stderr, fmt, ap);
+		va_end(ap);
+		return;
+	}
+	// checked before formatting, so a flood costs one increment a line
+	if (atomic_fetch_add_explicit(&log_taken, 1, memory_order_relaxed) >=
+	    NNB_LOG_RATE) {
+		++log_dropped;
+		va_end(ap);
+		return;
+	}
+	pos = atomic_load_explicit(&log_head, memory_order_relaxed);
+	for (;;) {
+		s    = &log_ring[pos & (LOG_SLOTS - 1)];
+		diff = (intptr_t) atomic_load_explicit(
+		           &s->seq, memory_order_acquire) -
+		    (intptr_t) pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&log_head,
+			        &pos, pos + 1, memory_order_relaxed,
+			        memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			// the writer is a lap behind, never wait for it
+			++log_dropped;
+			va_end(ap);
+			return;
+		} else {
+			pos = atomic_load_explicit(
+			    &log_head, memory_order_relaxed);
+		}
+	}
+	n = vsnprintf(s->line, LOG_LINE, fmt, ap);
+	va_end(ap);
+	if (n >= LOG_LINE) {
+		s->line[LOG_LINE - 2] = '\n';
+	}
+	atomic_store_explicit(&s->seq, pos + 1, memory_order_release);
+}
+
+// Writes out every published slot, batched into few writes.
+static void
+log_drain(void)
+{
+	size_t len = 0;
+
+	for (;;) {
+		log_slot *s = &log_ring[log_tail & (LOG_SLOTS - 1)];
+		size_t    l;
+
+		if (atomic_load_explicit(&s->seq, memory_order_acquire) !=
+		    log_tail + 1) {
+			break;
+		}
+		l = strlen(s->line);
+		if (len + l > sizeof(log_buf)) {
+			fwrite(log_buf, 1, len, stderr);
+			len = 0;
+		}
+		memcpy(log_buf + len, s->line, l);
+		len += l;
+		atomic_store_explicit(
+		    &s->seq, log_tail + LOG_SLOTS, memory_order_release);
+		log_tail++;
+	}
+	if (len > 0) {
+		fwrite(log_buf, 1, len, stderr);
+	}
+}
+
+// The once-a-second lines: event counts since the last one, and the
+// log lines that were dropped.
+static void
+log_tick(void)
+{
+	char     line[LOG_LINE];
+	size_t   len = 0;
+	uint64_t dropped;
+
+	for (int i = 0; i < NNB_EV_COUNT; i++) {
+		uint64_t c = nnb_log_events[i];
+		uint64_t d = c - log_last[i];
+
+		log_last[i] = c;
+		if (d > 0 && len < sizeof(line)) {
+			len += snprintf(line + len, sizeof(line) - len,
+			    "%s+%llu %s", len > 0 ? ", " : "",
+			    (unsigned long long) d, log_ev_names[i]);
+		}
+	}
+	if (len > 0) {
+		printf("%s in last second\n", line);
+	}
+	atomic_store_explicit(&log_taken, 0, memory_order_relaxed);
+	if ((dropped = atomic_exchange(&log_dropped, 0)) > 0) {
+		fprintf(stderr,
+		    "[WARN] %llu log lines dropped in last second\n",
+		    (unsigned long long) dropped);
+	}
+}
+
+static void
+log_loop(void *arg)
+{
+	uint64_t next = nnb_clock_us() + 1000000;
+
+	(void) arg;
+	while (!atomic_load(&log_quit)) {
+		log_drain();
+		if (nnb_clock_us() >= next) {
+			log_tick();
+			next += 1000000;
+		}
+		nng_msleep(LOG_POLL_MS);
+	}
+	log_drain();
+	log_tick();
+}
+
+int
+nnb_log_start(void)
+{
+	int rv;
+
+	for (size_t i = 0; i < LOG_SLOTS; i++) {
+		atomic_init(&log_ring[i].seq, i);
+	}
+	if ((rv = nng_thread_create(&log_thr, log_loop, NULL)) != 0) {
+		return (rv);
+	}
+	atomic_store(&log_running, true);
+	atexit(nnb_log_stop);
+	return (0);
+}
+
+void
+nnb_log_stop(void)
+{
+	if (!atomic_exchange(&log_running, false)) {
+		return;
+	}
+	atomic_store(&log_quit, true);
+	nng_thread_destroy(log_thr);
+	fflush(stdout);
+}
@@ -0,0 +1,48 @@
+#ifndef NNB_LOG_H
+#define NNB_LOG_H
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Logging off the nng callback threads. Once nnb_log_start has run,
+// log_err, log_warn and log_info from dbg.h format into a fixed ring
+// that one background thread writes out; a callback never blocks on a
+// lock or on the terminal. At most NNB_LOG_RATE lines a second are
+// taken, and lines over that or arriving with the ring full are only
+// counted. Before nnb_log_start and after nnb_log_stop the macros
+// write to stderr directly, as option parsing and setup expect.
+#define NNB_LOG_RATE 100 // lines per second
+
+enum { NNB_LOG_ERR, NNB_LOG_WARN, NNB_LOG_INFO, NNB_LOG_DEBUG };
+
+// Connection events are not logged one by one but counted, and the
+// background thread prints one line a second for all of them, e.g.
+// "+3124 connected, +12 disconnected in last second".
+typedef enum {
+	NNB_EV_CONNECTED,
+	NNB_EV_DISCONNECTED,
+	NNB_EV_COUNT,
+} nnb_log_ev;
+
+extern atomic_uint_fast64_t nnb_log_events[NNB_EV_COUNT];
+
+static inline void
+nnb_log_event(nnb_log_ev ev)
+{
+	atomic_fetch_add_explicit(
+	    &nnb_log_events[ev], 1, memory_order_relaxed);
+}
+
+// err | warn | info | debug, -1 for anything else.
+int  nnb_log_level_parse(const char *name);
+void nnb_log_set_level(int level);
+
+// Starts the writer thread; nnb_log_stop writes out what is left and
+// the last event counts. Stopping twice is harmless, and exit() stops
+// it too.
+int  nnb_log_start(void);
+void nnb_log_stop(void);
+
+void nnb_log(int level, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif
@@ -0,0 +1,277 @@
+#include "nnb_lwt.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <stdatomic.h>
+
+#define LWT_ID_LEN 64
+
+// A subscriber handles its deliveries on one aio, so seen needs no
+// locking. The first completion is the SUBACK.
+typedef struct {
+	nng_socket sock;
+	nng_aio *  aio;
+	nng_ctx    ctx;
+	bool       subscribe; // completion is for the SUBSCRIBE
+	uint8_t *  seen;      // per dropped client, its will arrived
+} lwt_sub;
+
+static struct {
+	nnb_lwt_opt * opt;
+	nng_socket *  socks; // clients carrying a will
+	lwt_sub *     subs;
+	atomic_int    connected;
+	atomic_int    subacked;
+	atomic_int    wills; // first delivery of a will to a subscriber
+	atomic_int    dups;
+	atomic_int    early; // delivered before the drop, e.g. retained
+	atomic_int    stray; // not on <topic>/<n>
+	atomic_ullong drop_us;
+	atomic_ullong first_us;
+	atomic_ullong last_us;
+	nnb_hist      will_hist; // drop to delivery, usec
+} lwt;
+
+static void
+lwt_connect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	++lwt.connected;
+}
+
+static void
+lwt_disconnect_cb(nng_pipe p, nng_pipe_ev ev, void *arg)
+{
+	--lwt.connected;
+}
+
+// Client number of a will on <topic>/<n>, or -1.
+static int
+lwt_index(nng_msg *msg)
+{
+	nnb_lwt_opt *opt  = lwt.opt;
+	size_t       plen = strlen(opt->topic);
+	const char * topic;
+	uint32_t     len;
+	int          n = 0;
+
+	topic = nng_mqtt_msg_get_publish_topic(msg, &len);
+	if (topic == NULL || len <= plen + 1 ||
+	    strncmp(topic, opt->topic, plen) != 0 || topic[plen] != '/') {
+		return (-1);
+	}
+	for (uint32_t i = plen + 1; i < len; i++) {
+		if (topic[i] < '0' || topic[i] > '9' || n > INT32_MAX / 10) {
+			return (-1);
+		}
+		n = n * 10 + topic[i] - '0';
+	}
+	n -= opt->startnumber;
+	return (n >= 0 && n < opt->count ? n : -1);
+}
+
+static void
+lwt_sub_cb(void *arg)
+{
+	lwt_sub *s = arg;
+	nng_msg *msg;
+	uint64_t now;
+	uint64_t drop;
+	uint64_t v;
+	int      n;
+	int      rv;
+
+	if ((rv = nng_aio_result(s->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("lwt_sub_cb", rv);
+		nng_ctx_recv(s->ctx, s->aio);
+		return;
+	}
+	msg = nng_aio_get_msg(s->aio);
+	nng_aio_set_msg(s->aio, NULL);
+	if (s->subscribe) {
+		s->subscribe = false;
+		++lwt.subacked;
+	} else if (msg != NULL) {
+		now  = nnb_clock_us();
+		drop = lwt.drop_us;
+		if (drop == 0) {
+			++lwt.early;
+		} else if ((n = lwt_index(msg)) < 0) {
+			++lwt.stray;
+		} else if (s->seen[n]) {
+			++lwt.dups;
+		} else {
+			s->seen[n] = 1;
+			++lwt.wills;
+			nnb_hist_add(&lwt.will_hist, now - drop);
+			v = 0;
+			atomic_compare_exchange_strong(&lwt.first_us, &v, now);
+			v = atomic_load(&lwt.last_us);
+			while (v < now &&
+			    !atomic_compare_exchange_weak(
+			        &lwt.last_us, &v, now))
+				;
+		}
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+	nng_ctx_recv(s->ctx, s->aio);
+}
+
+static int
+lwt_subscribe(lwt_sub *s, int index)
+{
+	nnb_lwt_opt *opt = lwt.opt;
+	nng_msg *    msg;
+	char         buf[LWT_ID_LEN + NNB_TOPIC_LEN];
+	int          rv;
+
+	if ((rv = nnb_client_open(
+	         &s->sock, opt->host, opt->port, &opt->tls)) != 0 ||
+	    (rv = nng_aio_alloc(&s->aio, lwt_sub_cb, s)) != 0 ||
+	    (rv = nng_ctx_open(&s->ctx, s->sock)) != 0) {
+		nng_fatal("lwt_subscribe", rv);
+		return (rv);
+	}
+	if ((s->seen = nng_alloc(opt->count)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	memset(s->seen, 0, opt->count);
+
+	msg = nnb_connect_msg(
+	    opt->keepalive, true, opt->username, opt->password);
+	snprintf(buf, sizeof(buf), "nnb_lwt_sub_%d", index);
+	nng_mqtt_msg_set_connect_client_id(msg, buf);
+	nnb_dial(s->sock, opt->host, opt->port, &opt->tls, msg);
+
+	snprintf(buf, sizeof(buf), "%s/+", opt->topic);
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) buf,
+		        .length     = strlen(buf) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	s->subscribe = true;
+	nng_aio_set_msg(s->aio, msg);
+	nng_ctx_send(s->ctx, s->aio);
+	return (0);
+}
+
+static void
+lwt_report(double drop_s)
+{
+	nnb_lwt_opt *opt    = lwt.opt;
+	int          expect = opt->count * opt->subscribers;
+	int          wills  = lwt.wills;
+	uint64_t     drop   = lwt.drop_us;
+	uint64_t     first  = lwt.first_us;
+	uint64_t     last   = lwt.last_us;
+
+	printf("\n");
+	printf("drop: %d connections closed without DISCONNECT in %.3fs\n",
+	    opt->count, drop_s);
+	printf("wills: %d/%d delivered to %d subscribers, %d missing, %d "
+	       "duplicated\n",
+	    wills, expect, opt->subscribers, expect - wills, (int) lwt.dups);
+	if (lwt.early > 0 || lwt.stray > 0) {
+		printf("wills: %d delivered before the drop, %d on other "
+		       "topics\n",
+		    (int) lwt.early, (int) lwt.stray);
+	}
+	if (wills > 0) {
+		printf("wills: first after %.3fs, last after %.3fs\n",
+		    (first - drop) / 1e6, (last - drop) / 1e6);
+		printf("wills: rate=%.0f(wills/sec) from the drop, "
+		       "%.0f(wills/sec) first to last\n",
+		    wills * 1e6 / (last - drop),
+		    last > first ? (wills - 1) * 1e6 / (last - first) : 0.0);
+		nnb_hist_summary(&lwt.will_hist, "drop to will", "usec");
+	}
+}
+
+int
+nnb_lwt_run(nnb_lwt_opt *opt)
+{
+	will_opt will;
+	nng_msg *msg;
+	char     id[LWT_ID_LEN];
+	char     topic[NNB_TOPIC_LEN];
+	uint64_t t0;
+	double   drop_s;
+	int      rv;
+
+	lwt.opt   = opt;
+	lwt.socks = nng_alloc(sizeof(nng_socket) * opt->count);
+	lwt.subs  = nng_alloc(sizeof(lwt_sub) * opt->subscribers);
+	if (lwt.socks == NULL || lwt.subs == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(lwt.subs, 0, sizeof(lwt_sub) * opt->subscribers);
+	nnb_hist_init(&lwt.will_hist);
+
+	// 1. subscribers waiting for the wills
+	for (int i = 0; i < opt->subscribers; i++) {
+		if ((rv = lwt_subscribe(&lwt.subs[i], opt->startnumber + i)) !=
+		    0) {
+			return (rv);
+		}
+	}
+	if (!nnb_wait(&lwt.subacked, opt->subscribers, "subscribed",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+
+	// 2. clients whose will is <topic>/<n>
+	snprintf(topic, sizeof(topic), "%s/%%i", opt->topic);
+	will       = opt->will;
+	will.topic = topic;
+	for (int i = 0; i < opt->count; i++) {
+		if ((rv = nnb_client_open(&lwt.socks[i], opt->host,
+		         opt->port, &opt->tls)) != 0) {
+			nng_fatal("nng_socket", rv);
+			return (rv);
+		}
+		msg = nnb_connect_msg(
+		    opt->keepalive, true, opt->username, opt->password);
+		snprintf(id, sizeof(id), "nnb_lwt_%d", opt->startnumber + i);
+		nng_mqtt_msg_set_connect_client_id(msg, id);
+		nnb_connect_will(msg, &will, opt->startnumber + i);
+		nnb_dial_cb(lwt.socks[i], opt->host, opt->port, &opt->tls,
+		    msg, lwt_connect_cb, lwt_disconnect_cb, NULL);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&lwt.connected, opt->count, "connected",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+	nng_msleep(1000);
+
+	// 3. drop them all at once; the broker sees the sockets close
+	// without a DISCONNECT and must publish every will
+	t0          = nnb_clock_us();
+	lwt.drop_us = t0;
+	for (int i = 0; i < opt->count; i++) {
+		nng_close(lwt.socks[i]);
+	}
+	drop_s = (nnb_clock_us() - t0) / 1e6;
+
+	nnb_wait(&lwt.wills, opt->count * opt->subscribers, "wills",
+	    opt->timeout);
+	lwt_report(drop_s);
+
+	for (int i = 0; i < opt->subscribers; i++) {
+		nng_close(lwt.subs[i].sock);
+		nng_aio_free(lwt.subs[i].aio);
+		nng_free(lwt.subs[i].seen, opt->count);
+	}
+	return (lwt.wills >= opt->count * opt->subscribers ? 0
+	                                                   : NNG_ETIMEDOUT);
+}
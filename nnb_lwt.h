@@ -0,0 +1,11 @@
+#ifndef NNB_LWT_H
+#define NNB_LWT_H
+#include "nnb_opt.h"
+
+// Last-will storm: -c clients connect with a will on <topic>/<n>, then
+// all of them drop their connections at once without DISCONNECT, as in
+// a network partition or a node crash. --subscribers clients on
+// <topic>/+ time how fast the broker delivers every will.
+int nnb_lwt_run(nnb_lwt_opt *opt);
+
+#endif
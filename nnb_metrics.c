@@ -0,0 +1,251 @@
+#include "nnb_metrics.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include <nng/nng.h>
+#include <nng/supplemental/http/http.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+	METRIC_COUNTER,
+	METRIC_COUNTER64,
+	METRIC_GAUGE,
+	METRIC_HIST,
+} metric_kind;
+
+typedef struct {
+	metric_kind kind;
+	const char *name;
+	const char *help;
+	double      scale;
+	union {
+		atomic_int *   i;
+		atomic_ullong *u;
+		nnb_hist *     h;
+	} v;
+} metric;
+
+typedef struct {
+	char * buf;
+	size_t len;
+	size_t cap;
+} metric_buf;
+
+static metric           metrics[NNB_METRICS_MAX];
+static int              metric_cnt = 0;
+static nng_http_server *server     = NULL;
+
+static metric *
+metric_add(metric_kind kind, const char *name, const char *help)
+{
+	metric *m;
+
+	if (metric_cnt >= NNB_METRICS_MAX) {
+		log_warn("too many metrics, %s dropped", name);
+		return (NULL);
+	}
+	m        = &metrics[metric_cnt++];
+	m->kind  = kind;
+	m->name  = name;
+	m->help  = help;
+	m->scale = 1;
+	return (m);
+}
+
+void
+nnb_metrics_counter(const char *name, const char *help, atomic_int *v)
+{
+	metric *m;
+
+	if ((m = metric_add(METRIC_COUNTER, name, help)) != NULL) {
+		m->v.i = v;
+	}
+}
+
+void
+nnb_metrics_counter64(const char *name, const char *help, atomic_ullong *v)
+{
+	metric *m;
+
+	if ((m = metric_add(METRIC_COUNTER64, name, help)) != NULL) {
+		m->v.u = v;
+	}
+}
+
+void
+nnb_metrics_gauge(const char *name, const char *help, atomic_int *v)
+{
+	metric *m;
+
+	if ((m = metric_add(METRIC_GAUGE, name, help)) != NULL) {
+		m->v.i = v;
+	}
+}
+
+void
+nnb_metrics_hist(
+    const char *name, const char *help, nnb_hist *h, double scale)
+{
+	metric *m;
+
+	if ((m = metric_add(METRIC_HIST, name, help)) != NULL) {
+		m->v.h   = h;
+		m->scale = scale;
+	}
+}
+
+static void
+metric_printf(metric_buf *b, const char *fmt, ...)
+{
+	va_list ap;
+	int     n;
+
+	for (;;) {
+		va_start(ap, fmt);
+		n = vsnprintf(b->buf + b->len, b->cap - b->len, fmt, ap);
+		va_end(ap);
+		if (n < 0) {
+			return;
+		}
+		if (b->len + n < b->cap) {
+			b->len += n;
+			return;
+		}
+		size_t cap = b->cap * 2 + n;
+		char * buf = realloc(b->buf, cap);
+		if (buf == NULL) {
+			return;
+		}
+		b->buf = buf;
+		b->cap = cap;
+	}
+}
+
+// Cumulative buckets at the top of every power-of-two group, all of them
+// on every scrape, so the bucket set never changes between scrapes.
+// _count is the bucket sum so the exposition stays self-consistent while
+// callbacks keep recording.
+static void
+metric_hist(metric_buf *b, metric *m)
+{
+	nnb_hist *h = m->v.h;
+	uint64_t  n = 0;
+
+	for (int i = 0; i < NNB_HIST_BUCKETS; i++) {
+		n += atomic_load_explicit(&h->count[i], memory_order_relaxed);
+		if ((i + 1) % NNB_HIST_SUB != 0) {
+			continue;
+		}
+		metric_printf(b, "%s_bucket{le=\"%g\"} %llu\n", m->name,
+		    nnb_hist_bucket_high(i) * m->scale,
+		    (unsigned long long) n);
+	}
+	metric_printf(b, "%s_bucket{le=\"+Inf\"} %llu\n", m->name,
+	    (unsigned long long) n);
+	metric_printf(b, "%s_count %llu\n", m->name, (unsigned long long) n);
+	metric_printf(b, "%s_sum %g\n", m->name,
+	    atomic_load_explicit(&h->sum, memory_order_relaxed) * m->scale);
+}
+
+static void
+metric_render(metric_buf *b)
+{
+	static const char *types[] = {
+		[METRIC_COUNTER]   = "counter",
+		[METRIC_COUNTER64] = "counter",
+		[METRIC_GAUGE]     = "gauge",
+		[METRIC_HIST]      = "histogram",
+	};
+
+	for (int i = 0; i < metric_cnt; i++) {
+		metric *m = &metrics[i];
+
+		metric_printf(b, "# TYPE %s %s\n", m->name, types[m->kind]);
+		metric_printf(b, "# HELP %s %s\n", m->name, m->help);
+		switch (m->kind) {
+		case METRIC_COUNTER:
+			metric_printf(b, "%s_total %d\n", m->name,
+			    atomic_load_explicit(m->v.i, memory_order_relaxed));
+			break;
+		case METRIC_COUNTER64:
+			metric_printf(b, "%s_total %llu\n", m->name,
+			    (unsigned long long) atomic_load_explicit(
+			        m->v.u, memory_order_relaxed));
+			break;
+		case METRIC_GAUGE:
+			metric_printf(b, "%s %d\n", m->name,
+			    atomic_load_explicit(m->v.i, memory_order_relaxed));
+			break;
+		case METRIC_HIST:
+			metric_hist(b, m);
+			break;
+		}
+	}
+	metric_printf(b, "# EOF\n");
+}
+
+static void
+metrics_handle(nng_aio *aio)
+{
+	nng_http_res *res;
+	metric_buf    b = { .buf = malloc(4096), .len = 0, .cap = 4096 };
+	int           rv;
+
+	if (b.buf == NULL) {
+		nng_aio_finish(aio, NNG_ENOMEM);
+		return;
+	}
+	metric_render(&b);
+	if ((rv = nng_http_res_alloc(&res)) != 0 ||
+	    (rv = nng_http_res_set_header(res, "Content-Type",
+	         "application/openmetrics-text; version=1.0.0; "
+	         "charset=utf-8")) != 0 ||
+	    (rv = nng_http_res_copy_data(res, b.buf, b.len)) != 0) {
+		free(b.buf);
+		nng_aio_finish(aio, rv);
+		return;
+	}
+	free(b.buf);
+	nng_aio_set_output(aio, 0, res);
+	nng_aio_finish(aio, 0);
+}
+
+int
+nnb_metrics_start(const char *listen)
+{
+	nng_url *         url;
+	nng_http_handler *h;
+	char              buf[128];
+	int               rv;
+
+	snprintf(buf, sizeof(buf), "http://%s", listen);
+	if ((rv = nng_url_parse(&url, buf)) != 0) {
+		nng_fatal("metrics url", rv);
+		return (rv);
+	}
+	if ((rv = nng_http_server_hold(&server, url)) != 0 ||
+	    (rv = nng_http_handler_alloc(&h, "/metrics", metrics_handle)) !=
+	        0 ||
+	    (rv = nng_http_handler_set_method(h, "GET")) != 0 ||
+	    (rv = nng_http_server_add_handler(server, h)) != 0 ||
+	    (rv = nng_http_server_start(server)) != 0) {
+		nng_fatal("metrics listen", rv);
+		nng_url_free(url);
+		nnb_metrics_stop();
+		return (rv);
+	}
+	nng_url_free(url);
+	printf("metrics: serving http://%s/metrics\n", listen);
+	return (0);
+}
+
+void
+nnb_metrics_stop(void)
+{
+	if (server != NULL) {
+		nng_http_server_stop(server);
+		nng_http_server_release(server);
+		server = NULL;
+	}
+}
@@ -0,0 +1,25 @@
+#ifndef NNB_METRICS_H
+#define NNB_METRICS_H
+#include "nnb_hist.h"
+#include <stdatomic.h>
+
+// Live OpenMetrics endpoint. Metrics are registered once before
+// nnb_metrics_start() as pointers to the counters and histograms the
+// callbacks already update; a scrape only does relaxed loads, so the
+// hot path takes no lock and does no extra work.
+#define NNB_METRICS_MAX 32
+
+void nnb_metrics_counter(
+    const char *name, const char *help, atomic_int *v);
+void nnb_metrics_counter64(
+    const char *name, const char *help, atomic_ullong *v);
+void nnb_metrics_gauge(const char *name, const char *help, atomic_int *v);
+// Values are multiplied by scale, e.g. 1e-6 to export usec as seconds.
+void nnb_metrics_hist(
+    const char *name, const char *help, nnb_hist *h, double scale);
+
+// Serves GET /metrics on "host:port".
+int  nnb_metrics_start(const char *listen);
+void nnb_metrics_stop(void);
+
+#endif
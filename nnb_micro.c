@@ -0,0 +1,466 @@
+// nano_bench_micro: client-side cost of the operations every nano_bench
+// result is bounded by, measured without a broker. Each case prints one
+// CSV row; the columns and case names are stable so runs can be diffed
+// or plotted across commits.
+
+#include "nnb_crc.h"
+#include "nnb_frame.h"
+#include "nnb_payload.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include "nnb_wire.h"
+#include <getopt.h>
+#include <nng/mqtt/mqtt_client.h>
+#include <nng/nng.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MICRO_PAYLOAD_MAX (1 << 20)
+#define MICRO_NELEM(a) (sizeof(a) / sizeof((a)[0]))
+
+// Every allocation of the process, nng's included, goes through these:
+// the target is linked with --wrap for malloc, calloc and realloc.
+static uint64_t micro_allocs;
+static uint64_t micro_bytes;
+
+void *__real_malloc(size_t n);
+void *__real_calloc(size_t n, size_t sz);
+void *__real_realloc(void *p, size_t n);
+
+void *
+__wrap_malloc(size_t n)
+{
+	micro_allocs++;
+	micro_bytes += n;
+	return (__real_malloc(n));
+}
+
+void *
+__wrap_calloc(size_t n, size_t sz)
+{
+	micro_allocs++;
+	micro_bytes += n * sz;
+	return (__real_calloc(n, sz));
+}
+
+void *
+__wrap_realloc(void *p, size_t n)
+{
+	micro_allocs++;
+	micro_bytes += n;
+	return (__real_realloc(p, n));
+}
+
+// One case: op runs n times per call on state set up by its case.
+typedef struct {
+	const char *op;
+	uint32_t    payload;
+	int         topic;
+	int         props;
+	const char *arg; // case-specific, e.g. the size distribution
+} micro_case;
+
+typedef void (*micro_fn)(micro_case *mc, uint64_t n);
+
+static struct {
+	int         min_ms; // per case
+	const char *only;   // run ops with this prefix only
+	uint8_t *   payload;
+	char        topic[NNB_TOPIC_LEN + 1];
+	nng_msg *   tmpl; // encoded PUBLISH of the current case
+	nng_msg *   enc;  // re-encoded in place by the encode op
+	nnb_tree    tree;
+	nnb_frame   frame;
+	uint64_t    seed;
+	uint64_t    sink; // keeps results alive
+} micro;
+
+static void
+micro_topic(int len)
+{
+	memset(micro.topic, 't', len);
+	for (int i = 8; i < len; i += 8) {
+		micro.topic[i] = '/';
+	}
+	micro.topic[len] = '\0';
+}
+
+static void
+micro_props(nng_msg *msg, int n)
+{
+	property *list;
+
+	if (n == 0) {
+		return;
+	}
+	list = mqtt_property_alloc();
+	for (int i = 0; i < n; i++) {
+		char key[16];
+		snprintf(key, sizeof(key), "k%d", i);
+		mqtt_property_append(list,
+		    mqtt_property_set_value_strpair(USER_PROPERTY, key,
+		        strlen(key), "value", 5, true));
+	}
+	nng_mqtt_msg_set_publish_property(msg, list);
+}
+
+static nng_msg *
+micro_publish(micro_case *mc)
+{
+	nng_msg *msg;
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, micro.topic);
+	nng_mqtt_msg_set_publish_qos(msg, 0);
+	nng_mqtt_msg_set_publish_payload(msg, micro.payload, mc->payload);
+	micro_props(msg, mc->props);
+	if (mc->props > 0) {
+		nng_mqttv5_msg_encode(msg);
+	} else {
+		nng_mqtt_msg_encode(msg);
+	}
+	return (msg);
+}
+
+// What pub_send did before frame templates: new topic and payload on a
+// live message, then a full encode.
+static void
+op_encode(micro_case *mc, uint64_t n)
+{
+	for (uint64_t i = 0; i < n; i++) {
+		nng_mqtt_msg_set_publish_topic(micro.enc, micro.topic);
+		nng_mqtt_msg_set_publish_payload(
+		    micro.enc, micro.payload, mc->payload);
+		if (mc->props > 0) {
+			nng_mqttv5_msg_encode(micro.enc);
+		} else {
+			nng_mqtt_msg_encode(micro.enc);
+		}
+	}
+}
+
+// A received packet: a fresh message holding the wire bytes, decoded.
+static void
+op_decode(micro_case *mc, uint64_t n)
+{
+	nng_msg *msg;
+
+	for (uint64_t i = 0; i < n; i++) {
+		nng_msg_alloc(&msg, 0);
+		nng_msg_header_append(msg, nng_msg_header(micro.tmpl),
+		    nng_msg_header_len(micro.tmpl));
+		nng_msg_append(
+		    msg, nng_msg_body(micro.tmpl), nng_msg_len(micro.tmpl));
+		if (mc->props > 0) {
+			nng_mqttv5_msg_decode(msg);
+		} else {
+			nng_mqtt_msg_decode(msg);
+		}
+		nng_msg_free(msg);
+	}
+}
+
+static void
+op_dup(micro_case *mc, uint64_t n)
+{
+	nng_msg *msg;
+
+	(void) mc;
+	for (uint64_t i = 0; i < n; i++) {
+		nng_msg_dup(&msg, micro.tmpl);
+		nng_msg_free(msg);
+	}
+}
+
+// The pub_send path: template copy cut to half the payload, a tree leaf
+// written over the topic.
+static void
+op_frame(micro_case *mc, uint64_t n)
+{
+	nng_msg *msg;
+
+	for (uint64_t i = 0; i < n; i++) {
+		nnb_frame_copy(
+		    &micro.frame, micro.tmpl, mc->payload / 2, &msg);
+		nnb_tree_leaf(&micro.tree, nnb_rand(&micro.seed) % 1000,
+		    nnb_frame_leaf(&micro.frame, msg));
+		nng_msg_free(msg);
+	}
+}
+
+static void
+op_topic_expand(micro_case *mc, uint64_t n)
+{
+	nng_msg *conn;
+	char     tmpl[NNB_TOPIC_LEN + 2];
+	char *   topic;
+
+	snprintf(tmpl, sizeof(tmpl), "%.*s%%c", mc->topic - 2, micro.topic);
+	nng_mqtt_msg_alloc(&conn, 0);
+	nng_mqtt_msg_set_packet_type(conn, NNG_MQTT_CONNECT);
+	nng_mqtt_msg_set_connect_client_id(conn, "nnb_pub_1");
+	for (uint64_t i = 0; i < n; i++) {
+		topic = nnb_opt_get_topic(tmpl, NULL, conn);
+		micro.sink += topic[0];
+		nng_free(topic, strlen(topic) + 1);
+	}
+	nng_msg_free(conn);
+}
+
+static void
+op_topic_tree(micro_case *mc, uint64_t n)
+{
+	char buf[NNB_TOPIC_LEN * 2];
+
+	(void) mc;
+	for (uint64_t i = 0; i < n; i++) {
+		nnb_tree_topic(&micro.tree, micro.topic,
+		    nnb_rand(&micro.seed) % micro.tree.leaves, buf,
+		    sizeof(buf));
+		micro.sink += buf[0];
+	}
+}
+
+static void
+op_payload(micro_case *mc, uint64_t n)
+{
+	(void) mc;
+	for (uint64_t i = 0; i < n; i++) {
+		micro.sink += nnb_payload_size(&micro.seed);
+	}
+}
+
+static void
+op_crc(micro_case *mc, uint64_t n)
+{
+	for (uint64_t i = 0; i < n; i++) {
+		nnb_crc_seal(micro.payload, mc->payload);
+		micro.sink += micro.payload[0];
+	}
+}
+
+static void
+op_wire(micro_case *mc, uint64_t n)
+{
+	uint8_t *buf;
+	size_t   len;
+
+	for (uint64_t i = 0; i < n; i++) {
+		buf = nnb_wire_publish(4, micro.topic, mc->payload, &len);
+		nng_free(buf, len);
+	}
+}
+
+// Runs batches of growing size until min_ms have passed, so timer
+// overhead stays small against fast ops, then prints the row.
+static void
+micro_run(micro_case *mc, micro_fn fn)
+{
+	uint64_t n     = 1;
+	uint64_t total = 0;
+	uint64_t a0;
+	uint64_t b0;
+	uint64_t t0;
+	uint64_t t;
+
+	if (micro.only != NULL &&
+	    strncmp(mc->op, micro.only, strlen(micro.only)) != 0) {
+		return;
+	}
+	fn(mc, 1); // warm caches and lazy allocations
+	a0 = micro_allocs;
+	b0 = micro_bytes;
+	t0 = nnb_clock_us();
+	while ((t = nnb_clock_us() - t0) < (uint64_t) micro.min_ms * 1000) {
+		fn(mc, n);
+		total += n;
+		if (n < (1 << 20)) {
+			n *= 2;
+		}
+	}
+	printf("%s,%u,%d,%d,%s,%llu,%.1f,%.1f,%.3f\n", mc->op, mc->payload,
+	    mc->topic, mc->props, mc->arg ? mc->arg : "",
+	    (unsigned long long) total, t * 1000.0 / total,
+	    (double) (micro_bytes - b0) / total,
+	    (double) (micro_allocs - a0) / total);
+	fflush(stdout);
+}
+
+static void
+micro_codec(void)
+{
+	static const uint32_t payloads[] = { 16, 256, 4096, 65536,
+		MICRO_PAYLOAD_MAX };
+	static const int      topics[]   = { 16, 64, 256 };
+	static const int      props[]    = { 0, 4, 16 };
+
+	for (size_t p = 0; p < MICRO_NELEM(payloads); p++) {
+		for (size_t t = 0; t < MICRO_NELEM(topics); t++) {
+			for (size_t k = 0; k < MICRO_NELEM(props); k++) {
+				micro_case mc = { .props = props[k] };
+
+				mc.payload = payloads[p];
+				mc.topic   = topics[t];
+				micro_topic(topics[t]);
+				micro.tmpl = micro_publish(&mc);
+				micro.enc  = micro_publish(&mc);
+
+				mc.op = "encode";
+				micro_run(&mc, op_encode);
+				mc.op = "decode";
+				micro_run(&mc, op_decode);
+				mc.op = "dup";
+				micro_run(&mc, op_dup);
+
+				nng_msg_free(micro.tmpl);
+				nng_msg_free(micro.enc);
+			}
+		}
+	}
+}
+
+// Frame copies of a template whose topic ends in a 3 level leaf.
+static void
+micro_frames(void)
+{
+	static const uint32_t payloads[] = { 16, 256, 4096, 65536,
+		MICRO_PAYLOAD_MAX };
+	char                  leaf[NNB_TOPIC_LEN * 2];
+
+	nnb_tree_parse(&micro.tree, "10,10,10");
+	micro_topic(16);
+	nnb_tree_topic(&micro.tree, micro.topic, 0, leaf, sizeof(leaf));
+	for (size_t p = 0; p < MICRO_NELEM(payloads); p++) {
+		micro_case mc = { .op = "frame" };
+		nng_msg *  msg;
+
+		mc.payload = payloads[p];
+		mc.topic   = (int) strlen(leaf);
+		nng_mqtt_msg_alloc(&msg, 0);
+		nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+		nng_mqtt_msg_set_publish_topic(msg, leaf);
+		nng_mqtt_msg_set_publish_payload(
+		    msg, micro.payload, mc.payload);
+		nng_mqtt_msg_encode(msg);
+		micro.tmpl              = msg;
+		micro.frame.payload_max = mc.payload;
+		micro.frame.leaf_len    = micro.tree.leaf_len;
+		micro_run(&mc, op_frame);
+		nng_msg_free(msg);
+
+		mc.op    = "wire_publish";
+		mc.topic = 16;
+		micro_run(&mc, op_wire);
+		mc.op  = "crc32c";
+		mc.arg = nnb_crc_impl();
+		micro_run(&mc, op_crc);
+	}
+}
+
+static void
+micro_topics(void)
+{
+	static const int topics[] = { 16, 64, 256 };
+
+	for (size_t t = 0; t < MICRO_NELEM(topics); t++) {
+		micro_case mc = { .topic = topics[t] };
+
+		micro_topic(topics[t]);
+		mc.op = "topic_expand";
+		micro_run(&mc, op_topic_expand);
+
+		nnb_tree_parse(&micro.tree, "10,100,1000");
+		mc.op  = "topic_tree";
+		mc.arg = "10,100,1000";
+		micro_run(&mc, op_topic_tree);
+	}
+}
+
+static void
+micro_payloads(void)
+{
+	static const size_dist_t dists[] = { SIZE_FIXED, SIZE_UNIFORM,
+		SIZE_LOGNORMAL };
+	nnb_pub_opt              opt;
+
+	for (size_t d = 0; d < MICRO_NELEM(dists); d++) {
+		micro_case mc = { .op = "payload_size", .payload = 1024 };
+
+		memset(&opt, 0, sizeof(opt));
+		opt.size            = 1024;
+		opt.size_dist.dist  = dists[d];
+		opt.size_dist.sigma = 1.0;
+		mc.arg              = nnb_payload_dist_name(dists[d]);
+		if (nnb_payload_init(&opt) != 0) {
+			continue;
+		}
+		micro_run(&mc, op_payload);
+		nnb_payload_fini();
+	}
+}
+
+static struct option micro_options[] = {
+	{ "min-time", required_argument, NULL, 't' },
+	{ "op", required_argument, NULL, 'o' },
+	{ "help", no_argument, NULL, 'h' },
+	{ NULL, 0, NULL, 0 },
+};
+
+static char micro_info[] =
+    "nano_bench_micro [--min-time <ms>] [--op <prefix>]\n\
+                                                                    \n\
+  Client-side cost of encode, decode, dup, frame template copies,   \n\
+  topic rendering, payload sizing, hand-encoded PUBLISH and CRC32C, \n\
+  swept over payload sizes, topic lengths and v5 user property      \n\
+  counts. One CSV row per case on stdout:                           \n\
+  op,payload,topic,props,arg,iters,ns_op,bytes_op,allocs_op         \n\
+                                                                    \n\
+  -t, --min-time     milliseconds per case [default: 200]           \n\
+  -o, --op           only ops starting with this, e.g. encode       \n\
+";
+
+int
+main(int argc, char **argv)
+{
+	int c;
+
+	micro.min_ms = 200;
+	while ((c = getopt_long(argc, argv, "t:o:h", micro_options, NULL)) !=
+	    -1) {
+		switch (c) {
+		case 't':
+			micro.min_ms = atoi(optarg);
+			break;
+		case 'o':
+			micro.only = optarg;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", micro_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc || micro.min_ms < 1) {
+		fprintf(stderr, "Usage: %s\n", micro_info);
+		exit(EXIT_FAILURE);
+	}
+
+	nnb_crc_init();
+	micro.seed = 0x9e3779b97f4a7c15ULL;
+	if ((micro.payload = nng_alloc(MICRO_PAYLOAD_MAX)) == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+	memset(micro.payload, 'A', MICRO_PAYLOAD_MAX);
+
+	printf("op,payload,topic,props,arg,iters,ns_op,bytes_op,allocs_op\n");
+	micro_codec();
+	micro_frames();
+	micro_topics();
+	micro_payloads();
+
+	nng_free(micro.payload, MICRO_PAYLOAD_MAX);
+	fprintf(stderr, "checksum %llu\n", (unsigned long long) micro.sink);
+	return (0);
+}
@@ -1,12 +1,27 @@
 #include "nnb_opt.h"
 #include "dbg.h"
+#include "nnb_crc.h"
 #include "nnb_help.h"
+#include "nnb_id.h"
+#include "nnb_log.h"
+#include "nnb_payload.h"
 #include <stdarg.h>
 #include <stdlib.h>
+#include <sys/uio.h>
 
 static int conn_opt_set(int argc, char **argv, nnb_conn_opt *opt);
 static int sub_opt_set(int argc, char **argv, nnb_sub_opt *opt);
 static int pub_opt_set(int argc, char **argv, nnb_pub_opt *opt);
+static int session_opt_set(int argc, char **argv, nnb_session_opt *opt);
+static int retain_opt_set(int argc, char **argv, nnb_retain_opt *opt);
+static int search_opt_set(int argc, char **argv, nnb_search_opt *opt);
+static int churn_opt_set(int argc, char **argv, nnb_churn_opt *opt);
+static int lwt_opt_set(int argc, char **argv, nnb_lwt_opt *opt);
+static int resub_opt_set(int argc, char **argv, nnb_resub_opt *opt);
+static int transport_opt_set(
+    int argc, char **argv, nnb_transport_opt *opt);
+static int blast_opt_set(int argc, char **argv, nnb_blast_opt *opt);
+static int proxy_opt_set(int argc, char **argv, nnb_proxy_opt *opt);
 
 static void
 fatal(const char *msg, ...)
@@ -21,11 +36,15 @@ fatal(const char *msg, ...)
 static void
 init_tls(tls_opt *tls)
 {
-	tls->enable  = NULL;
-	tls->cacert  = NULL;
-	tls->cert    = NULL;
-	tls->key     = NULL;
-	tls->keypass = NULL;
+	tls->enable    = NULL;
+	tls->cacert    = NULL;
+	tls->cert      = NULL;
+	tls->key       = NULL;
+	tls->keypass   = NULL;
+	tls->ws        = false;
+	tls->ws_path   = NULL;
+	tls->quic      = false;
+	tls->quic_0rtt = false;
 }
 
 static void
@@ -49,6 +68,107 @@ destory_tls(tls_opt *tls)
 			free(tls->keypass);
 			tls->keypass = NULL;
 		}
+		tls->ws        = false;
+		tls->quic      = false;
+		tls->quic_0rtt = false;
+		if (tls->ws_path) {
+			nng_strfree(tls->ws_path);
+			tls->ws_path = NULL;
+		}
+	}
+}
+
+// --quic and --quic-0rtt; a build without QUIC support refuses both.
+static void
+quic_opt_set(tls_opt *tls, const char *name)
+{
+#ifdef SUPP_QUIC
+	tls->quic = true;
+	if (!strcmp(name, "quic-0rtt")) {
+		tls->quic_0rtt = true;
+	}
+#else
+	fprintf(stderr,
+	    "Error: --%s needs a build with -DNNG_ENABLE_QUIC=ON\n", name);
+	exit(EXIT_FAILURE);
+#endif
+}
+
+static void
+init_will(will_opt *will)
+{
+	will->topic   = NULL;
+	will->payload = NULL;
+	will->qos     = 0;
+	will->retain  = false;
+}
+
+static void
+destory_will(will_opt *will)
+{
+	if (will->topic) {
+		nng_strfree(will->topic);
+		will->topic = NULL;
+	}
+	if (will->payload) {
+		nng_strfree(will->payload);
+		will->payload = NULL;
+	}
+}
+
+// Parses the --will-* long options shared by the modes that send wills,
+// other names are ignored.
+static void
+will_opt_set(will_opt *will, const char *name, const char *arg)
+{
+	if (!strcmp(name, "will-topic")) {
+		nng_strfree(will->topic);
+		will->topic = nng_strdup(arg);
+	} else if (!strcmp(name, "will-payload")) {
+		nng_strfree(will->payload);
+		will->payload = nng_strdup(arg);
+	} else if (!strcmp(name, "will-qos")) {
+		will->qos = atoi(arg);
+	} else if (!strcmp(name, "will-retain")) {
+		will->retain = true;
+	}
+}
+
+static void
+init_pool(pool_opt *pool)
+{
+	pool->task_threads     = 0;
+	pool->poller_threads   = 0;
+	pool->resolver_threads = 0;
+	pool->cpus             = NULL;
+	pool->auto_size        = false;
+}
+
+static void
+destory_pool(pool_opt *pool)
+{
+	if (pool->cpus) {
+		nng_strfree(pool->cpus);
+		pool->cpus = NULL;
+	}
+}
+
+// Parses the nng thread pool long options shared by pub, sub and conn,
+// other names are ignored.
+static void
+pool_opt_set(pool_opt *pool, const char *name, const char *arg)
+{
+	if (!strcmp(name, "task-threads")) {
+		pool->task_threads = atoi(arg);
+	} else if (!strcmp(name, "poller-threads")) {
+		pool->poller_threads = atoi(arg);
+	} else if (!strcmp(name, "resolver-threads")) {
+		pool->resolver_threads = atoi(arg);
+	} else if (!strcmp(name, "nng-cpus")) {
+		nng_strfree(pool->cpus);
+		pool->cpus = nng_strdup(arg);
+	} else if (!strcmp(name, "nng-auto")) {
+		pool->auto_size = true;
 	}
 }
 
@@ -68,15 +188,38 @@ nnb_conn_opt_init(int argc, char **argv)
 	opt->interval    = 10;
 	opt->keepalive   = 300;
 	opt->clean       = true;
+	opt->reconnect   = false;
+	opt->log_level   = NNB_LOG_INFO;
 	opt->username    = NULL;
 	opt->password    = NULL;
 	opt->host        = NULL;
+	opt->metrics     = NULL;
+	opt->cred_file   = NULL;
+	opt->prefix      = NULL;
+	opt->shard       = NULL;
 
 	init_tls(&opt->tls);
+	init_will(&opt->will);
+	init_pool(&opt->pool);
 	conn_opt_set(argc, argv, opt);
 	if (opt->host == NULL) {
 		opt->host = nng_strdup("localhost");
 	}
+	if (opt->prefix == NULL) {
+		opt->prefix = nng_strdup("nnb_conn_");
+	}
+	if (opt->shard &&
+	    nnb_ids_shard(opt->shard, &opt->startnumber, &opt->count) != 0) {
+		fprintf(stderr, "Error: bad --shard %s\n", opt->shard);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->will.topic != NULL && opt->will.payload == NULL) {
+		opt->will.payload = nng_strdup("offline");
+	}
+	if (opt->will.qos < 0 || opt->will.qos > 2) {
+		fprintf(stderr, "Usage: %s\n", conn_info);
+		exit(EXIT_FAILURE);
+	}
 
 	return opt;
 }
@@ -100,7 +243,29 @@ nnb_conn_opt_destory(nnb_conn_opt *opt)
 			opt->password = NULL;
 		}
 
+		if (opt->metrics) {
+			nng_strfree(opt->metrics);
+			opt->metrics = NULL;
+		}
+
+		if (opt->cred_file) {
+			nng_strfree(opt->cred_file);
+			opt->cred_file = NULL;
+		}
+
+		if (opt->prefix) {
+			nng_strfree(opt->prefix);
+			opt->prefix = NULL;
+		}
+
+		if (opt->shard) {
+			nng_strfree(opt->shard);
+			opt->shard = NULL;
+		}
+
 		destory_tls(&opt->tls);
+		destory_will(&opt->will);
+		destory_pool(&opt->pool);
 
 		nng_free(opt, sizeof(nnb_conn_opt));
 		opt = NULL;
@@ -137,12 +302,49 @@ nnb_pub_opt_init(int argc, char **argv)
 	opt->tls.key         = NULL;
 	opt->tls.keypass     = NULL;
 
+	opt->size_dist.dist  = SIZE_FIXED;
+	opt->size_dist.min   = 0;
+	opt->size_dist.max   = 0;
+	opt->size_dist.sigma = 1.0;
+	opt->size_dist.file  = NULL;
+	opt->tree            = NULL;
+	opt->stamp           = false;
+	opt->crc             = false;
+	opt->log_level       = NNB_LOG_INFO;
+	opt->metrics         = NULL;
+	opt->trace           = 0;
+	opt->trace_file      = NULL;
+	opt->broker_pid      = 0;
+	opt->cred_file       = NULL;
+	opt->prefix          = NULL;
+	opt->shard           = NULL;
+
 	init_tls(&opt->tls);
+	init_pool(&opt->pool);
 
 	pub_opt_set(argc, argv, opt);
 	if (opt->host == NULL) {
 		opt->host = nng_strdup("localhost");
 	}
+	if (opt->prefix == NULL) {
+		opt->prefix = nng_strdup("nnb_pub_");
+	}
+	if (opt->shard &&
+	    nnb_ids_shard(opt->shard, &opt->startnumber, &opt->count) != 0) {
+		fprintf(stderr, "Error: bad --shard %s\n", opt->shard);
+		exit(EXIT_FAILURE);
+	}
+	// every payload must have room for its CRC, so that a subscriber
+	// can take a short one for a truncation
+	if (opt->crc &&
+	    (opt->size_dist.dist == SIZE_FIXED ? opt->size
+	                                       : opt->size_dist.min) <
+	        NNB_CRC_LEN) {
+		fprintf(stderr, "Error: --crc needs payloads of at least %d "
+		                "bytes, raise -s or --size-min!\n",
+		    NNB_CRC_LEN);
+		exit(EXIT_FAILURE);
+	}
 
 	return opt;
 }
@@ -171,7 +373,43 @@ nnb_pub_opt_destory(nnb_pub_opt *opt)
 			opt->topic = NULL;
 		}
 
+		if (opt->size_dist.file) {
+			nng_strfree(opt->size_dist.file);
+			opt->size_dist.file = NULL;
+		}
+
+		if (opt->tree) {
+			nng_strfree(opt->tree);
+			opt->tree = NULL;
+		}
+
+		if (opt->metrics) {
+			nng_strfree(opt->metrics);
+			opt->metrics = NULL;
+		}
+
+		if (opt->cred_file) {
+			nng_strfree(opt->cred_file);
+			opt->cred_file = NULL;
+		}
+
+		if (opt->prefix) {
+			nng_strfree(opt->prefix);
+			opt->prefix = NULL;
+		}
+
+		if (opt->shard) {
+			nng_strfree(opt->shard);
+			opt->shard = NULL;
+		}
+
+		if (opt->trace_file) {
+			nng_strfree(opt->trace_file);
+			opt->trace_file = NULL;
+		}
+
 		destory_tls(&opt->tls);
+		destory_pool(&opt->pool);
 		nng_free(opt, sizeof(nnb_pub_opt));
 		opt = NULL;
 	}
@@ -198,8 +436,30 @@ nnb_sub_opt_init(int argc, char **argv)
 	opt->password    = NULL;
 	opt->host        = NULL;
 	opt->topic       = NULL;
+	opt->tree        = NULL;
+	opt->filters     = 0;
+	opt->plus_ratio  = 0;
+	opt->hash_ratio  = 0;
+	opt->sub_batch   = 0;
+
+	opt->share_groups  = 0;
+	opt->share_members = 1;
+	opt->share_step    = 0;
+	opt->share_churn   = 0;
+	opt->metrics       = NULL;
+	opt->trace         = 0;
+	opt->trace_file    = NULL;
+	opt->broker_pid    = 0;
+	opt->cred_file     = NULL;
+	opt->prefix        = NULL;
+	opt->shard         = NULL;
+	opt->raw           = false;
+	opt->threads       = 2;
+	opt->crc           = false;
+	opt->log_level     = NNB_LOG_INFO;
 
 	init_tls(&opt->tls);
+	init_pool(&opt->pool);
 
 	sub_opt_set(argc, argv, opt);
 	if (opt->topic == NULL) {
@@ -207,9 +467,58 @@ nnb_sub_opt_init(int argc, char **argv)
 		fprintf(stderr, "Usage: %s\n", sub_info);
 		exit(EXIT_FAILURE);
 	}
+	if (opt->filters > 0 && opt->tree == NULL) {
+		fprintf(stderr, "Error: --filters requires --tree!\n");
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->plus_ratio < 0 || opt->hash_ratio < 0 ||
+	    opt->plus_ratio + opt->hash_ratio > 100) {
+		fprintf(stderr, "Error: wildcard ratios invalided!\n");
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->share_groups < 0 || opt->share_members < 1) {
+		fprintf(stderr, "Error: share groups invalided!\n");
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->raw &&
+	    (opt->qos != 0 || opt->tls.enable || opt->tls.ws ||
+	        opt->tls.quic || opt->filters > 0 || opt->share_groups > 0 ||
+	        strchr(opt->topic, '%') != NULL)) {
+		fprintf(stderr,
+		    "Error: --raw is qos 0 over plain tcp, one topic without "
+		    "variables!\n");
+		exit(EXIT_FAILURE);
+	}
+	if (opt->threads < 1) {
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+	}
 	if (opt->host == NULL) {
 		opt->host = nng_strdup("localhost");
 	}
+	if (opt->prefix == NULL) {
+		opt->prefix = nng_strdup("nnb_sub_");
+	}
+	if (opt->shard &&
+	    nnb_ids_shard(opt->shard, &opt->startnumber, &opt->count) != 0) {
+		fprintf(stderr, "Error: bad --shard %s\n", opt->shard);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->share_groups > 0) {
+		// members take the first ids of the slice
+		int members = opt->share_groups * opt->share_members;
+		if (opt->shard && opt->count < members) {
+			fprintf(stderr,
+			    "Error: --shard slice holds %d clients, the "
+			    "shared groups need %d!\n",
+			    opt->count, members);
+			exit(EXIT_FAILURE);
+		}
+		opt->count = members;
+	}
 
 	return opt;
 }
@@ -233,97 +542,2347 @@ nnb_sub_opt_destory(nnb_sub_opt *opt)
 			opt->password = NULL;
 		}
 
+		if (opt->tree) {
+			nng_strfree(opt->tree);
+			opt->tree = NULL;
+		}
+
+		if (opt->metrics) {
+			nng_strfree(opt->metrics);
+			opt->metrics = NULL;
+		}
+
+		if (opt->cred_file) {
+			nng_strfree(opt->cred_file);
+			opt->cred_file = NULL;
+		}
+
+		if (opt->prefix) {
+			nng_strfree(opt->prefix);
+			opt->prefix = NULL;
+		}
+
+		if (opt->shard) {
+			nng_strfree(opt->shard);
+			opt->shard = NULL;
+		}
+
+		if (opt->trace_file) {
+			nng_strfree(opt->trace_file);
+			opt->trace_file = NULL;
+		}
+
 		destory_tls(&opt->tls);
+		destory_pool(&opt->pool);
 		nng_free(opt, sizeof(nnb_sub_opt));
 		opt = NULL;
 	}
 }
 
-// This reads a file into memory.  Care is taken to ensure that
-// the buffer is one byte larger and contains a terminating
-// NUL. (Useful for key files and such.)
-static void
-loadfile(const char *path, void **datap, size_t *lenp)
+nnb_session_opt *
+nnb_session_opt_init(int argc, char **argv)
 {
-	FILE * f;
-	size_t total_read      = 0;
-	size_t allocation_size = BUFSIZ;
-	char * fdata;
-	char * realloc_result;
-
-	if (strcmp(path, "-") == 0) {
-		f = stdin;
-	} else {
-		if ((f = fopen(path, "rb")) == NULL) {
-			fatal(
-			    "Cannot open file %s: %s", path, strerror(errno));
-		}
+	nnb_session_opt *opt = nng_alloc(sizeof(nnb_session_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
 	}
 
-	if ((fdata = malloc(allocation_size + 1)) == NULL) {
-		fatal("Out of memory.");
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 200;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 1;
+	opt->size        = 256;
+	opt->queued      = 100;
+	opt->publishers  = 1;
+	opt->broker_pid  = 0;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+
+	session_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/session");
 	}
 
-	while (1) {
-		total_read += fread(
-		    fdata + total_read, 1, allocation_size - total_read, f);
-		if (ferror(f)) {
-			if (errno == EINTR) {
-				continue;
-			}
-			fatal(
-			    "Read from %s failed: %s", path, strerror(errno));
+	return opt;
+}
+
+void
+nnb_session_opt_destory(nnb_session_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
 		}
-		if (feof(f)) {
-			break;
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
 		}
-		if (total_read == allocation_size) {
-			if (allocation_size > SIZE_MAX / 2) {
-				fatal("Out of memory.");
-			}
-			allocation_size *= 2;
-			if ((realloc_result = realloc(
-			         fdata, allocation_size + 1)) == NULL) {
-				free(fdata);
-				fatal("Out of memory.");
-			}
-			fdata = realloc_result;
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
 		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_session_opt));
+		opt = NULL;
 	}
-	if (f != stdin) {
-		fclose(f);
+}
+
+nnb_retain_opt *
+nnb_retain_opt_init(int argc, char **argv)
+{
+	nnb_retain_opt *opt = nng_alloc(sizeof(nnb_retain_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
 	}
-	fdata[total_read] = '\0';
-	*datap            = fdata;
-	*lenp             = total_read;
+
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 200;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 1;
+	opt->size        = 256;
+	opt->topics      = 10000;
+	opt->publishers  = 1;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+
+	retain_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/retain");
+	}
+
+	return opt;
 }
 
-int
-conn_opt_set(int argc, char **argv, nnb_conn_opt *opt)
+void
+nnb_retain_opt_destory(nnb_retain_opt *opt)
 {
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
 
-	if (argc < 2) {
-		fprintf(stderr, "Usage: %s\n", conn_info);
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_retain_opt));
+		opt = NULL;
+	}
+}
+
+nnb_search_opt *
+nnb_search_opt_init(int argc, char **argv)
+{
+	nnb_search_opt *opt = nng_alloc(sizeof(nnb_search_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
 		exit(EXIT_FAILURE);
 	}
 
-	int    c;
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 10;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 0;
+	opt->size        = 256;
+	opt->subscribers = 1;
+	opt->rate_start  = 1000;
+	opt->rate_max    = 1000000;
+	opt->hold        = 10;
+	opt->warmup      = 2;
+	opt->refine      = 5;
+	opt->slo_p99     = 20;
+	opt->slo_loss    = 0;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+
+	search_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/search");
+	}
+
+	return opt;
+}
+
+void
+nnb_search_opt_destory(nnb_search_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_search_opt));
+		opt = NULL;
+	}
+}
+
+nnb_churn_opt *
+nnb_churn_opt_init(int argc, char **argv)
+{
+	nnb_churn_opt *opt = nng_alloc(sizeof(nnb_churn_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 200;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 1;
+	opt->size        = 256;
+	opt->clean       = true;
+	opt->abrupt      = false;
+	opt->churn       = 1;
+	opt->rate        = 0;
+	opt->publishers  = 1;
+	opt->duration    = 60;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+
+	churn_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/churn");
+	}
+	if (opt->rate == 0) {
+		opt->rate = opt->count; // one message per client per second
+	}
+
+	return opt;
+}
+
+void
+nnb_churn_opt_destory(nnb_churn_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_churn_opt));
+		opt = NULL;
+	}
+}
+
+nnb_lwt_opt *
+nnb_lwt_opt_init(int argc, char **argv)
+{
+	nnb_lwt_opt *opt = nng_alloc(sizeof(nnb_lwt_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 1000;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 1;
+	opt->subscribers = 1;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+	init_will(&opt->will);
+	opt->will.qos = 1;
+
+	lwt_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/will");
+	}
+	if (opt->will.payload == NULL) {
+		opt->will.payload = nng_strdup("offline");
+	}
+
+	return opt;
+}
+
+void
+nnb_lwt_opt_destory(nnb_lwt_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		destory_will(&opt->will);
+		nng_free(opt, sizeof(nnb_lwt_opt));
+		opt = NULL;
+	}
+}
+
+nnb_resub_opt *
+nnb_resub_opt_init(int argc, char **argv)
+{
+	nnb_resub_opt *opt = nng_alloc(sizeof(nnb_resub_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 100;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 1;
+	opt->size        = 256;
+	opt->filters     = 16;
+	opt->sub_rate    = 100;
+	opt->rate        = 0;
+	opt->publishers  = 1;
+	opt->warmup      = 10;
+	opt->duration    = 60;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+
+	init_tls(&opt->tls);
+
+	resub_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/resub");
+	}
+	if (opt->rate == 0) {
+		opt->rate = opt->count; // one message per client per second
+	}
+
+	return opt;
+}
+
+void
+nnb_resub_opt_destory(nnb_resub_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_resub_opt));
+		opt = NULL;
+	}
+}
+
+nnb_transport_opt *
+nnb_transport_opt_init(int argc, char **argv)
+{
+	nnb_transport_opt *opt = nng_alloc(sizeof(nnb_transport_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->version     = 4;
+	opt->count       = 1;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 300;
+	opt->qos         = 0;
+	opt->size        = 256;
+	opt->subscribers = 1;
+	opt->rate        = 1000;
+	opt->warmup      = 5;
+	opt->duration    = 10;
+	opt->timeout     = 30;
+	opt->tcp_port    = 1883;
+	opt->tls_port    = 8883;
+	opt->ws_port     = 8083;
+	opt->wss_port    = 8084;
+	opt->quic_port   = 14567;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+	opt->transports  = NULL;
+
+	init_tls(&opt->tls);
+
+	transport_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/transport");
+	}
+	if (opt->transports == NULL) {
+		opt->transports = nng_strdup("tcp,tls,ws,wss");
+	}
+
+	return opt;
+}
+
+void
+nnb_transport_opt_destory(nnb_transport_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		if (opt->transports) {
+			nng_strfree(opt->transports);
+			opt->transports = NULL;
+		}
+
+		destory_tls(&opt->tls);
+		nng_free(opt, sizeof(nnb_transport_opt));
+		opt = NULL;
+	}
+}
+
+nnb_blast_opt *
+nnb_blast_opt_init(int argc, char **argv)
+{
+	nnb_blast_opt *opt = nng_alloc(sizeof(nnb_blast_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->port        = 1883;
+	opt->version     = 4;
+	opt->count       = 16;
+	opt->startnumber = 0;
+	opt->interval    = 10;
+	opt->keepalive   = 0;
+	opt->size        = 16;
+	opt->rate        = 0;
+	opt->batch       = 64;
+	opt->threads     = 4;
+	opt->duration    = 30;
+	opt->timeout     = 30;
+	opt->username    = NULL;
+	opt->password    = NULL;
+	opt->host        = NULL;
+	opt->topic       = NULL;
+	opt->prefix      = NULL;
+	opt->shard       = NULL;
+
+	blast_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->topic == NULL) {
+		opt->topic = nng_strdup("nnb/blast/%i");
+	}
+	if (opt->prefix == NULL) {
+		opt->prefix = nng_strdup("nnb_blast_");
+	}
+	if (opt->shard &&
+	    nnb_ids_shard(opt->shard, &opt->startnumber, &opt->count) != 0) {
+		fprintf(stderr, "Error: bad --shard %s\n", opt->shard);
+		exit(EXIT_FAILURE);
+	}
+
+	return opt;
+}
+
+void
+nnb_blast_opt_destory(nnb_blast_opt *opt)
+{
+	if (opt) {
+		if (opt->host) {
+			nng_free(opt->host, strlen(opt->host));
+			opt->host = NULL;
+		}
+
+		if (opt->username) {
+			nng_free(opt->username, strlen(opt->username));
+			opt->username = NULL;
+		}
+
+		if (opt->password) {
+			nng_free(opt->password, strlen(opt->password));
+			opt->password = NULL;
+		}
+
+		if (opt->topic) {
+			nng_free(opt->topic, strlen(opt->topic));
+			opt->topic = NULL;
+		}
+
+		if (opt->prefix) {
+			nng_strfree(opt->prefix);
+			opt->prefix = NULL;
+		}
+
+		if (opt->shard) {
+			nng_strfree(opt->shard);
+			opt->shard = NULL;
+		}
+
+		nng_free(opt, sizeof(nnb_blast_opt));
+		opt = NULL;
+	}
+}
+
+nnb_proxy_opt *
+nnb_proxy_opt_init(int argc, char **argv)
+{
+	nnb_proxy_opt *opt = nng_alloc(sizeof(nnb_proxy_opt));
+	if (opt == NULL) {
+		fprintf(stderr, "Memory alloc failed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	opt->host      = NULL;
+	opt->port      = 1883;
+	opt->listen    = 1884;
+	opt->groups    = 1;
+	opt->delay     = NULL;
+	opt->jitter    = NULL;
+	opt->up_rate   = NULL;
+	opt->down_rate = NULL;
+	opt->drop      = NULL;
+	opt->shared    = false;
+	opt->rcvbuf    = 0;
+	opt->threads   = 2;
+	opt->duration  = 0;
+
+	proxy_opt_set(argc, argv, opt);
+	if (opt->host == NULL) {
+		opt->host = nng_strdup("localhost");
+	}
+	if (opt->delay == NULL) {
+		opt->delay = nng_strdup("0");
+	}
+	if (opt->jitter == NULL) {
+		opt->jitter = nng_strdup("0");
+	}
+	if (opt->up_rate == NULL) {
+		opt->up_rate = nng_strdup("0");
+	}
+	if (opt->down_rate == NULL) {
+		opt->down_rate = nng_strdup("0");
+	}
+	if (opt->drop == NULL) {
+		opt->drop = nng_strdup("0");
+	}
+
+	return opt;
+}
+
+void
+nnb_proxy_opt_destory(nnb_proxy_opt *opt)
+{
+	if (opt) {
+		nng_strfree(opt->host);
+		nng_strfree(opt->delay);
+		nng_strfree(opt->jitter);
+		nng_strfree(opt->up_rate);
+		nng_strfree(opt->down_rate);
+		nng_strfree(opt->drop);
+		nng_free(opt, sizeof(nnb_proxy_opt));
+		opt = NULL;
+	}
+}
+
+// This reads a file into memory.  Care is taken to ensure that
+// the buffer is one byte larger and contains a terminating
+// NUL. (Useful for key files and such.)
+static void
+loadfile(const char *path, void **datap, size_t *lenp)
+{
+	FILE * f;
+	size_t total_read      = 0;
+	size_t allocation_size = BUFSIZ;
+	char * fdata;
+	char * realloc_result;
+
+	if (strcmp(path, "-") == 0) {
+		f = stdin;
+	} else {
+		if ((f = fopen(path, "rb")) == NULL) {
+			fatal(
+			    "Cannot open file %s: %s", path, strerror(errno));
+		}
+	}
+
+	if ((fdata = malloc(allocation_size + 1)) == NULL) {
+		fatal("Out of memory.");
+	}
+
+	while (1) {
+		total_read += fread(
+		    fdata + total_read, 1, allocation_size - total_read, f);
+		if (ferror(f)) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fatal(
+			    "Read from %s failed: %s", path, strerror(errno));
+		}
+		if (feof(f)) {
+			break;
+		}
+		if (total_read == allocation_size) {
+			if (allocation_size > SIZE_MAX / 2) {
+				fatal("Out of memory.");
+			}
+			allocation_size *= 2;
+			if ((realloc_result = realloc(
+			         fdata, allocation_size + 1)) == NULL) {
+				free(fdata);
+				fatal("Out of memory.");
+			}
+			fdata = realloc_result;
+		}
+	}
+	if (f != stdin) {
+		fclose(f);
+	}
+	fdata[total_read] = '\0';
+	*datap            = fdata;
+	*lenp             = total_read;
+}
+
+int
+conn_opt_set(int argc, char **argv, nnb_conn_opt *opt)
+{
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s\n", conn_info);
+		exit(EXIT_FAILURE);
+	}
+
+	int    c;
+	int    digit_optind = 0;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "h:p:V:c:n:i:u:P:k:C:S0",
+	            long_options, &option_index)) != -1) {
+		int this_option_optind = optind ? optind : 1;
+		switch (c) {
+		case 0:
+			// printf ("option %s",
+			// long_options[option_index].name); if (optarg)
+			// printf
+			// (" with value %s", optarg); printf ("\n");
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", conn_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "metrics-listen")) {
+				opt->metrics = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cred-file")) {
+				opt->cred_file = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "prefix")) {
+				opt->prefix = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "shard")) {
+				opt->shard = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "reconnect")) {
+				opt->reconnect = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "log-level")) {
+				opt->log_level = nnb_log_level_parse(optarg);
+				if (opt->log_level < 0) {
+					fprintf(stderr,
+					    "Error: unknown log level %s\n",
+					    optarg);
+					fprintf(
+					    stderr, "Usage: %s\n", conn_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "clean")) {
+				if (!strcmp(optarg, "true")) {
+					opt->clean = true;
+				} else if (!strcmp(optarg, "false")) {
+					opt->clean = false;
+				} else {
+					fprintf(
+					    stderr, "Usage: %s\n", conn_info);
+					exit(EXIT_FAILURE);
+				}
+			} else {
+				will_opt_set(&opt->will,
+				    long_options[option_index].name, optarg);
+				pool_opt_set(&opt->pool,
+				    long_options[option_index].name, optarg);
+			}
+
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'C':
+			if (!strcmp(optarg, "true")) {
+				opt->clean = true;
+			} else if (!strcmp(optarg, "false")) {
+				opt->clean = false;
+			} else {
+				fprintf(stderr, "Usage: %s\n", conn_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		case '?':
+			fprintf(stderr, "Usage: %s\n", conn_info);
+			exit(EXIT_FAILURE);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", conn_info);
+			exit(EXIT_FAILURE);
+			printf(
+			    "?? getopt returned character code 0%o ??\n", c);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", conn_info);
+		exit(EXIT_FAILURE);
+		while (optind < argc)
+			printf("%s ", argv[optind++]);
+		printf("\n");
+	}
+
+	return 0;
+}
+
+int
+pub_opt_set(int argc, char **argv, nnb_pub_opt *opt)
+{
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s\n", pub_info);
+		exit(EXIT_FAILURE);
+	}
+
+	int c;
+	int digit_optind = 0;
+	int option_index = 0;
+	size_t sz;
+
+	while ((c = getopt_long(argc, argv,
+	            "q:l:r:s:t:I:h:p:V:c:n:i:u:P:k:C:L:S0", long_options,
+	            &option_index)) != -1) {
+		int this_option_optind = optind ? optind : 1;
+		switch (c) {
+		case 0:
+			// printf ("option %s",
+			// long_options[option_index].name); if (optarg)
+			// printf
+			// (" with value %s", optarg); printf ("\n");
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", pub_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "clean")) {
+				if (!strcmp(optarg, "true")) {
+					opt->clean = true;
+				} else if (!strcmp(optarg, "false")) {
+					opt->clean = false;
+				} else {
+					fprintf(
+					    stderr, "Usage: %s\n", pub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+				if (opt->qos < 0 || opt->qos > 2) {
+					fprintf(
+					    stderr, "Error: qos invalided!\n");
+					fprintf(
+					    stderr, "Usage: %s\n", pub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "limit")) {
+				opt->limit = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "retain")) {
+				if (!strcmp(optarg, "true")) {
+					opt->retain = true;
+				} else if (!strcmp(optarg, "false")) {
+					opt->retain = false;
+				} else {
+					fprintf(
+					    stderr, "Usage: %s\n", pub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval_of_msg")) {
+				opt->interval_of_msg = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size-dist")) {
+				if (!strcmp(optarg, "fixed")) {
+					opt->size_dist.dist = SIZE_FIXED;
+				} else if (!strcmp(optarg, "uniform")) {
+					opt->size_dist.dist = SIZE_UNIFORM;
+				} else if (!strcmp(optarg, "lognormal")) {
+					opt->size_dist.dist = SIZE_LOGNORMAL;
+				} else if (!strcmp(optarg, "file")) {
+					opt->size_dist.dist = SIZE_FILE;
+				} else {
+					fprintf(stderr,
+					    "Error: unknown size dist %s\n",
+					    optarg);
+					fprintf(
+					    stderr, "Usage: %s\n", pub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "size-min")) {
+				opt->size_dist.min = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size-max")) {
+				opt->size_dist.max = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size-sigma")) {
+				opt->size_dist.sigma = atof(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size-file")) {
+				if (opt->size_dist.file) {
+					nng_strfree(opt->size_dist.file);
+				}
+				opt->size_dist.file = nng_strdup(optarg);
+				opt->size_dist.dist = SIZE_FILE;
+			} else if (!strcmp(long_options[option_index].name,
+			               "tree")) {
+				opt->tree = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "stamp")) {
+				opt->stamp = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "crc")) {
+				opt->crc = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "log-level")) {
+				opt->log_level = nnb_log_level_parse(optarg);
+				if (opt->log_level < 0) {
+					fprintf(stderr,
+					    "Error: unknown log level %s\n",
+					    optarg);
+					fprintf(
+					    stderr, "Usage: %s\n", pub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "metrics-listen")) {
+				opt->metrics = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cred-file")) {
+				opt->cred_file = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "prefix")) {
+				opt->prefix = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "shard")) {
+				opt->shard = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "trace")) {
+				opt->trace = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "trace-file")) {
+				opt->trace_file = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "broker-pid")) {
+				opt->broker_pid = atoi(optarg);
+			} else {
+				pool_opt_set(&opt->pool,
+				    long_options[option_index].name, optarg);
+			}
+
+			break;
+		case 'l':
+			opt->limit = atoi(optarg);
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			if (opt->qos < 0 || opt->qos > 2) {
+				fprintf(stderr, "Error: qos invalided!\n");
+				fprintf(stderr, "Usage: %s\n", pub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'I':
+			opt->interval_of_msg = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'r':
+			if (!strcmp(optarg, "true")) {
+				opt->retain = true;
+			} else if (!strcmp(optarg, "false")) {
+				opt->retain = false;
+			} else {
+				fprintf(stderr, "Usage: %s\n", pub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'C':
+			if (!strcmp(optarg, "true")) {
+				opt->clean = true;
+			} else if (!strcmp(optarg, "false")) {
+				opt->clean = false;
+			} else {
+				fprintf(stderr, "Usage: %s\n", pub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'L':
+			opt->limit = atoi(optarg);
+			if (opt->limit < 0) {
+				fprintf(stderr, "Usage: %s\n", pub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		case '?':
+			fprintf(stderr, "Usage: %s\n", pub_info);
+			exit(EXIT_FAILURE);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", pub_info);
+			exit(EXIT_FAILURE);
+			printf(
+			    "?? getopt returned character code 0%o ??\n", c);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", pub_info);
+		exit(EXIT_FAILURE);
+		while (optind < argc)
+			printf("%s ", argv[optind++]);
+		printf("\n");
+	}
+
+	if (opt->topic == NULL) {
+		fprintf(stderr, "Error: topic required\n");
+		fprintf(stderr, "Usage: %s\n", pub_info);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int
+sub_opt_set(int argc, char **argv, nnb_sub_opt *opt)
+{
+
+	if (argc < 2) {
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+	}
+
+	int    c;
 	int    digit_optind = 0;
 	int    option_index = 0;
 	size_t sz           = 0;
 
-	while ((c = getopt_long(argc, argv, "h:p:V:c:n:i:u:P:k:C:S0",
+	while ((c = getopt_long(argc, argv, "q:t:h:p:V:c:n:i:u:P:k:C:S0",
+	            long_options, &option_index)) != -1) {
+		int this_option_optind = optind ? optind : 1;
+		switch (c) {
+		case 0:
+			// printf ("option %s",
+			// long_options[option_index].name); if (optarg)
+			// printf
+			// (" with value %s", optarg); printf ("\n");
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", sub_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "clean")) {
+				if (!strcmp(optarg, "true")) {
+					opt->clean = true;
+				} else if (!strcmp(optarg, "false")) {
+					opt->clean = false;
+				} else {
+					fprintf(
+					    stderr, "Usage: %s\n", sub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+				if (opt->qos < 0 || opt->qos > 2) {
+					fprintf(
+					    stderr, "Error: qos invalided!\n");
+					fprintf(
+					    stderr, "Usage: %s\n", sub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "tree")) {
+				opt->tree = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "filters")) {
+				opt->filters = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "plus-ratio")) {
+				opt->plus_ratio = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "hash-ratio")) {
+				opt->hash_ratio = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "sub-batch")) {
+				opt->sub_batch = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "share-groups")) {
+				opt->share_groups = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "share-members")) {
+				opt->share_members = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "share-step")) {
+				opt->share_step = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "share-churn")) {
+				opt->share_churn = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "raw")) {
+				opt->raw = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "crc")) {
+				opt->crc = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "threads")) {
+				opt->threads = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "log-level")) {
+				opt->log_level = nnb_log_level_parse(optarg);
+				if (opt->log_level < 0) {
+					fprintf(stderr,
+					    "Error: unknown log level %s\n",
+					    optarg);
+					fprintf(
+					    stderr, "Usage: %s\n", sub_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "metrics-listen")) {
+				opt->metrics = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cred-file")) {
+				opt->cred_file = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "prefix")) {
+				opt->prefix = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "shard")) {
+				opt->shard = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "trace")) {
+				opt->trace = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "trace-file")) {
+				opt->trace_file = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "broker-pid")) {
+				opt->broker_pid = atoi(optarg);
+			} else {
+				pool_opt_set(&opt->pool,
+				    long_options[option_index].name, optarg);
+			}
+			break;
+
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			if (opt->qos < 0 || opt->qos > 2) {
+				fprintf(stderr, "Error: qos invalided!\n");
+				fprintf(stderr, "Usage: %s\n", sub_info);
+				exit(EXIT_FAILURE);
+			}
+
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'C':
+			if (!strcmp(optarg, "true")) {
+				opt->clean = true;
+			} else if (!strcmp(optarg, "false")) {
+				opt->clean = false;
+			} else {
+				fprintf(stderr, "Usage: %s\n", sub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		case '?':
+			fprintf(stderr, "Usage: %s\n", sub_info);
+			exit(EXIT_FAILURE);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", sub_info);
+			exit(EXIT_FAILURE);
+			printf(
+			    "?? getopt returned character code 0%o ??\n", c);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", sub_info);
+		exit(EXIT_FAILURE);
+		while (optind < argc)
+			printf("%s ", argv[optind++]);
+		printf("\n");
+	}
+}
+
+int
+session_opt_set(int argc, char **argv, nnb_session_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:s:h:p:V:c:n:i:u:P:k:S0",
+	            long_options, &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", session_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "queued")) {
+				opt->queued = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "publishers")) {
+				opt->publishers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "broker-pid")) {
+				opt->broker_pid = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", session_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", session_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", session_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 1 || opt->qos > 2) {
+		fprintf(stderr, "Error: offline queueing needs qos 1 or 2!\n");
+		fprintf(stderr, "Usage: %s\n", session_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->queued < 1 || opt->publishers < 1) {
+		fprintf(stderr, "Usage: %s\n", session_info);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+int
+retain_opt_set(int argc, char **argv, nnb_retain_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:s:h:p:V:c:n:i:u:P:k:S0",
+	            long_options, &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", retain_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topics")) {
+				opt->topics = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "publishers")) {
+				opt->publishers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", retain_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", retain_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", retain_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", retain_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 0 || opt->topics < 1 || opt->publishers < 1) {
+		fprintf(stderr, "Usage: %s\n", retain_info);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+int
+search_opt_set(int argc, char **argv, nnb_search_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:s:h:p:V:c:n:i:u:P:k:S0",
+	            long_options, &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", search_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "subscribers")) {
+				opt->subscribers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "rate-start")) {
+				opt->rate_start = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "rate-max")) {
+				opt->rate_max = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "hold")) {
+				opt->hold = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "warmup")) {
+				opt->warmup = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "refine")) {
+				opt->refine = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "slo-p99")) {
+				opt->slo_p99 = atof(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "slo-loss")) {
+				opt->slo_loss = atof(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", search_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", search_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", search_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", search_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->subscribers < 1 || opt->rate_start < 1 ||
+	    opt->rate_max < opt->rate_start || opt->hold < 1 ||
+	    opt->warmup < 0 || opt->slo_p99 <= 0 || opt->slo_loss < 0) {
+		fprintf(stderr, "Usage: %s\n", search_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->size < NNB_STAMP_LEN) {
+		fprintf(stderr, "Error: size must hold the %d byte stamp!\n",
+		    NNB_STAMP_LEN);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+int
+churn_opt_set(int argc, char **argv, nnb_churn_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:s:h:p:V:c:n:i:u:P:k:C:S0",
+	            long_options, &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", churn_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "clean")) {
+				if (!strcmp(optarg, "true")) {
+					opt->clean = true;
+				} else if (!strcmp(optarg, "false")) {
+					opt->clean = false;
+				} else {
+					fprintf(stderr, "Usage: %s\n",
+					    churn_info);
+					exit(EXIT_FAILURE);
+				}
+			} else if (!strcmp(long_options[option_index].name,
+			               "abrupt")) {
+				opt->abrupt = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "churn")) {
+				opt->churn = atof(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "rate")) {
+				opt->rate = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "duration")) {
+				opt->duration = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "publishers")) {
+				opt->publishers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
+				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", churn_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		case 'C':
+			if (!strcmp(optarg, "true")) {
+				opt->clean = true;
+			} else if (!strcmp(optarg, "false")) {
+				opt->clean = false;
+			} else {
+				fprintf(stderr, "Usage: %s\n", churn_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", churn_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", churn_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", churn_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->publishers < 1 || opt->churn < 0 ||
+	    opt->churn > 100 || opt->rate < 0 || opt->duration < 0) {
+		fprintf(stderr, "Usage: %s\n", churn_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->size < NNB_STAMP_LEN) {
+		fprintf(stderr, "Error: size must hold the %d byte stamp!\n",
+		    NNB_STAMP_LEN);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+int
+lwt_opt_set(int argc, char **argv, nnb_lwt_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:h:p:V:c:n:i:u:P:k:S0",
 	            long_options, &option_index)) != -1) {
-		int this_option_optind = optind ? optind : 1;
 		switch (c) {
 		case 0:
-			// printf ("option %s",
-			// long_options[option_index].name); if (optarg)
-			// printf
-			// (" with value %s", optarg); printf ("\n");
 			if (!strcmp(long_options[option_index].name, "help")) {
-				fprintf(stderr, "Usage: %s\n", conn_info);
+				fprintf(stderr, "Usage: %s\n", lwt_info);
 				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
 			} else if (!strcmp(long_options[option_index].name,
 			               "host")) {
 				opt->host = nng_strdup(optarg);
@@ -351,9 +2910,33 @@ conn_opt_set(int argc, char **argv, nnb_conn_opt *opt)
 			} else if (!strcmp(long_options[option_index].name,
 			               "keepalive")) {
 				opt->keepalive = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "qos")) {
+				opt->qos = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "subscribers")) {
+				opt->subscribers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
 			               "ssl")) {
 				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
 			} else if (!strcmp(long_options[option_index].name,
 			               "cafile")) {
 				if (opt->tls.cacert) {
@@ -384,19 +2967,20 @@ conn_opt_set(int argc, char **argv, nnb_conn_opt *opt)
 					opt->tls.keypass = NULL;
 				}
 				opt->tls.keypass = nng_strdup(optarg);
-			} else if (!strcmp(long_options[option_index].name,
-			               "clean")) {
-				if (!strcmp(optarg, "true")) {
-					opt->clean = true;
-				} else if (!strcmp(optarg, "true")) {
-					opt->clean = false;
-				} else {
-					fprintf(
-					    stderr, "Usage: %s\n", conn_info);
-					exit(EXIT_FAILURE);
-				}
+			} else if (!strncmp(long_options[option_index].name,
+			               "will-", 5)) {
+				will_opt_set(&opt->will,
+				    long_options[option_index].name, optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", lwt_info);
+				exit(EXIT_FAILURE);
 			}
-
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
 			break;
 		case 'h':
 			opt->host = nng_strdup(optarg);
@@ -425,67 +3009,49 @@ conn_opt_set(int argc, char **argv, nnb_conn_opt *opt)
 		case 'k':
 			opt->keepalive = atoi(optarg);
 			break;
-		case 'C':
-			if (!strcmp(optarg, "true")) {
-				opt->clean = true;
-			} else if (!strcmp(optarg, "true")) {
-				opt->clean = false;
-			} else {
-				fprintf(stderr, "Usage: %s\n", conn_info);
-				exit(EXIT_FAILURE);
-			}
-			break;
 		case 'S':
 			opt->tls.enable = true;
 			break;
-		case '?':
-			fprintf(stderr, "Usage: %s\n", conn_info);
-			exit(EXIT_FAILURE);
-			break;
 		default:
-			fprintf(stderr, "Usage: %s\n", conn_info);
+			fprintf(stderr, "Usage: %s\n", lwt_info);
 			exit(EXIT_FAILURE);
-			printf(
-			    "?? getopt returned character code 0%o ??\n", c);
 		}
 	}
 	if (optind < argc) {
-		fprintf(stderr, "Usage: %s\n", conn_info);
+		fprintf(stderr, "Usage: %s\n", lwt_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", lwt_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->will.qos < 0 || opt->will.qos > 2) {
+		fprintf(stderr, "Error: will qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", lwt_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->subscribers < 1) {
+		fprintf(stderr, "Usage: %s\n", lwt_info);
 		exit(EXIT_FAILURE);
-		while (optind < argc)
-			printf("%s ", argv[optind++]);
-		printf("\n");
 	}
 
 	return 0;
 }
 
 int
-pub_opt_set(int argc, char **argv, nnb_pub_opt *opt)
+resub_opt_set(int argc, char **argv, nnb_resub_opt *opt)
 {
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
 
-	if (argc < 2) {
-		fprintf(stderr, "Usage: %s\n", pub_info);
-		exit(EXIT_FAILURE);
-	}
-
-	int c;
-	int digit_optind = 0;
-	int option_index = 0;
-	size_t sz;
-
-	while ((c = getopt_long(argc, argv,
-	            "q:l:r:s:t:I:h:p:V:c:n:i:u:P:k:C:L:S0", long_options,
-	            &option_index)) != -1) {
-		int this_option_optind = optind ? optind : 1;
+	while ((c = getopt_long(argc, argv, "q:t:s:h:p:V:c:n:i:u:P:k:S0",
+	            long_options, &option_index)) != -1) {
 		switch (c) {
 		case 0:
-			// printf ("option %s",
-			// long_options[option_index].name); if (optarg)
-			// printf
-			// (" with value %s", optarg); printf ("\n");
 			if (!strcmp(long_options[option_index].name, "help")) {
-				fprintf(stderr, "Usage: %s\n", pub_info);
+				fprintf(stderr, "Usage: %s\n", resub_info);
 				exit(EXIT_FAILURE);
 			} else if (!strcmp(long_options[option_index].name,
 			               "topic")) {
@@ -517,50 +3083,272 @@ pub_opt_set(int argc, char **argv, nnb_pub_opt *opt)
 			} else if (!strcmp(long_options[option_index].name,
 			               "keepalive")) {
 				opt->keepalive = atoi(optarg);
-			} else if (!strcmp(long_options[option_index].name,
-			               "clean")) {
-				if (!strcmp(optarg, "true")) {
-					opt->clean = true;
-				} else if (!strcmp(optarg, "true")) {
-					opt->clean = false;
-				} else {
-					fprintf(
-					    stderr, "Usage: %s\n", pub_info);
-					exit(EXIT_FAILURE);
-				}
 			} else if (!strcmp(long_options[option_index].name,
 			               "qos")) {
 				opt->qos = atoi(optarg);
-				if (opt->qos < 0 || opt->qos > 2) {
-					fprintf(
-					    stderr, "Error: qos invalided!\n");
-					fprintf(
-					    stderr, "Usage: %s\n", pub_info);
-					exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "size")) {
+				opt->size = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "filters")) {
+				opt->filters = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "sub-rate")) {
+				opt->sub_rate = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "rate")) {
+				opt->rate = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "warmup")) {
+				opt->warmup = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "duration")) {
+				opt->duration = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "publishers")) {
+				opt->publishers = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ssl")) {
+				opt->tls.enable = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws")) {
+				opt->tls.ws = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
+			} else if (!strcmp(long_options[option_index].name,
+			               "cafile")) {
+				if (opt->tls.cacert) {
+					free(opt->tls.cacert);
+					opt->tls.cacert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cacert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "certfile")) {
+				if (opt->tls.cert) {
+					free(opt->tls.cert);
+					opt->tls.cert = NULL;
+				}
+				loadfile(
+				    optarg, (void **) &opt->tls.cert, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keyfile")) {
+				if (opt->tls.key) {
+					free(opt->tls.key);
+					opt->tls.key = NULL;
+				}
+				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			} else if (!strcmp(long_options[option_index].name,
+			               "keypass")) {
+				if (opt->tls.keypass) {
+					nng_strfree(opt->tls.keypass);
+					opt->tls.keypass = NULL;
 				}
+				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", resub_info);
+				exit(EXIT_FAILURE);
+			}
+			break;
+		case 't':
+			opt->topic = nng_strdup(optarg);
+			break;
+		case 'q':
+			opt->qos = atoi(optarg);
+			break;
+		case 's':
+			opt->size = atoi(optarg);
+			break;
+		case 'h':
+			opt->host = nng_strdup(optarg);
+			break;
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'V':
+			opt->version = atoi(optarg);
+			break;
+		case 'c':
+			opt->count = atoi(optarg);
+			break;
+		case 'n':
+			opt->startnumber = atoi(optarg);
+			break;
+		case 'i':
+			opt->interval = atoi(optarg);
+			break;
+		case 'u':
+			opt->username = nng_strdup(optarg);
+			break;
+		case 'P':
+			opt->password = nng_strdup(optarg);
+			break;
+		case 'k':
+			opt->keepalive = atoi(optarg);
+			break;
+		case 'S':
+			opt->tls.enable = true;
+			break;
+		default:
+			fprintf(stderr, "Usage: %s\n", resub_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", resub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", resub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->publishers < 1 || opt->filters < 2 ||
+	    opt->sub_rate < 0 || opt->rate < 0 || opt->warmup < 0 ||
+	    opt->duration < 0) {
+		fprintf(stderr, "Usage: %s\n", resub_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->size < NNB_STAMP_LEN) {
+		fprintf(stderr, "Error: size must hold the %d byte stamp!\n",
+		    NNB_STAMP_LEN);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+// True when every name in the comma separated list is a transport.
+static bool
+transport_list_valid(const char *list)
+{
+	const char *p = list;
+	size_t      n;
+
+	for (;;) {
+		n = strcspn(p, ",");
+		if (!((n == 3 && (!strncmp(p, "tcp", n) ||
+		                     !strncmp(p, "tls", n) ||
+		                     !strncmp(p, "wss", n))) ||
+		        (n == 2 && !strncmp(p, "ws", n)) ||
+		        (n == 4 && !strncmp(p, "quic", n)))) {
+			return (false);
+		}
+		if (p[n] == '\0') {
+			return (true);
+		}
+		p += n + 1;
+	}
+}
+
+int
+transport_opt_set(int argc, char **argv, nnb_transport_opt *opt)
+{
+	int    c;
+	int    option_index = 0;
+	size_t sz           = 0;
+
+	while ((c = getopt_long(argc, argv, "q:t:s:h:V:c:n:i:u:P:k:0",
+	            long_options, &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", transport_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "topic")) {
+				opt->topic = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "version")) {
+				opt->version = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "count")) {
+				opt->count = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "startnumber")) {
+				opt->startnumber = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "interval")) {
+				opt->interval = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "username")) {
+				opt->username = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "password")) {
+				opt->password = nng_strdup(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "limit")) {
-				opt->limit = atoi(optarg);
+			               "keepalive")) {
+				opt->keepalive = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "retain")) {
-				if (!strcmp(optarg, "true")) {
-					opt->retain = true;
-				} else if (!strcmp(optarg, "true")) {
-					opt->retain = false;
-				} else {
-					fprintf(
-					    stderr, "Usage: %s\n", pub_info);
-					exit(EXIT_FAILURE);
-				}
+			               "qos")) {
+				opt->qos = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
 			               "size")) {
 				opt->size = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "interval_of_msg")) {
-				opt->interval_of_msg = atoi(optarg);
+			               "subscribers")) {
+				opt->subscribers = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "ssl")) {
-				opt->tls.enable = true;
+			               "rate")) {
+				opt->rate = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "warmup")) {
+				opt->warmup = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "duration")) {
+				opt->duration = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "transports")) {
+				if (opt->transports) {
+					nng_strfree(opt->transports);
+				}
+				opt->transports = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "tcp-port")) {
+				opt->tcp_port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "tls-port")) {
+				opt->tls_port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-port")) {
+				opt->ws_port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "wss-port")) {
+				opt->wss_port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic-port")) {
+				opt->quic_port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "ws-path")) {
+				if (opt->tls.ws_path) {
+					nng_strfree(opt->tls.ws_path);
+				}
+				opt->tls.ws_path = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "quic") ||
+			    !strcmp(long_options[option_index].name,
+			        "quic-0rtt")) {
+				quic_opt_set(&opt->tls,
+				    long_options[option_index].name);
 			} else if (!strcmp(long_options[option_index].name,
 			               "cafile")) {
 				if (opt->tls.cacert) {
@@ -591,35 +3379,23 @@ pub_opt_set(int argc, char **argv, nnb_pub_opt *opt)
 					opt->tls.keypass = NULL;
 				}
 				opt->tls.keypass = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", transport_info);
+				exit(EXIT_FAILURE);
 			}
-
-			break;
-		case 'l':
-			opt->limit = atoi(optarg);
 			break;
 		case 't':
 			opt->topic = nng_strdup(optarg);
 			break;
 		case 'q':
 			opt->qos = atoi(optarg);
-			if (opt->qos < 0 || opt->qos > 2) {
-				fprintf(stderr, "Error: qos invalided!\n");
-				fprintf(stderr, "Usage: %s\n", pub_info);
-				exit(EXIT_FAILURE);
-			}
 			break;
 		case 's':
 			opt->size = atoi(optarg);
 			break;
-		case 'I':
-			opt->interval_of_msg = atoi(optarg);
-			break;
 		case 'h':
 			opt->host = nng_strdup(optarg);
 			break;
-		case 'p':
-			opt->port = atoi(optarg);
-			break;
 		case 'V':
 			opt->version = atoi(optarg);
 			break;
@@ -641,87 +3417,58 @@ pub_opt_set(int argc, char **argv, nnb_pub_opt *opt)
 		case 'k':
 			opt->keepalive = atoi(optarg);
 			break;
-		case 'r':
-			if (!strcmp(optarg, "true")) {
-				opt->retain = true;
-			} else if (!strcmp(optarg, "true")) {
-				opt->retain = false;
-			} else {
-				fprintf(stderr, "Usage: %s\n", pub_info);
-				exit(EXIT_FAILURE);
-			}
-			break;
-		case 'C':
-			if (!strcmp(optarg, "true")) {
-				opt->clean = true;
-			} else if (!strcmp(optarg, "true")) {
-				opt->clean = false;
-			} else {
-				fprintf(stderr, "Usage: %s\n", pub_info);
-				exit(EXIT_FAILURE);
-			}
-			break;
-		case 'L':
-			opt->limit = atoi(optarg);
-			if (opt->limit < 0) {
-				fprintf(stderr, "Usage: %s\n", pub_info);
-				exit(EXIT_FAILURE);
-			}
-			break;
-		case 'S':
-			opt->tls.enable = true;
-			break;
-		case '?':
-			fprintf(stderr, "Usage: %s\n", pub_info);
-			exit(EXIT_FAILURE);
-			break;
 		default:
-			fprintf(stderr, "Usage: %s\n", pub_info);
+			fprintf(stderr, "Usage: %s\n", transport_info);
 			exit(EXIT_FAILURE);
-			printf(
-			    "?? getopt returned character code 0%o ??\n", c);
 		}
 	}
 	if (optind < argc) {
-		fprintf(stderr, "Usage: %s\n", pub_info);
+		fprintf(stderr, "Usage: %s\n", transport_info);
 		exit(EXIT_FAILURE);
-		while (optind < argc)
-			printf("%s ", argv[optind++]);
-		printf("\n");
 	}
-
-	if (opt->topic == NULL) {
-		fprintf(stderr, "Error: topic required\n");
-		fprintf(stderr, "Usage: %s\n", pub_info);
+	if (opt->qos < 0 || opt->qos > 2) {
+		fprintf(stderr, "Error: qos invalided!\n");
+		fprintf(stderr, "Usage: %s\n", transport_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->subscribers < 1 || opt->rate < 0 ||
+	    opt->warmup < 0 || opt->duration < 1) {
+		fprintf(stderr, "Usage: %s\n", transport_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->transports && !transport_list_valid(opt->transports)) {
+		fprintf(stderr, "Error: bad --transports %s\n",
+		    opt->transports);
+		exit(EXIT_FAILURE);
+	}
+#ifndef SUPP_QUIC
+	if (opt->transports && strstr(opt->transports, "quic") != NULL) {
+		fprintf(stderr,
+		    "Error: quic needs a build with -DNNG_ENABLE_QUIC=ON\n");
+		exit(EXIT_FAILURE);
+	}
+#endif
+	if (opt->size < NNB_STAMP_LEN) {
+		fprintf(stderr, "Error: size must hold the %d byte stamp!\n",
+		    NNB_STAMP_LEN);
 		exit(EXIT_FAILURE);
 	}
+
+	return 0;
 }
 
 int
-sub_opt_set(int argc, char **argv, nnb_sub_opt *opt)
+blast_opt_set(int argc, char **argv, nnb_blast_opt *opt)
 {
+	int c;
+	int option_index = 0;
 
-	if (argc < 2) {
-		fprintf(stderr, "Usage: %s\n", sub_info);
-		exit(EXIT_FAILURE);
-	}
-
-	int    c;
-	int    digit_optind = 0;
-	int    option_index = 0;
-	size_t sz           = 0;
-
-	while ((c = getopt_long(argc, argv, "q:t:h:p:V:c:n:i:u:P:k:C:S0",
+	while ((c = getopt_long(argc, argv, "t:s:h:p:V:c:n:i:u:P:k:0",
 	            long_options, &option_index)) != -1) {
-		int this_option_optind = optind ? optind : 1;
 		switch (c) {
 		case 0:
-			// printf ("option %s",
-			// long_options[option_index].name); if (optarg)
-			// printf
-			// (" with value %s", optarg); printf ("\n");
 			if (!strcmp(long_options[option_index].name, "help")) {
-				fprintf(stderr, "Usage: %s\n", sub_info);
+				fprintf(stderr, "Usage: %s\n", blast_info);
 				exit(EXIT_FAILURE);
 			} else if (!strcmp(long_options[option_index].name,
 			               "topic")) {
@@ -754,73 +3501,39 @@ sub_opt_set(int argc, char **argv, nnb_sub_opt *opt)
 			               "keepalive")) {
 				opt->keepalive = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "clean")) {
-				if (!strcmp(optarg, "true")) {
-					opt->clean = true;
-				} else if (!strcmp(optarg, "true")) {
-					opt->clean = false;
-				} else {
-					fprintf(
-					    stderr, "Usage: %s\n", sub_info);
-					exit(EXIT_FAILURE);
-				}
+			               "size")) {
+				opt->size = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "qos")) {
-				opt->qos = atoi(optarg);
-				if (opt->qos < 0 || opt->qos > 2) {
-					fprintf(
-					    stderr, "Error: qos invalided!\n");
-					fprintf(
-					    stderr, "Usage: %s\n", sub_info);
-					exit(EXIT_FAILURE);
-				}
+			               "rate")) {
+				opt->rate = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "ssl")) {
-				opt->tls.enable = true;
+			               "batch")) {
+				opt->batch = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "cafile")) {
-				if (opt->tls.cacert) {
-					free(opt->tls.cacert);
-					opt->tls.cacert = NULL;
-				}
-				loadfile(
-				    optarg, (void **) &opt->tls.cacert, &sz);
+			               "threads")) {
+				opt->threads = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "certfile")) {
-				if (opt->tls.cert) {
-					free(opt->tls.cert);
-					opt->tls.cert = NULL;
-				}
-				loadfile(
-				    optarg, (void **) &opt->tls.cert, &sz);
+			               "duration")) {
+				opt->duration = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "keyfile")) {
-				if (opt->tls.key) {
-					free(opt->tls.key);
-					opt->tls.key = NULL;
-				}
-				loadfile(optarg, (void **) &opt->tls.key, &sz);
+			               "timeout")) {
+				opt->timeout = atoi(optarg);
 			} else if (!strcmp(long_options[option_index].name,
-			               "keypass")) {
-				if (opt->tls.keypass) {
-					nng_strfree(opt->tls.keypass);
-					opt->tls.keypass = NULL;
-				}
-				opt->tls.keypass = nng_strdup(optarg);
+			               "prefix")) {
+				opt->prefix = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "shard")) {
+				opt->shard = nng_strdup(optarg);
+			} else {
+				fprintf(stderr, "Usage: %s\n", blast_info);
+				exit(EXIT_FAILURE);
 			}
 			break;
-
 		case 't':
 			opt->topic = nng_strdup(optarg);
 			break;
-		case 'q':
-			opt->qos = atoi(optarg);
-			if (opt->qos < 0 || opt->qos > 2) {
-				fprintf(stderr, "Error: qos invalided!\n");
-				fprintf(stderr, "Usage: %s\n", sub_info);
-				exit(EXIT_FAILURE);
-			}
-
+		case 's':
+			opt->size = atoi(optarg);
 			break;
 		case 'h':
 			opt->host = nng_strdup(optarg);
@@ -849,35 +3562,121 @@ sub_opt_set(int argc, char **argv, nnb_sub_opt *opt)
 		case 'k':
 			opt->keepalive = atoi(optarg);
 			break;
-		case 'C':
-			if (!strcmp(optarg, "true")) {
-				opt->clean = true;
-			} else if (!strcmp(optarg, "true")) {
-				opt->clean = false;
+		default:
+			fprintf(stderr, "Usage: %s\n", blast_info);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (optind < argc) {
+		fprintf(stderr, "Usage: %s\n", blast_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->version < 3 || opt->version > 5) {
+		fprintf(stderr, "Error: version invalided!\n");
+		fprintf(stderr, "Usage: %s\n", blast_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->count < 1 || opt->threads < 1 || opt->size < 0 ||
+	    opt->rate < 0 || opt->duration < 0 || opt->keepalive < 0 ||
+	    opt->keepalive > 65535) {
+		fprintf(stderr, "Usage: %s\n", blast_info);
+		exit(EXIT_FAILURE);
+	}
+	if (opt->batch < 1 || opt->batch > UIO_MAXIOV) {
+		fprintf(stderr, "Error: batch must be 1 to %d!\n", UIO_MAXIOV);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
+}
+
+int
+proxy_opt_set(int argc, char **argv, nnb_proxy_opt *opt)
+{
+	int c;
+	int option_index = 0;
+
+	while ((c = getopt_long(argc, argv, "h:p:l:", long_options,
+	            &option_index)) != -1) {
+		switch (c) {
+		case 0:
+			if (!strcmp(long_options[option_index].name, "help")) {
+				fprintf(stderr, "Usage: %s\n", proxy_info);
+				exit(EXIT_FAILURE);
+			} else if (!strcmp(long_options[option_index].name,
+			               "host")) {
+				nng_strfree(opt->host);
+				opt->host = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "port")) {
+				opt->port = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "listen")) {
+				opt->listen = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "groups")) {
+				opt->groups = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "delay")) {
+				nng_strfree(opt->delay);
+				opt->delay = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "jitter")) {
+				nng_strfree(opt->jitter);
+				opt->jitter = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "up-rate")) {
+				nng_strfree(opt->up_rate);
+				opt->up_rate = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "down-rate")) {
+				nng_strfree(opt->down_rate);
+				opt->down_rate = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "drop")) {
+				nng_strfree(opt->drop);
+				opt->drop = nng_strdup(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "shared")) {
+				opt->shared = true;
+			} else if (!strcmp(long_options[option_index].name,
+			               "rcvbuf")) {
+				opt->rcvbuf = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "threads")) {
+				opt->threads = atoi(optarg);
+			} else if (!strcmp(long_options[option_index].name,
+			               "duration")) {
+				opt->duration = atoi(optarg);
 			} else {
-				fprintf(stderr, "Usage: %s\n", sub_info);
+				fprintf(stderr, "Usage: %s\n", proxy_info);
 				exit(EXIT_FAILURE);
 			}
 			break;
-		case 'S':
-			opt->tls.enable = true;
+		case 'h':
+			nng_strfree(opt->host);
+			opt->host = nng_strdup(optarg);
 			break;
-		case '?':
-			fprintf(stderr, "Usage: %s\n", sub_info);
-			exit(EXIT_FAILURE);
+		case 'p':
+			opt->port = atoi(optarg);
+			break;
+		case 'l':
+			opt->listen = atoi(optarg);
 			break;
 		default:
-			fprintf(stderr, "Usage: %s\n", sub_info);
+			fprintf(stderr, "Usage: %s\n", proxy_info);
 			exit(EXIT_FAILURE);
-			printf(
-			    "?? getopt returned character code 0%o ??\n", c);
 		}
 	}
 	if (optind < argc) {
-		fprintf(stderr, "Usage: %s\n", sub_info);
+		fprintf(stderr, "Usage: %s\n", proxy_info);
 		exit(EXIT_FAILURE);
-		while (optind < argc)
-			printf("%s ", argv[optind++]);
-		printf("\n");
 	}
+	if (opt->listen < 1 || opt->listen > 65535 || opt->groups < 1 ||
+	    opt->threads < 1 || opt->rcvbuf < 0 || opt->duration < 0) {
+		fprintf(stderr, "Usage: %s\n", proxy_info);
+		exit(EXIT_FAILURE);
+	}
+
+	return 0;
 }
@@ -12,30 +12,119 @@
 #include <nng/nng.h>
 #include <nng/supplemental/util/platform.h>
 
+// Transport of every connection a mode dials: mqtt-tcp, or websocket
+// with ws, each wrapped in TLS when enable is set; or QUIC, which
+// always carries its own TLS.
 typedef struct {
 	bool  enable;
 	char *cacert;
 	char *cert;
 	char *key;
 	char *keypass;
+	bool  ws;
+	char *ws_path;   // websocket endpoint, NULL is /mqtt
+	bool  quic;      // needs a build with NNG_ENABLE_QUIC
+	bool  quic_0rtt; // resume sessions with 0-RTT on redial
 } tls_opt;
 
+typedef struct {
+	char *topic; // NULL sends no will
+	char *payload;
+	int   qos;
+	bool  retain;
+} will_opt;
+
+// nng's worker threads, see nnb_pool.h. A count of 0 stays at nng's
+// default unless auto_size picks it.
+typedef struct {
+	int   task_threads;
+	int   poller_threads;
+	int   resolver_threads;
+	char *cpus;      // pin nng threads round robin, e.g. "0-15,32-47"
+	bool  auto_size; // size from the cores and the client count
+} pool_opt;
+
+typedef enum {
+	SIZE_FIXED,
+	SIZE_UNIFORM,
+	SIZE_LOGNORMAL,
+	SIZE_FILE,
+} size_dist_t;
+
+typedef struct {
+	size_dist_t dist;
+	int         min;
+	int         max;
+	double      sigma; // lognormal only, --size is the median
+	char *      file;  // histogram file, "<size> [weight]" per line
+} size_dist_opt;
+
+typedef struct {
+	char *   host;
+	char *   username;
+	char *   password;
+	int      port;
+	int      version;
+	int      count;
+	int      startnumber;
+	int      interval;
+	int      keepalive;
+	bool     clean;
+	tls_opt  tls;
+	char *   metrics;   // --metrics-listen address, NULL disables
+	will_opt will;      // "%i" in the will topic becomes the client number
+	char *   cred_file; // clientid,username,password per client
+	char *   prefix;    // client ids are <prefix><n>
+	char *   shard;     // "k/n", own slice k of n of the id range
+	bool     reconnect; // drop once after CONNACK and time the redial
+	int      log_level; // NNB_LOG_*, see nnb_log.h
+	pool_opt pool;
+	// TODO future
+	// char	ifaddr[64];
+} nnb_conn_opt;
+
 typedef struct {
 	char *  host;
 	char *  username;
 	char *  password;
+	char *  topic;
 	int     port;
 	int     version;
 	int     count;
 	int     startnumber;
 	int     interval;
 	int     keepalive;
+	int     qos;
 	bool    clean;
 	tls_opt tls;
+
+	char *tree;       // topic tree fanouts, e.g. "10,10,10"
+	int   filters;    // generated filters per client, 0 uses -t only
+	int   plus_ratio; // percent of filters with a '+' level
+	int   hash_ratio; // percent of filters ending in '#'
+	int   sub_batch;  // filters per SUBSCRIBE packet, 0 packs all
+
+	int share_groups;  // $share consumer groups, 0 disables
+	int share_members; // members per group
+	int share_step;    // seconds between adding a member per group
+	int share_churn;   // seconds between a member leaving or rejoining
+
+	char *metrics;    // --metrics-listen address, NULL disables
+	int   trace;      // trace 1 in n stamped deliveries, 0 disables
+	char *trace_file; // Chrome trace JSON output
+	int   broker_pid; // sample broker CPU and RSS when set
+	char *cred_file;  // clientid,username,password per client
+	char *prefix;     // client ids are <prefix><n>
+	char *shard;      // "k/n", own slice k of n of the id range
+	bool  raw;        // receive on plain sockets, see nnb_rawsub.h
+	int   threads;    // --raw receiving threads
+	bool  crc;        // verify the CRC32C ending each payload
+	int   log_level;  // NNB_LOG_*, see nnb_log.h
+
+	pool_opt pool;
 	// TODO future
 	// char	ifaddr[64];
-	// char	prefix[64];
-} nnb_conn_opt;
+} nnb_sub_opt;
 
 typedef struct {
 	char *  host;
@@ -47,15 +136,33 @@ typedef struct {
 	int     count;
 	int     startnumber;
 	int     interval;
+	int     interval_of_msg;
+	int     size;
+	int     limit;
 	int     keepalive;
 	int     qos;
+	bool    retain;
 	bool    clean;
 	tls_opt tls;
+
+	size_dist_opt size_dist;
+	char *        tree;  // publish to random leaves of this topic tree
+	bool          stamp; // write nnb_stamp into payloads
+	bool          crc;   // end payloads with their CRC32C
+
+	char *metrics;    // --metrics-listen address, NULL disables
+	int   trace;      // trace 1 in n publishes, 0 disables
+	char *trace_file; // Chrome trace JSON output
+	int   broker_pid; // sample broker CPU and RSS when set
+	char *cred_file;  // clientid,username,password per client
+	char *prefix;     // client ids are <prefix><n>
+	char *shard;      // "k/n", own slice k of n of the id range
+	int   log_level;  // NNB_LOG_*, see nnb_log.h
+
+	pool_opt pool;
 	// TODO future
-	// bool	ws;
 	// char	ifaddr[64];
-	// char	prefix[64];
-} nnb_sub_opt;
+} nnb_pub_opt;
 
 typedef struct {
 	char *  host;
@@ -64,22 +171,190 @@ typedef struct {
 	char *  topic;
 	int     port;
 	int     version;
-	int     count;
+	int     count; // persistent sessions
 	int     startnumber;
 	int     interval;
-	int     interval_of_msg;
+	int     keepalive;
+	int     qos;
 	int     size;
-	int     limit;
+	int     queued;     // messages published per offline session
+	int     publishers; // publishing clients
+	int     broker_pid; // sample broker RSS when set
+	int     timeout;    // seconds without progress before giving up
+	tls_opt tls;
+} nnb_session_opt;
+
+typedef struct {
+	char *  host;
+	char *  username;
+	char *  password;
+	char *  topic;
+	int     port;
+	int     version;
+	int     count; // subscribers pulling the retained set
+	int     startnumber;
+	int     interval;
 	int     keepalive;
 	int     qos;
-	bool    retain;
+	int     size;
+	int     topics;     // distinct retained topics
+	int     publishers; // publishing clients
+	int     timeout;    // seconds without progress before giving up
+	tls_opt tls;
+} nnb_retain_opt;
+
+typedef struct {
+	char *  host;
+	char *  username;
+	char *  password;
+	char *  topic;
+	int     port;
+	int     version;
+	int     count; // paced publishers
+	int     startnumber;
+	int     interval;
+	int     keepalive;
+	int     qos;
+	int     size;
+	int     subscribers; // in-process subscribers measuring delivery
+	int     rate_start;  // first offered rate, msg/sec
+	int     rate_max;    // the ramp stops here
+	int     hold;        // measured seconds per step
+	int     warmup;      // unmeasured seconds before each step
+	int     refine;      // bisection steps after the ramp
+	double  slo_p99;     // ms
+	double  slo_loss;    // percent
+	int     timeout;     // seconds without progress before giving up
+	tls_opt tls;
+} nnb_search_opt;
+
+typedef struct {
+	char *  host;
+	char *  username;
+	char *  password;
+	char *  topic;
+	int     port;
+	int     version;
+	int     count; // subscribers, each on <topic>/<n>
+	int     startnumber;
+	int     interval;
+	int     keepalive;
+	int     qos;
+	int     size;
 	bool    clean;
+	bool    abrupt;     // close without DISCONNECT
+	double  churn;      // percent of clients reconnecting per second
+	int     rate;       // steady publishes per second over all clients
+	int     publishers; // publishing clients
+	int     duration;   // seconds, 0 runs until interrupted
+	int     timeout;    // seconds without progress before giving up
 	tls_opt tls;
-	// TODO future
-	// bool	ws;
-	// char	ifaddr[64];
-	// char	prefix[64];
-} nnb_pub_opt;
+} nnb_churn_opt;
+
+typedef struct {
+	char *   host;
+	char *   username;
+	char *   password;
+	char *   topic; // wills go to <topic>/<n>
+	int      port;
+	int      version;
+	int      count; // clients dropped at once
+	int      startnumber;
+	int      interval;
+	int      keepalive;
+	int      qos;         // subscription qos
+	int      subscribers; // clients waiting for the wills
+	int      timeout;     // seconds without progress before giving up
+	will_opt will;        // payload, qos and retain of every will
+	tls_opt  tls;
+} nnb_lwt_opt;
+
+typedef struct {
+	char *  host;
+	char *  username;
+	char *  password;
+	char *  topic;
+	int     port;
+	int     version;
+	int     count; // subscribing clients
+	int     startnumber;
+	int     interval;
+	int     keepalive;
+	int     qos;
+	int     size;
+	int     filters;    // ring of filters each client rotates through
+	int     sub_rate;   // filter changes per second over all clients
+	int     rate;       // steady publishes per second over all clients
+	int     publishers; // publishing clients
+	int     warmup;     // baseline seconds before the changes start
+	int     duration;   // seconds, 0 runs until interrupted
+	int     timeout;    // seconds without progress before giving up
+	tls_opt tls;
+} nnb_resub_opt;
+
+typedef struct {
+	char *  host;
+	char *  username;
+	char *  password;
+	char *  topic;
+	int     version;
+	int     count; // publishing clients
+	int     startnumber;
+	int     interval;
+	int     keepalive;
+	int     qos;
+	int     size;
+	int     subscribers; // in-process subscribers measuring delivery
+	int     rate;        // offered msg/sec, 0 publishes unpaced
+	int     warmup;      // unmeasured seconds per transport
+	int     duration;    // measured seconds per transport
+	int     timeout;     // seconds without progress before giving up
+	char *  transports;  // comma separated, run in this order
+	int     tcp_port;
+	int     tls_port;
+	int     ws_port;
+	int     wss_port;
+	int     quic_port;
+	tls_opt tls; // certificates and websocket path for tls and wss
+} nnb_transport_opt;
+
+typedef struct {
+	char *host;
+	char *username;
+	char *password;
+	char *topic;  // "%i" becomes the connection number
+	char *prefix; // client ids are <prefix><n>
+	char *shard;  // "k/n", own slice k of n of the id range
+	int   port;
+	int   version;
+	int   count; // connections
+	int   startnumber;
+	int   interval;
+	int   keepalive;
+	int   size;
+	int   rate;     // msg/sec over all connections, 0 is unpaced
+	int   batch;    // frames per writev
+	int   threads;  // epoll loops
+	int   duration; // seconds, 0 runs until interrupted
+	int   timeout;  // seconds without progress before giving up
+} nnb_blast_opt;
+
+typedef struct {
+	char *host; // broker
+	int   port;
+	int   listen; // port the bench dials instead of the broker
+	int   groups; // connections are dealt to the groups in turn
+	// one value, or one per group, comma separated
+	char *delay;     // msec added each way
+	char *jitter;    // msec, delay varies by up to this either way
+	char *up_rate;   // bytes/sec bench to broker, 0 is uncapped
+	char *down_rate; // bytes/sec broker to bench, read as a slow reader
+	char *drop;      // percent of reads that reset the connection
+	bool  shared;    // caps shared by a group, not per connection
+	int   rcvbuf;    // SO_RCVBUF toward the broker, 0 keeps the default
+	int   threads;   // epoll loops
+	int   duration;  // seconds, 0 runs until interrupted
+} nnb_proxy_opt;
 
 static struct option long_options[] = {
 
@@ -104,9 +379,81 @@ static struct option long_options[] = {
 	{ "certfile", required_argument, NULL, 0 },
 	{ "keyfile", required_argument, NULL, 0 },
 	{ "keypass", required_argument, NULL, 0 },
+	{ "ws", no_argument, NULL, 0 },
+	{ "ws-path", required_argument, NULL, 0 },
+	{ "size-dist", required_argument, NULL, 0 },
+	{ "size-min", required_argument, NULL, 0 },
+	{ "size-max", required_argument, NULL, 0 },
+	{ "size-sigma", required_argument, NULL, 0 },
+	{ "size-file", required_argument, NULL, 0 },
+	{ "tree", required_argument, NULL, 0 },
+	{ "filters", required_argument, NULL, 0 },
+	{ "plus-ratio", required_argument, NULL, 0 },
+	{ "hash-ratio", required_argument, NULL, 0 },
+	{ "sub-batch", required_argument, NULL, 0 },
+	{ "stamp", no_argument, NULL, 0 },
+	{ "share-groups", required_argument, NULL, 0 },
+	{ "share-members", required_argument, NULL, 0 },
+	{ "share-step", required_argument, NULL, 0 },
+	{ "share-churn", required_argument, NULL, 0 },
+	{ "queued", required_argument, NULL, 0 },
+	{ "publishers", required_argument, NULL, 0 },
+	{ "broker-pid", required_argument, NULL, 0 },
+	{ "timeout", required_argument, NULL, 0 },
+	{ "topics", required_argument, NULL, 0 },
+	{ "metrics-listen", required_argument, NULL, 0 },
+	{ "trace", required_argument, NULL, 0 },
+	{ "trace-file", required_argument, NULL, 0 },
+	{ "subscribers", required_argument, NULL, 0 },
+	{ "rate-start", required_argument, NULL, 0 },
+	{ "rate-max", required_argument, NULL, 0 },
+	{ "hold", required_argument, NULL, 0 },
+	{ "warmup", required_argument, NULL, 0 },
+	{ "refine", required_argument, NULL, 0 },
+	{ "slo-p99", required_argument, NULL, 0 },
+	{ "slo-loss", required_argument, NULL, 0 },
+	{ "churn", required_argument, NULL, 0 },
+	{ "abrupt", no_argument, NULL, 0 },
+	{ "rate", required_argument, NULL, 0 },
+	{ "duration", required_argument, NULL, 0 },
+	{ "will-topic", required_argument, NULL, 0 },
+	{ "will-payload", required_argument, NULL, 0 },
+	{ "will-qos", required_argument, NULL, 0 },
+	{ "will-retain", no_argument, NULL, 0 },
+	{ "sub-rate", required_argument, NULL, 0 },
+	{ "cred-file", required_argument, NULL, 0 },
+	{ "prefix", required_argument, NULL, 0 },
+	{ "shard", required_argument, NULL, 0 },
+	{ "transports", required_argument, NULL, 0 },
+	{ "tcp-port", required_argument, NULL, 0 },
+	{ "tls-port", required_argument, NULL, 0 },
+	{ "ws-port", required_argument, NULL, 0 },
+	{ "wss-port", required_argument, NULL, 0 },
+	{ "quic", no_argument, NULL, 0 },
+	{ "quic-0rtt", no_argument, NULL, 0 },
+	{ "quic-port", required_argument, NULL, 0 },
+	{ "reconnect", no_argument, NULL, 0 },
+	{ "batch", required_argument, NULL, 0 },
+	{ "threads", required_argument, NULL, 0 },
+	{ "raw", no_argument, NULL, 0 },
+	{ "crc", no_argument, NULL, 0 },
+	{ "log-level", required_argument, NULL, 0 },
+	{ "task-threads", required_argument, NULL, 0 },
+	{ "poller-threads", required_argument, NULL, 0 },
+	{ "resolver-threads", required_argument, NULL, 0 },
+	{ "nng-cpus", required_argument, NULL, 0 },
+	{ "nng-auto", no_argument, NULL, 0 },
+	{ "listen", required_argument, NULL, 0 },
+	{ "groups", required_argument, NULL, 0 },
+	{ "delay", required_argument, NULL, 0 },
+	{ "jitter", required_argument, NULL, 0 },
+	{ "up-rate", required_argument, NULL, 0 },
+	{ "down-rate", required_argument, NULL, 0 },
+	{ "drop", required_argument, NULL, 0 },
+	{ "shared", no_argument, NULL, 0 },
+	{ "rcvbuf", required_argument, NULL, 0 },
 
 	//  { "ifaddr", 	required_argument, NULL, 0 },
-	//  { "prefix", 	required_argument, NULL, 0 },
 	{ "help", no_argument, NULL, 0 }, { NULL, 0, NULL, 0 }
 };
 
@@ -122,4 +469,40 @@ nnb_pub_opt *nnb_pub_opt_init(int argc, char **argv);
 
 void nnb_pub_opt_destory(nnb_pub_opt *opt);
 
+nnb_session_opt *nnb_session_opt_init(int argc, char **argv);
+
+void nnb_session_opt_destory(nnb_session_opt *opt);
+
+nnb_retain_opt *nnb_retain_opt_init(int argc, char **argv);
+
+void nnb_retain_opt_destory(nnb_retain_opt *opt);
+
+nnb_search_opt *nnb_search_opt_init(int argc, char **argv);
+
+void nnb_search_opt_destory(nnb_search_opt *opt);
+
+nnb_churn_opt *nnb_churn_opt_init(int argc, char **argv);
+
+void nnb_churn_opt_destory(nnb_churn_opt *opt);
+
+nnb_lwt_opt *nnb_lwt_opt_init(int argc, char **argv);
+
+void nnb_lwt_opt_destory(nnb_lwt_opt *opt);
+
+nnb_resub_opt *nnb_resub_opt_init(int argc, char **argv);
+
+void nnb_resub_opt_destory(nnb_resub_opt *opt);
+
+nnb_transport_opt *nnb_transport_opt_init(int argc, char **argv);
+
+void nnb_transport_opt_destory(nnb_transport_opt *opt);
+
+nnb_blast_opt *nnb_blast_opt_init(int argc, char **argv);
+
+void nnb_blast_opt_destory(nnb_blast_opt *opt);
+
+nnb_proxy_opt *nnb_proxy_opt_init(int argc, char **argv);
+
+void nnb_proxy_opt_destory(nnb_proxy_opt *opt);
+
 #endif
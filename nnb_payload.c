@@ -0,0 +1,269 @@
+#include "nnb_payload.h"
+#include "dbg.h"
+#include "nnb_util.h"
+#include <stdlib.h>
+
+// 256 KB, the upper end of the long tail we usually model.
+#define NNB_SIZE_MAX_DEFAULT 262144
+
+typedef struct {
+	uint32_t size;
+	double   cdf;
+} size_bin;
+
+static struct {
+	size_dist_t dist;
+	uint32_t    fixed;
+	uint32_t    min;
+	uint32_t    max;
+	double      mu;
+	double      sigma;
+	size_bin *  bins;
+	int         nbins;
+	uint8_t *   buf;
+	uint32_t    buflen;
+} payload;
+
+const char *
+nnb_payload_dist_name(size_dist_t dist)
+{
+	switch (dist) {
+	case SIZE_FIXED:
+		return "fixed";
+	case SIZE_UNIFORM:
+		return "uniform";
+	case SIZE_LOGNORMAL:
+		return "lognormal";
+	case SIZE_FILE:
+		return "file";
+	}
+	return "unknown";
+}
+
+// Histogram file: one "<size> [weight]" pair per line, '#' comments.
+// A missing weight counts as 1.
+static int
+load_size_file(const char *path)
+{
+	FILE * f;
+	char   line[256];
+	int    cap   = 64;
+	double total = 0;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		log_err("Cannot open size file %s", path);
+		return (-1);
+	}
+	if ((payload.bins = malloc(sizeof(size_bin) * cap)) == NULL) {
+		fclose(f);
+		return (-1);
+	}
+	payload.nbins = 0;
+	while (fgets(line, sizeof(line), f) != NULL) {
+		long   size;
+		double weight;
+		char * p      = line;
+		char * end;
+
+		while (*p == ' ' || *p == '\t') {
+			p++;
+		}
+		if (*p == '#' || *p == '\n' || *p == '\0') {
+			continue;
+		}
+		size = strtol(p, &end, 10);
+		if (end == p || size < 0) {
+			log_err("Bad line in size file %s: %s", path, line);
+			fclose(f);
+			return (-1);
+		}
+		p      = end;
+		weight = strtod(p, &end);
+		if (end == p) {
+			weight = 1;
+		}
+		if (weight <= 0) {
+			continue;
+		}
+		if (payload.nbins == cap) {
+			size_bin *bins;
+			cap *= 2;
+			if ((bins = realloc(payload.bins,
+			         sizeof(size_bin) * cap)) == NULL) {
+				fclose(f);
+				return (-1);
+			}
+			payload.bins = bins;
+		}
+		total += weight;
+		payload.bins[payload.nbins].size = (uint32_t) size;
+		payload.bins[payload.nbins].cdf  = total;
+		payload.nbins++;
+		if ((uint32_t) size > payload.max) {
+			payload.max = (uint32_t) size;
+		}
+	}
+	fclose(f);
+
+	if (payload.nbins == 0) {
+		log_err("Size file %s has no entries", path);
+		return (-1);
+	}
+	for (int i = 0; i < payload.nbins; i++) {
+		payload.bins[i].cdf /= total;
+	}
+	return (0);
+}
+
+int
+nnb_payload_init(nnb_pub_opt *opt)
+{
+	size_dist_opt *d = &opt->size_dist;
+
+	payload.dist  = d->dist;
+	payload.fixed = opt->size;
+	payload.min   = d->min > 0 ? d->min : 0;
+	payload.max   = d->max;
+
+	switch (d->dist) {
+	case SIZE_FIXED:
+		payload.max = opt->size;
+		break;
+	case SIZE_UNIFORM:
+		if (payload.max == 0) {
+			payload.max = opt->size;
+		}
+		break;
+	case SIZE_LOGNORMAL:
+		// --size is the median of the distribution
+		if (payload.max == 0) {
+			payload.max = NNB_SIZE_MAX_DEFAULT;
+		}
+		payload.mu    = log(opt->size > 0 ? opt->size : 1);
+		payload.sigma = d->sigma;
+		break;
+	case SIZE_FILE:
+		payload.max = 0;
+		if (d->file == NULL || load_size_file(d->file) != 0) {
+			return (-1);
+		}
+		break;
+	}
+	if (payload.min > payload.max) {
+		log_err("Payload size min %u is larger than max %u",
+		    payload.min, payload.max);
+		return (-1);
+	}
+
+	// one extra byte so an empty distribution still gets a valid pointer
+	payload.buflen = payload.max + 1;
+	if ((payload.buf = nng_alloc(payload.buflen)) == NULL) {
+		return (-1);
+	}
+	memset(payload.buf, 'A', payload.buflen);
+
+	return (0);
+}
+
+void
+nnb_payload_fini(void)
+{
+	if (payload.buf) {
+		nng_free(payload.buf, payload.buflen);
+		payload.buf = NULL;
+	}
+	if (payload.bins) {
+		free(payload.bins);
+		payload.bins = NULL;
+	}
+}
+
+uint8_t *
+nnb_payload_buf(void)
+{
+	return payload.buf;
+}
+
+uint32_t
+nnb_payload_max(void)
+{
+	return payload.max;
+}
+
+bool
+nnb_payload_fixed(void)
+{
+	return payload.dist == SIZE_FIXED;
+}
+
+uint32_t
+nnb_payload_size(uint64_t *seed)
+{
+	double   v;
+	int      lo, hi;
+	uint32_t size = payload.fixed;
+
+	switch (payload.dist) {
+	case SIZE_FIXED:
+		return payload.fixed;
+	case SIZE_UNIFORM:
+		size = payload.min +
+		    (uint32_t) (nnb_rand(seed) %
+		        ((uint64_t) payload.max - payload.min + 1));
+		break;
+	case SIZE_LOGNORMAL:
+		v = exp(payload.mu + payload.sigma * nnb_rand_normal(seed));
+		size = v >= payload.max ? payload.max : (uint32_t) v;
+		break;
+	case SIZE_FILE:
+		v  = nnb_rand_double(seed);
+		lo = 0;
+		hi = payload.nbins - 1;
+		while (lo < hi) {
+			int mid = (lo + hi) / 2;
+			if (payload.bins[mid].cdf <= v) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		size = payload.bins[lo].size;
+		break;
+	}
+	if (size < payload.min) {
+		size = payload.min;
+	}
+	if (size > payload.max) {
+		size = payload.max;
+	}
+	return size;
+}
+
+void
+nnb_stamp_write(uint8_t *buf, const nnb_stamp *st)
+{
+	uint32_t magic = NNB_STAMP_MAGIC;
+
+	memcpy(buf, &magic, 4);
+	memcpy(buf + 4, &st->pub_id, 4);
+	memcpy(buf + 8, &st->seq, 8);
+	memcpy(buf + 16, &st->ts_us, 8);
+}
+
+bool
+nnb_stamp_read(const uint8_t *buf, uint32_t len, nnb_stamp *st)
+{
+	uint32_t magic;
+
+	if (buf == NULL || len < NNB_STAMP_LEN) {
+		return false;
+	}
+	memcpy(&magic, buf, 4);
+	if (magic != NNB_STAMP_MAGIC) {
+		return false;
+	}
+	memcpy(&st->pub_id, buf + 4, 4);
+	memcpy(&st->seq, buf + 8, 8);
+	memcpy(&st->ts_us, buf + 16, 8);
+	return true;
+}
@@ -0,0 +1,37 @@
+#ifndef NNB_PAYLOAD_H
+#define NNB_PAYLOAD_H
+#include "nnb_opt.h"
+#include <stdint.h>
+
+// Publisher payloads are slices of one preallocated buffer sized for the
+// largest payload the distribution can produce, so the send path never
+// allocates or fills payload memory per message.
+
+int      nnb_payload_init(nnb_pub_opt *opt);
+void     nnb_payload_fini(void);
+uint8_t *nnb_payload_buf(void);
+uint32_t nnb_payload_max(void);
+bool     nnb_payload_fixed(void);
+
+// Draws the next payload size; seed is owned by the caller.
+uint32_t nnb_payload_size(uint64_t *seed);
+
+const char *nnb_payload_dist_name(size_dist_t dist);
+
+// With --stamp, publishers write this header into the first bytes of
+// every payload that is large enough, so subscribers can measure
+// end-to-end latency and spot gaps. Fields are in host byte order; the
+// bench runs on one architecture.
+#define NNB_STAMP_MAGIC 0x314e4e42 // "BNN1"
+#define NNB_STAMP_LEN 24
+
+typedef struct {
+	uint32_t pub_id; // publishing client index
+	uint64_t seq;    // per-publisher sequence number
+	uint64_t ts_us;  // nnb_realtime_us() at send
+} nnb_stamp;
+
+void nnb_stamp_write(uint8_t *buf, const nnb_stamp *st);
+bool nnb_stamp_read(const uint8_t *buf, uint32_t len, nnb_stamp *st);
+
+#endif
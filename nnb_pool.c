@@ -0,0 +1,339 @@
+#define _GNU_SOURCE // sched_setaffinity and cpu_set_t
+#include "nnb_pool.h"
+#include "dbg.h"
+#include "nnb_proc.h"
+#include "nnb_util.h"
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// nng_init_set_parameter came with nng 1.6; older trees only take the
+// NNG_NUM_TASKQ_THREADS and NNG_MAX_TASKQ_THREADS build options.
+#if NNG_MAJOR_VERSION > 1 || \
+    (NNG_MAJOR_VERSION == 1 && NNG_MINOR_VERSION >= 6)
+#define POOL_INIT_PARAMS
+#endif
+
+#define POOL_CPUS 1024
+#define POOL_CLIENTS_PER_TASK 64 // --nng-auto sizing
+#define POOL_CLIENTS_PER_POLLER 2048
+#define POOL_CLIENTS_PER_RESOLVER 1024
+#define POOL_MAX_RESOLVERS 4
+
+typedef struct {
+	int      tid;
+	char     name[16]; // comm, nng names its threads nng:<role>
+	bool     pinned;   // pinning was tried
+	int      cpu;      // pinned to, -1 if not
+	uint64_t cpu0_us;  // thread cpu time when first seen
+	uint64_t cpu_us;   // at the last sample
+	uint64_t seen_us;  // clock when first seen
+	uint64_t at_us;    // clock at the last sample
+} pool_thread;
+
+static struct {
+	int         task; // 0 leaves nng's default
+	int         poller;
+	int         resolver;
+	bool        auto_size;
+	int         cpus[POOL_CPUS];
+	int         ncpus;
+	int         next; // round robin over cpus
+	pool_thread threads[NNB_POOL_THREADS];
+	int         nthreads;
+} pool;
+
+__thread nnb_pool_cb *nnb_pool_self;
+
+// The last slot is shared by threads past NNB_POOL_THREADS.
+static nnb_pool_cb pool_cbs[NNB_POOL_THREADS + 1];
+static atomic_int  pool_ncbs;
+
+nnb_pool_cb *
+nnb_pool_claim(void)
+{
+	int i = atomic_fetch_add(&pool_ncbs, 1);
+
+	if (i >= NNB_POOL_THREADS) {
+		return (&pool_cbs[NNB_POOL_THREADS]);
+	}
+	pool_cbs[i].tid = (int) syscall(SYS_gettid);
+	return (&pool_cbs[i]);
+}
+
+// "0-15,32-47" into pool.cpus.
+static int
+pool_parse_cpus(const char *list)
+{
+	const char *p = list;
+	char *      end;
+	long        lo;
+	long        hi;
+
+	pool.ncpus = 0;
+	while (*p != '\0') {
+		lo = strtol(p, &end, 10);
+		if (end == p || lo < 0) {
+			return (-1);
+		}
+		hi = lo;
+		if (*end == '-') {
+			p  = end + 1;
+			hi = strtol(p, &end, 10);
+			if (end == p || hi < lo) {
+				return (-1);
+			}
+		}
+		if (hi >= CPU_SETSIZE) {
+			return (-1);
+		}
+		for (long c = lo; c <= hi && pool.ncpus < POOL_CPUS; c++) {
+			pool.cpus[pool.ncpus++] = (int) c;
+		}
+		if (*end == ',') {
+			end++;
+		} else if (*end != '\0') {
+			return (-1);
+		}
+		p = end;
+	}
+	return (pool.ncpus > 0 ? 0 : -1);
+}
+
+static int
+pool_clamp(int v, int lo, int hi)
+{
+	return (v < lo ? lo : v > hi ? hi : v);
+}
+
+static const char *
+pool_count(int n, char *buf, size_t len)
+{
+	if (n == 0) {
+		return ("default");
+	}
+	snprintf(buf, len, "%d", n);
+	return (buf);
+}
+
+int
+nnb_pool_setup(pool_opt *opt, int clients)
+{
+	char t[16], p[16], r[16];
+	int  ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (opt->cpus != NULL && pool_parse_cpus(opt->cpus) != 0) {
+		fprintf(stderr, "Error: bad --nng-cpus %s\n", opt->cpus);
+		return (-1);
+	}
+	pool.task      = opt->task_threads;
+	pool.poller    = opt->poller_threads;
+	pool.resolver  = opt->resolver_threads;
+	pool.auto_size = opt->auto_size;
+	if (pool.auto_size) {
+		// pinned threads only get the --nng-cpus cores
+		int cores = pool.ncpus > 0 ? pool.ncpus : ncpu > 0 ? ncpu : 1;
+
+		if (pool.task == 0) {
+			pool.task = pool_clamp(
+			    clients / POOL_CLIENTS_PER_TASK, 2, cores);
+		}
+		if (pool.poller == 0) {
+			pool.poller =
+			    pool_clamp(clients / POOL_CLIENTS_PER_POLLER, 1,
+			        cores / 8 > 1 ? cores / 8 : 1);
+		}
+		if (pool.resolver == 0) {
+			pool.resolver =
+			    pool_clamp(clients / POOL_CLIENTS_PER_RESOLVER, 1,
+			        POOL_MAX_RESOLVERS);
+		}
+	}
+	if (pool.task == 0 && pool.poller == 0 && pool.resolver == 0) {
+		return (0);
+	}
+#ifdef POOL_INIT_PARAMS
+	if (pool.task > 0) {
+		// the max defaults to 16, which a larger count would hit
+		nng_init_set_parameter(NNG_INIT_NUM_TASK_THREADS, pool.task);
+		nng_init_set_parameter(NNG_INIT_MAX_TASK_THREADS, pool.task);
+	}
+	if (pool.poller > 0) {
+		nng_init_set_parameter(
+		    NNG_INIT_NUM_POLLER_THREADS, pool.poller);
+		nng_init_set_parameter(
+		    NNG_INIT_MAX_POLLER_THREADS, pool.poller);
+	}
+	if (pool.resolver > 0) {
+		nng_init_set_parameter(
+		    NNG_INIT_NUM_RESOLVER_THREADS, pool.resolver);
+	}
+	printf("nng threads: task=%s, poller=%s, resolver=%s%s\n",
+	    pool_count(pool.task, t, sizeof(t)),
+	    pool_count(pool.poller, p, sizeof(p)),
+	    pool_count(pool.resolver, r, sizeof(r)),
+	    pool.auto_size ? " (auto)" : "");
+#else
+	(void) t;
+	(void) p;
+	(void) r;
+	log_warn("nng %d.%d cannot size its threads at run time, rebuild "
+	         "it with NNG_NUM_TASKQ_THREADS and NNG_MAX_TASKQ_THREADS",
+	    NNG_MAJOR_VERSION, NNG_MINOR_VERSION);
+	pool.task = pool.poller = pool.resolver = 0;
+#endif
+	return (0);
+}
+
+static uint64_t
+pool_calls(int tid)
+{
+	int n = pool_ncbs < NNB_POOL_THREADS ? pool_ncbs : NNB_POOL_THREADS;
+
+	for (int i = 0; i < n; i++) {
+		if (pool_cbs[i].tid == tid) {
+			return (pool_cbs[i].calls);
+		}
+	}
+	return (0);
+}
+
+static pool_thread *
+pool_find(int tid)
+{
+	for (int i = 0; i < pool.nthreads; i++) {
+		if (pool.threads[i].tid == tid) {
+			return (&pool.threads[i]);
+		}
+	}
+	return (NULL);
+}
+
+static void
+pool_comm(pool_thread *t)
+{
+	char  path[64];
+	FILE *f;
+
+	snprintf(path, sizeof(path), "/proc/self/task/%d/comm", t->tid);
+	t->name[0] = '\0';
+	if ((f = fopen(path, "r")) != NULL) {
+		if (fgets(t->name, sizeof(t->name), f) != NULL) {
+			t->name[strcspn(t->name, "\n")] = '\0';
+		}
+		fclose(f);
+	}
+}
+
+// Threads nng started: named nng:*, or unnamed ones that have run a
+// callback. The main thread runs the first callbacks itself and is left
+// where it is.
+static bool
+pool_is_nng(pool_thread *t)
+{
+	return (strncmp(t->name, "nng:", 4) == 0 ||
+	    (t->tid != getpid() && pool_calls(t->tid) > 0));
+}
+
+static void
+pool_pin(pool_thread *t)
+{
+	cpu_set_t set;
+	int       cpu = pool.cpus[pool.next++ % pool.ncpus];
+
+	t->pinned = true;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(t->tid, sizeof(set), &set) != 0) {
+		log_warn("cannot pin thread %d to cpu %d: %s", t->tid, cpu,
+		    strerror(errno));
+		return;
+	}
+	t->cpu = cpu;
+}
+
+void
+nnb_pool_tick(void)
+{
+	nnb_proc_stat st;
+	uint64_t      now = nnb_clock_us();
+
+	if (nnb_proc_sample(0, &st) != 0) {
+		return;
+	}
+	for (int i = 0; i < st.threads; i++) {
+		pool_thread *t = pool_find(st.tids[i]);
+
+		if (t == NULL) {
+			if (pool.nthreads == NNB_POOL_THREADS) {
+				continue;
+			}
+			t          = &pool.threads[pool.nthreads++];
+			t->tid     = st.tids[i];
+			t->pinned  = false;
+			t->cpu     = -1;
+			t->cpu0_us = st.thread_us[i];
+			t->seen_us = now;
+			pool_comm(t);
+		}
+		t->cpu_us = st.thread_us[i];
+		t->at_us  = now;
+		if (pool.ncpus > 0 && !t->pinned && pool_is_nng(t)) {
+			pool_pin(t);
+		}
+	}
+}
+
+void
+nnb_pool_report(void)
+{
+	int      n     = pool_ncbs < NNB_POOL_THREADS ? pool_ncbs
+	                                              : NNB_POOL_THREADS;
+	uint64_t total = pool_cbs[NNB_POOL_THREADS].calls;
+	uint64_t most  = 0;
+	int      busy  = 0;
+	char     cpu[16];
+
+	nnb_pool_tick();
+	for (int i = 0; i < n; i++) {
+		uint64_t c = pool_cbs[i].calls;
+
+		total += c;
+		busy += c > 0;
+		if (c > most) {
+			most = c;
+		}
+	}
+	if (total == 0) {
+		return;
+	}
+	printf("callback threads:\n");
+	printf("  %-16s %8s %6s %12s %7s %5s\n", "thread", "tid", "cpu",
+	    "callbacks", "share", "core");
+	for (int i = 0; i < pool.nthreads; i++) {
+		pool_thread *t     = &pool.threads[i];
+		uint64_t     calls = pool_calls(t->tid);
+		uint64_t     us    = t->at_us - t->seen_us;
+
+		if (!pool_is_nng(t) && calls == 0) {
+			continue;
+		}
+		snprintf(cpu, sizeof(cpu), "%d", t->cpu);
+		printf("  %-16s %8d %5.0f%% %12llu %6.1f%% %5s\n", t->name,
+		    t->tid,
+		    us ? (double) (t->cpu_us - t->cpu0_us) * 100 / us : 0.0,
+		    (unsigned long long) calls, (double) calls * 100 / total,
+		    t->cpu >= 0 ? cpu : "-");
+	}
+	if (pool_cbs[NNB_POOL_THREADS].calls > 0) {
+		printf("  (%d more threads) %llu callbacks\n",
+		    pool_ncbs - NNB_POOL_THREADS,
+		    (unsigned long long) pool_cbs[NNB_POOL_THREADS].calls);
+	}
+	printf("callback imbalance: busiest thread ran %.1fx the mean of "
+	       "%d threads\n",
+	    busy ? (double) most * busy / total : 0.0, busy);
+}
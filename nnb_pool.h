@@ -0,0 +1,46 @@
+#ifndef NNB_POOL_H
+#define NNB_POOL_H
+#include "nnb_opt.h"
+#include <stdatomic.h>
+#include <stdint.h>
+
+// nng's own threads: the task queue that runs every aio and pipe
+// callback, the socket pollers and the name resolvers. Their counts can
+// only be set before nng starts, so nnb_pool_setup has to run before
+// anything opens a socket, starts a thread or serves metrics.
+#define NNB_POOL_THREADS 256 // threads tracked for the report
+
+// Callbacks run on each thread. A thread claims its slot on its first
+// callback; slots are a cache line each so counting stays thread local.
+typedef struct {
+	_Alignas(64) atomic_uint_fast64_t calls;
+	int tid;
+} nnb_pool_cb;
+
+extern __thread nnb_pool_cb *nnb_pool_self;
+
+nnb_pool_cb *nnb_pool_claim(void);
+
+// Called first thing in every nng callback.
+static inline void
+nnb_pool_callback(void)
+{
+	if (nnb_pool_self == NULL) {
+		nnb_pool_self = nnb_pool_claim();
+	}
+	atomic_fetch_add_explicit(
+	    &nnb_pool_self->calls, 1, memory_order_relaxed);
+}
+
+// Sizes nng's threads from opt, or from the cores and clients with
+// --nng-auto. Returns 0, or -1 on a bad --nng-cpus list.
+int nnb_pool_setup(pool_opt *opt, int clients);
+
+// Driven by the once-a-second main loop: pins nng threads that started
+// since the last tick to --nng-cpus and samples their CPU time.
+void nnb_pool_tick(void);
+
+// Per-thread CPU and callback share, and how uneven the callbacks were.
+void nnb_pool_report(void);
+
+#endif
@@ -0,0 +1,293 @@
+#include "nnb_proc.h"
+#include "dbg.h"
+#include "nnb_util.h"
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define PROC_SATURATED 0.9 // of a core for one thread, of all for the bench
+
+typedef struct {
+	int           pid; // 0 for the bench
+	bool          ok;
+	nnb_proc_stat first;
+	nnb_proc_stat last;
+	uint64_t      first_us;
+	uint64_t      last_us;
+	double        peak_cpu;    // cores, over one interval
+	double        peak_thread; // share of one core, busiest thread
+	uint64_t      peak_rss;
+} proc_track;
+
+static struct {
+	proc_track self;
+	proc_track broker;
+	int        ncpu;
+	long       hz;
+	int        ticks;
+	int        saturated; // intervals in which the bench was saturated
+} proc;
+
+// utime and stime of a /proc/.../stat file in usec. The command name may
+// contain spaces and parentheses, so parsing starts after the last ')'.
+static int
+proc_stat_cpu(const char *path, uint64_t *us)
+{
+	char          buf[1024];
+	char *        p;
+	unsigned long utime, stime;
+	FILE *        f;
+	size_t        n;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		return (-1);
+	}
+	n = fread(buf, 1, sizeof(buf) - 1, f);
+	fclose(f);
+	buf[n] = '\0';
+	if ((p = strrchr(buf, ')')) == NULL ||
+	    sscanf(p + 1,
+	        " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",
+	        &utime, &stime) != 2) {
+		return (-1);
+	}
+	*us = (uint64_t) (utime + stime) * 1000000 / proc.hz;
+	return (0);
+}
+
+static void
+proc_status(const char *path, nnb_proc_stat *st, bool rss)
+{
+	char     line[256];
+	uint64_t v;
+	FILE *   f;
+
+	if ((f = fopen(path, "r")) == NULL) {
+		return;
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		if (rss && sscanf(line, "VmRSS: %" SCNu64 " kB", &v) == 1) {
+			st->rss = v * 1024;
+		} else if (sscanf(line, "voluntary_ctxt_switches: %" SCNu64,
+		               &v) == 1) {
+			st->vcsw += v;
+		} else if (sscanf(line,
+		               "nonvoluntary_ctxt_switches: %" SCNu64,
+		               &v) == 1) {
+			st->ivcsw += v;
+		}
+	}
+	fclose(f);
+}
+
+int
+nnb_proc_sample(int pid, nnb_proc_stat *st)
+{
+	char           base[64];
+	char           path[128];
+	DIR *          dir;
+	struct dirent *ent;
+
+	if (proc.hz == 0) {
+		proc.hz = sysconf(_SC_CLK_TCK);
+	}
+	memset(st, 0, sizeof(*st));
+	if (pid > 0) {
+		snprintf(base, sizeof(base), "/proc/%d", pid);
+	} else {
+		snprintf(base, sizeof(base), "/proc/self");
+	}
+	snprintf(path, sizeof(path), "%s/stat", base);
+	if (proc_stat_cpu(path, &st->cpu_us) != 0) {
+		return (-1);
+	}
+	snprintf(path, sizeof(path), "%s/status", base);
+	proc_status(path, st, true);
+	// context switches in the process status are the main thread's only
+	st->vcsw  = 0;
+	st->ivcsw = 0;
+
+	snprintf(path, sizeof(path), "%s/task", base);
+	if ((dir = opendir(path)) == NULL) {
+		return (0);
+	}
+	while ((ent = readdir(dir)) != NULL) {
+		int tid = atoi(ent->d_name);
+		if (tid <= 0) {
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s/task/%d/status", base, tid);
+		proc_status(path, st, false);
+		if (st->threads < NNB_PROC_THREADS) {
+			snprintf(path, sizeof(path), "%s/task/%d/stat", base,
+			    tid);
+			if (proc_stat_cpu(path, &st->thread_us[st->threads]) ==
+			    0) {
+				st->tids[st->threads++] = tid;
+			}
+		}
+	}
+	closedir(dir);
+	if (pid <= 0) {
+		struct rusage ru;
+
+		if (getrusage(RUSAGE_SELF, &ru) == 0) {
+			st->vcsw  = ru.ru_nvcsw;
+			st->ivcsw = ru.ru_nivcsw;
+		}
+	}
+	return (0);
+}
+
+uint64_t
+nnb_proc_rss(int pid)
+{
+	nnb_proc_stat st;
+
+	if (nnb_proc_sample(pid, &st) != 0) {
+		return (0);
+	}
+	return (st.rss);
+}
+
+// Busiest thread between two samples as a share of one core.
+static double
+proc_busiest(nnb_proc_stat *prev, nnb_proc_stat *cur, uint64_t us)
+{
+	uint64_t best = 0;
+
+	for (int i = 0; i < cur->threads; i++) {
+		for (int j = 0; j < prev->threads; j++) {
+			if (prev->tids[j] == cur->tids[i] &&
+			    cur->thread_us[i] - prev->thread_us[j] > best) {
+				best = cur->thread_us[i] - prev->thread_us[j];
+			}
+		}
+	}
+	return (us ? (double) best / us : 0);
+}
+
+static void
+proc_track_start(proc_track *t, int pid)
+{
+	memset(t, 0, sizeof(*t));
+	t->pid = pid;
+	if (nnb_proc_sample(pid, &t->first) == 0) {
+		t->ok       = true;
+		t->last     = t->first;
+		t->first_us = t->last_us = nnb_clock_us();
+	} else if (pid > 0) {
+		log_warn("cannot read /proc/%d, broker not sampled", pid);
+	}
+}
+
+// Samples a tracked process, returns cores used since the last tick.
+static double
+proc_track_tick(proc_track *t, double *thread)
+{
+	nnb_proc_stat st;
+	uint64_t      now = nnb_clock_us();
+	uint64_t      us  = now - t->last_us;
+	double        cpu;
+
+	if (!t->ok || nnb_proc_sample(t->pid, &st) != 0 || us == 0) {
+		return (0);
+	}
+	cpu     = (double) (st.cpu_us - t->last.cpu_us) / us;
+	*thread = proc_busiest(&t->last, &st, us);
+	if (cpu > t->peak_cpu) {
+		t->peak_cpu = cpu;
+	}
+	if (*thread > t->peak_thread) {
+		t->peak_thread = *thread;
+	}
+	if (st.rss > t->peak_rss) {
+		t->peak_rss = st.rss;
+	}
+	t->last    = st;
+	t->last_us = now;
+	return (cpu);
+}
+
+void
+nnb_proc_start(int broker_pid)
+{
+	proc.ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	if (proc.ncpu < 1) {
+		proc.ncpu = 1;
+	}
+	proc_track_start(&proc.self, 0);
+	if (broker_pid > 0) {
+		proc_track_start(&proc.broker, broker_pid);
+	}
+}
+
+void
+nnb_proc_tick(void)
+{
+	double thread = 0;
+	double cpu    = proc_track_tick(&proc.self, &thread);
+	double broker_thread;
+
+	proc_track_tick(&proc.broker, &broker_thread);
+	++proc.ticks;
+	if (cpu >= PROC_SATURATED * proc.ncpu ||
+	    thread >= PROC_SATURATED) {
+		++proc.saturated;
+		fprintf(stderr,
+		    "WARNING: bench saturated, cpu=%.0f%% of %d cores, "
+		    "busiest thread=%.0f%%, rates now measure nano_bench "
+		    "rather than the broker\n",
+		    cpu * 100, proc.ncpu, thread * 100);
+	}
+}
+
+static uint64_t
+proc_delta(uint64_t from, uint64_t to)
+{
+	return (to > from ? to - from : 0);
+}
+
+static void
+proc_track_report(
+    proc_track *t, const char *name, uint64_t msgs, int clients)
+{
+	nnb_proc_stat *a     = &t->first;
+	nnb_proc_stat *b     = &t->last;
+	uint64_t       cpu   = b->cpu_us - a->cpu_us;
+	uint64_t       us    = t->last_us - t->first_us;
+	uint64_t       rss   = proc_delta(a->rss, b->rss);
+	uint64_t       vcsw  = proc_delta(a->vcsw, b->vcsw);
+	uint64_t       ivcsw = proc_delta(a->ivcsw, b->ivcsw);
+
+	if (!t->ok || us == 0) {
+		return;
+	}
+	printf("%s: cpu=%.2f cores avg, %.2f peak, busiest thread peak "
+	       "%.0f%%, rss=%.1f MB peak\n",
+	    name, (double) cpu / us, t->peak_cpu, t->peak_thread * 100,
+	    t->peak_rss / 1048576.0);
+	printf("%s: cpu=%.2f usec/msg, ctx switches=%.3f/msg "
+	       "(%" PRIu64 " voluntary, %" PRIu64 " involuntary), "
+	       "rss growth=%.0f bytes/client\n",
+	    name, msgs ? (double) cpu / msgs : 0.0,
+	    msgs ? (double) (vcsw + ivcsw) / msgs : 0.0, vcsw, ivcsw,
+	    clients ? (double) rss / clients : 0.0);
+}
+
+void
+nnb_proc_report(uint64_t msgs, int clients)
+{
+	proc_track_report(&proc.self, "self", msgs, clients);
+	proc_track_report(&proc.broker, "broker", msgs, clients);
+	if (proc.saturated > 0) {
+		fprintf(stderr,
+		    "WARNING: nano_bench was saturated in %d of %d seconds, "
+		    "add bench hosts before trusting the rates above\n",
+		    proc.saturated, proc.ticks);
+	}
+}
@@ -0,0 +1,37 @@
+#ifndef NNB_PROC_H
+#define NNB_PROC_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// Resource accounting from /proc, for the bench itself and optionally
+// the broker, so a rate ceiling can be told apart from the bench
+// running out of CPU.
+#define NNB_PROC_THREADS 256 // threads tracked for the busiest one
+
+typedef struct {
+	uint64_t cpu_us; // utime + stime of the whole process
+	uint64_t rss;    // bytes
+	uint64_t vcsw;   // voluntary context switches, see nnb_proc_sample
+	uint64_t ivcsw;  // involuntary context switches
+	int      threads;
+	int      tids[NNB_PROC_THREADS];
+	uint64_t thread_us[NNB_PROC_THREADS];
+} nnb_proc_stat;
+
+// Reads /proc/<pid>, pid 0 is the bench itself. Returns 0 on success.
+// The bench's context switches come from getrusage and include threads
+// that have exited; another process's are summed over its live threads,
+// so they can go down when one exits.
+int nnb_proc_sample(int pid, nnb_proc_stat *st);
+
+// Resident set size in bytes, 0 if it cannot be read.
+uint64_t nnb_proc_rss(int pid);
+
+// Interval sampler driven by the once-a-second main loop; warns as soon
+// as the bench looks saturated. The report divides by msgs, the messages
+// sent or received, and by clients for RSS growth per client.
+void nnb_proc_start(int broker_pid);
+void nnb_proc_tick(void);
+void nnb_proc_report(uint64_t msgs, int clients);
+
+#endif
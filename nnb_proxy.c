@@ -0,0 +1,765 @@
+#define _GNU_SOURCE // splice, pipe2, accept4 and the pipe size fcntls
+#include "nnb_proxy.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_util.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define PROXY_EVENTS 256
+#define PROXY_CHUNKS 64        // reads in flight each way, merged by due
+#define PROXY_PIPE (1 << 20)   // bytes in flight each way, if allowed
+#define PROXY_READ (64 * 1024) // most bytes moved per splice
+#define PROXY_MERGE_US 1000    // reads due this close share a chunk
+#define PROXY_GRANT 1024       // smallest read a rate cap allows
+#define PROXY_BURST_US 100000  // a rate cap lets this much build up
+#define PROXY_IDLE_MS 100      // longest epoll wait, for stopping
+#define PROXY_MAX_GROUPS 256
+
+enum { PROXY_UP, PROXY_DOWN };       // bench to broker, and back
+enum { PROXY_CLIENT, PROXY_BROKER }; // the two sockets
+
+// Worker counters, the byte counts indexed by direction.
+enum {
+	PROXY_UP_BYTES,
+	PROXY_DOWN_BYTES,
+	PROXY_RESETS,
+	PROXY_ACCEPTED,
+	PROXY_STATS,
+};
+
+typedef struct {
+	pthread_mutex_t mtx; // only taken for --shared group caps
+	double          tokens;
+	uint64_t        at_us;
+	uint64_t        rate; // bytes/sec, 0 uncapped
+} proxy_bucket;
+
+typedef struct {
+	int          delay_us;
+	int          jitter_us;
+	double       drop; // chance a read resets the connection
+	uint64_t     rate[2];
+	proxy_bucket bucket[2]; // --shared
+} proxy_group;
+
+typedef struct {
+	int          src;
+	int          dst;
+	int          pipe[2];
+	size_t       pipe_size;
+	size_t       held; // bytes in the pipe
+	uint64_t     due[PROXY_CHUNKS];
+	uint32_t     len[PROXY_CHUNKS];
+	int          head;
+	int          count;
+	bool         readable; // until a read says EAGAIN
+	bool         writable;
+	bool         eof;
+	bool         shut; // eof passed on
+	uint64_t     wait_us; // read held back by the rate cap until then
+	proxy_bucket own;     // per connection caps
+	proxy_bucket *bucket;
+} proxy_dir;
+
+struct proxy_conn;
+
+// epoll data: which socket of which connection, conn NULL for the
+// listener.
+typedef struct {
+	struct proxy_conn *conn;
+	int                side;
+} proxy_end;
+
+typedef struct proxy_conn {
+	int                fd[2];
+	proxy_end          end[2];
+	proxy_dir          dir[2];
+	proxy_group *      group;
+	bool               connecting;
+	bool               dead;
+	struct proxy_conn *prev;
+	struct proxy_conn *next;
+} proxy_conn;
+
+typedef struct {
+	nng_thread *  thr;
+	int           epfd;
+	int           lfd;
+	proxy_end     listen;
+	proxy_conn *  conns; // live connections
+	proxy_conn *  dead;  // freed after the epoll batch
+	uint64_t      rand;
+	atomic_ullong stats[PROXY_STATS];
+} proxy_worker;
+
+static struct {
+	nnb_proxy_opt *  opt;
+	proxy_worker *   workers;
+	proxy_group      groups[PROXY_MAX_GROUPS];
+	struct addrinfo *broker;
+	bool             timed; // delay or caps set, connections need a clock
+	atomic_int       active;
+	atomic_int       next_group;
+	atomic_bool      stop;
+} proxy;
+
+// One value per group from "a,b,c"; groups past the list repeat its
+// last value. Returns -1 on anything but numbers >= 0.
+static int
+proxy_list(const char *list, double *v, int groups)
+{
+	const char *p = list;
+	char *      end;
+	int         n = 0;
+
+	while (n < groups) {
+		v[n] = strtod(p, &end);
+		if (end == p || v[n] < 0) {
+			return (-1);
+		}
+		n++;
+		if (*end == '\0') {
+			break;
+		}
+		if (*end != ',') {
+			return (-1);
+		}
+		p = end + 1;
+	}
+	for (; n < groups; n++) {
+		v[n] = v[n - 1];
+	}
+	return (0);
+}
+
+static int
+proxy_groups_setup(nnb_proxy_opt *opt)
+{
+	double delay[PROXY_MAX_GROUPS], jitter[PROXY_MAX_GROUPS];
+	double up[PROXY_MAX_GROUPS], down[PROXY_MAX_GROUPS];
+	double drop[PROXY_MAX_GROUPS];
+
+	if (opt->groups > PROXY_MAX_GROUPS) {
+		return (-1);
+	}
+	if (proxy_list(opt->delay, delay, opt->groups) != 0 ||
+	    proxy_list(opt->jitter, jitter, opt->groups) != 0 ||
+	    proxy_list(opt->up_rate, up, opt->groups) != 0 ||
+	    proxy_list(opt->down_rate, down, opt->groups) != 0 ||
+	    proxy_list(opt->drop, drop, opt->groups) != 0) {
+		return (-1);
+	}
+	for (int i = 0; i < opt->groups; i++) {
+		proxy_group *g = &proxy.groups[i];
+
+		g->delay_us         = (int) (delay[i] * 1000);
+		g->jitter_us        = (int) (jitter[i] * 1000);
+		g->drop             = drop[i] / 100;
+		g->rate[PROXY_UP]   = (uint64_t) up[i];
+		g->rate[PROXY_DOWN] = (uint64_t) down[i];
+		for (int d = 0; d < 2; d++) {
+			pthread_mutex_init(&g->bucket[d].mtx, NULL);
+			g->bucket[d].rate   = g->rate[d];
+			g->bucket[d].tokens = 0;
+			g->bucket[d].at_us  = nnb_clock_us();
+		}
+		if (g->delay_us > 0 || g->jitter_us > 0 ||
+		    g->rate[PROXY_UP] > 0 || g->rate[PROXY_DOWN] > 0) {
+			proxy.timed = true;
+		}
+	}
+	return (0);
+}
+
+// Bytes a read may take now under the cap, 0 with *wait_us set when
+// it has to wait. What the read leaves unused goes back by
+// proxy_refund.
+static size_t
+proxy_grant(proxy_bucket *b, size_t want, uint64_t now, uint64_t *wait_us)
+{
+	double cap;
+	size_t n = want;
+
+	if (b->rate == 0) {
+		return (want);
+	}
+	cap = (double) b->rate * PROXY_BURST_US / 1e6;
+	if (cap < PROXY_GRANT) {
+		cap = PROXY_GRANT;
+	}
+	if (proxy.opt->shared) {
+		pthread_mutex_lock(&b->mtx);
+	}
+	b->tokens += (double) (now - b->at_us) * b->rate / 1e6;
+	b->at_us = now;
+	if (b->tokens > cap) {
+		b->tokens = cap;
+	}
+	if (b->tokens < PROXY_GRANT) {
+		*wait_us = now +
+		    (uint64_t) ((PROXY_GRANT - b->tokens) * 1e6 / b->rate) + 1;
+		n = 0;
+	} else {
+		if ((double) n > b->tokens) {
+			n = (size_t) b->tokens;
+		}
+		b->tokens -= n;
+	}
+	if (proxy.opt->shared) {
+		pthread_mutex_unlock(&b->mtx);
+	}
+	return (n);
+}
+
+static void
+proxy_refund(proxy_bucket *b, size_t n)
+{
+	if (b->rate == 0 || n == 0) {
+		return;
+	}
+	if (proxy.opt->shared) {
+		pthread_mutex_lock(&b->mtx);
+	}
+	b->tokens += n;
+	if (proxy.opt->shared) {
+		pthread_mutex_unlock(&b->mtx);
+	}
+}
+
+static void
+proxy_kill(proxy_worker *w, proxy_conn *c)
+{
+	if (c->dead) {
+		return;
+	}
+	c->dead = true;
+	for (int i = 0; i < 2; i++) {
+		close(c->fd[i]);
+		close(c->dir[i].pipe[0]);
+		close(c->dir[i].pipe[1]);
+	}
+	if (c->prev != NULL) {
+		c->prev->next = c->next;
+	} else {
+		w->conns = c->next;
+	}
+	if (c->next != NULL) {
+		c->next->prev = c->prev;
+	}
+	c->next = w->dead;
+	w->dead = c;
+	--proxy.active;
+}
+
+// Both sides see a reset rather than a close, as after a lost link.
+static void
+proxy_reset(proxy_worker *w, proxy_conn *c)
+{
+	struct linger lg = { .l_onoff = 1, .l_linger = 0 };
+
+	for (int i = 0; i < 2; i++) {
+		setsockopt(c->fd[i], SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+	}
+	++w->stats[PROXY_RESETS];
+	proxy_kill(w, c);
+}
+
+// Queues n bytes just read, due after the delay. Bytes stay in order,
+// so jitter never makes a read due before the one ahead of it.
+static void
+proxy_hold(proxy_worker *w, proxy_conn *c, proxy_dir *d, size_t n,
+    uint64_t now)
+{
+	proxy_group *g   = c->group;
+	int64_t      due = (int64_t) now + g->delay_us;
+	int          last;
+
+	if (g->jitter_us > 0) {
+		due += (int64_t) ((nnb_rand_double(&w->rand) * 2 - 1) *
+		    g->jitter_us);
+	}
+	if (d->count > 0) {
+		last = (d->head + d->count - 1) % PROXY_CHUNKS;
+		if (due < (int64_t) d->due[last]) {
+			due = d->due[last];
+		}
+		if ((uint64_t) due - d->due[last] < PROXY_MERGE_US) {
+			d->len[last] += n;
+			d->held += n;
+			return;
+		}
+	} else if (due < (int64_t) now) {
+		due = now;
+	}
+	last         = (d->head + d->count) % PROXY_CHUNKS;
+	d->due[last] = due;
+	d->len[last] = n;
+	d->count++;
+	d->held += n;
+}
+
+// Moves what is due from the pipe to dst and what the caps allow from
+// src into the pipe, until neither can go on. Returns -1 when the
+// connection is gone.
+static int
+proxy_pump(proxy_worker *w, proxy_conn *c, int dir, uint64_t now)
+{
+	proxy_dir *d = &c->dir[dir];
+	ssize_t    n;
+	size_t     want;
+	bool       moved;
+
+	do {
+		moved = false;
+		while (d->count > 0 && d->writable && d->due[d->head] <= now) {
+			n = splice(d->pipe[0], NULL, d->dst, NULL,
+			    d->len[d->head],
+			    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (n < 0) {
+				if (errno == EAGAIN) {
+					d->writable = false;
+					break;
+				}
+				if (errno == EINTR) {
+					continue;
+				}
+				return (-1);
+			}
+			d->held -= n;
+			d->len[d->head] -= n;
+			w->stats[dir] += n;
+			if (d->len[d->head] == 0) {
+				d->head = (d->head + 1) % PROXY_CHUNKS;
+				d->count--;
+			}
+			// a read may have stopped on a full pipe
+			d->readable = true;
+			moved       = true;
+		}
+		if (d->eof) {
+			if (d->count == 0 && !d->shut) {
+				shutdown(d->dst, SHUT_WR);
+				d->shut = true;
+			}
+			break;
+		}
+		if (!d->readable || d->count == PROXY_CHUNKS ||
+		    d->held >= d->pipe_size || now < d->wait_us) {
+			continue;
+		}
+		want = d->pipe_size - d->held;
+		if (want > PROXY_READ) {
+			want = PROXY_READ;
+		}
+		if ((want = proxy_grant(d->bucket, want, now, &d->wait_us)) ==
+		    0) {
+			continue;
+		}
+		n = splice(d->src, NULL, d->pipe[1], NULL, want,
+		    SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+		proxy_refund(d->bucket, n > 0 ? want - n : want);
+		if (n == 0) {
+			d->eof = true;
+			moved  = true;
+		} else if (n < 0) {
+			if (errno == EAGAIN) {
+				d->readable = false;
+			} else if (errno != EINTR) {
+				return (-1);
+			}
+		} else {
+			if (c->group->drop > 0 &&
+			    nnb_rand_double(&w->rand) < c->group->drop) {
+				proxy_reset(w, c);
+				return (-1);
+			}
+			proxy_hold(w, c, d, n, now);
+			moved = true;
+		}
+	} while (moved);
+	return (0);
+}
+
+static void
+proxy_pump_conn(proxy_worker *w, proxy_conn *c, uint64_t now)
+{
+	if (c->dead || c->connecting) {
+		return;
+	}
+	if (proxy_pump(w, c, PROXY_UP, now) != 0 ||
+	    proxy_pump(w, c, PROXY_DOWN, now) != 0) {
+		proxy_kill(w, c);
+		return;
+	}
+	if (c->dir[PROXY_UP].shut && c->dir[PROXY_DOWN].shut) {
+		proxy_kill(w, c);
+	}
+}
+
+static int
+proxy_pipe(proxy_dir *d)
+{
+	int sz;
+
+	if (pipe2(d->pipe, O_NONBLOCK | O_CLOEXEC) != 0) {
+		return (-1);
+	}
+	// past /proc/sys/fs/pipe-max-size this fails and the default stays
+	fcntl(d->pipe[1], F_SETPIPE_SZ, PROXY_PIPE);
+	sz           = fcntl(d->pipe[1], F_GETPIPE_SZ);
+	d->pipe_size = sz > 0 ? (size_t) sz : 65536;
+	return (0);
+}
+
+static void
+proxy_dir_init(proxy_dir *d, proxy_group *g, int dir, int src, int dst)
+{
+	d->src      = src;
+	d->dst      = dst;
+	d->readable = true;
+	d->writable = true;
+	d->own.rate = g->rate[dir];
+	d->own.at_us = nnb_clock_us();
+	d->bucket    = proxy.opt->shared ? &g->bucket[dir] : &d->own;
+}
+
+// A bench connection: dial the broker for it, and relay once that
+// connects.
+static void
+proxy_accept(proxy_worker *w, int fd)
+{
+	struct addrinfo *  ai = proxy.broker;
+	proxy_conn *       c;
+	struct epoll_event ev;
+	int                one = 1;
+
+	if ((c = nng_alloc(sizeof(*c))) == NULL) {
+		close(fd);
+		return;
+	}
+	memset(c, 0, sizeof(*c));
+	c->fd[PROXY_CLIENT] = fd;
+	c->fd[PROXY_BROKER] =
+	    socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	c->dir[0].pipe[0] = c->dir[0].pipe[1] = -1;
+	c->dir[1].pipe[0] = c->dir[1].pipe[1] = -1;
+	if (c->fd[PROXY_BROKER] < 0 || proxy_pipe(&c->dir[0]) != 0 ||
+	    proxy_pipe(&c->dir[1]) != 0) {
+		log_err("proxy: %s", strerror(errno));
+		goto fail;
+	}
+	// delay is ours to add; Nagle would only add more
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	setsockopt(c->fd[PROXY_BROKER], IPPROTO_TCP, TCP_NODELAY, &one,
+	    sizeof(one));
+	if (proxy.opt->rcvbuf > 0) {
+		setsockopt(c->fd[PROXY_BROKER], SOL_SOCKET, SO_RCVBUF,
+		    &proxy.opt->rcvbuf, sizeof(proxy.opt->rcvbuf));
+	}
+	if (connect(c->fd[PROXY_BROKER], ai->ai_addr, ai->ai_addrlen) != 0 &&
+	    errno != EINPROGRESS) {
+		log_err("proxy connect: %s", strerror(errno));
+		goto fail;
+	}
+	c->connecting = true;
+	c->group      = &proxy.groups[proxy.next_group++ % proxy.opt->groups];
+	proxy_dir_init(&c->dir[PROXY_UP], c->group, PROXY_UP,
+	    c->fd[PROXY_CLIENT], c->fd[PROXY_BROKER]);
+	proxy_dir_init(&c->dir[PROXY_DOWN], c->group, PROXY_DOWN,
+	    c->fd[PROXY_BROKER], c->fd[PROXY_CLIENT]);
+	for (int i = 0; i < 2; i++) {
+		c->end[i].conn = c;
+		c->end[i].side = i;
+		ev.events      = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+		ev.data.ptr    = &c->end[i];
+		epoll_ctl(w->epfd, EPOLL_CTL_ADD, c->fd[i], &ev);
+	}
+	c->next = w->conns;
+	if (w->conns != NULL) {
+		w->conns->prev = c;
+	}
+	w->conns = c;
+	++proxy.active;
+	++w->stats[PROXY_ACCEPTED];
+	return;
+
+fail:
+	for (int i = 0; i < 2; i++) {
+		if (c->fd[i] > 0) {
+			close(c->fd[i]);
+		}
+		for (int k = 0; k < 2; k++) {
+			if (c->dir[i].pipe[k] >= 0) {
+				close(c->dir[i].pipe[k]);
+			}
+		}
+	}
+	nng_free(c, sizeof(*c));
+}
+
+static void
+proxy_event(proxy_worker *w, proxy_end *e, uint32_t events, uint64_t now)
+{
+	proxy_conn *c = e->conn;
+	int         err;
+	socklen_t   len = sizeof(err);
+	int         fd;
+
+	if (c == NULL) {
+		while ((fd = accept4(
+		            w->lfd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+			proxy_accept(w, fd);
+		}
+		return;
+	}
+	if (c->dead) {
+		return;
+	}
+	if (events & EPOLLERR) {
+		proxy_kill(w, c);
+		return;
+	}
+	if (e->side == PROXY_BROKER && c->connecting) {
+		if (!(events & EPOLLOUT)) {
+			return;
+		}
+		getsockopt(c->fd[PROXY_BROKER], SOL_SOCKET, SO_ERROR, &err,
+		    &len);
+		if (err != 0) {
+			log_warn("proxy: broker refused: %s", strerror(err));
+			proxy_kill(w, c);
+			return;
+		}
+		c->connecting = false;
+	}
+	if (events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+		c->dir[e->side == PROXY_CLIENT ? PROXY_UP : PROXY_DOWN]
+		    .readable = true;
+	}
+	if (events & EPOLLOUT) {
+		c->dir[e->side == PROXY_CLIENT ? PROXY_DOWN : PROXY_UP]
+		    .writable = true;
+	}
+	proxy_pump_conn(w, c, now);
+}
+
+// Pumps connections with something due and returns when the next one
+// will be, 0 if none.
+static uint64_t
+proxy_timers(proxy_worker *w, uint64_t now)
+{
+	uint64_t    next = 0;
+	proxy_conn *c;
+	proxy_conn *nc;
+
+	for (c = w->conns; c != NULL; c = nc) {
+		nc = c->next;
+		proxy_pump_conn(w, c, now);
+		if (c->dead || c->connecting) {
+			continue;
+		}
+		for (int i = 0; i < 2; i++) {
+			proxy_dir *d = &c->dir[i];
+			uint64_t   t = 0;
+
+			if (d->count > 0 && d->writable) {
+				t = d->due[d->head];
+			} else if (d->wait_us > now && d->readable &&
+			    !d->eof) {
+				t = d->wait_us;
+			}
+			if (t > 0 && (next == 0 || t < next)) {
+				next = t;
+			}
+		}
+	}
+	return (next);
+}
+
+static void
+proxy_loop(void *arg)
+{
+	proxy_worker *     w = arg;
+	struct epoll_event evs[PROXY_EVENTS];
+	int                timeout = PROXY_IDLE_MS;
+	uint64_t           now, next;
+	int                n;
+
+	while (!proxy.stop) {
+		n   = epoll_wait(w->epfd, evs, PROXY_EVENTS, timeout);
+		now = nnb_clock_us();
+		for (int i = 0; i < n; i++) {
+			proxy_event(w, evs[i].data.ptr, evs[i].events, now);
+		}
+		timeout = PROXY_IDLE_MS;
+		if (proxy.timed &&
+		    (next = proxy_timers(w, nnb_clock_us())) > 0) {
+			now  = nnb_clock_us();
+			next = next > now ? (next - now + 999) / 1000 : 0;
+			if (next < PROXY_IDLE_MS) {
+				timeout = (int) next;
+			}
+		}
+		while (w->dead != NULL) {
+			proxy_conn *c = w->dead;
+			w->dead       = c->next;
+			nng_free(c, sizeof(*c));
+		}
+	}
+	while (w->conns != NULL) {
+		proxy_kill(w, w->conns);
+	}
+	while (w->dead != NULL) {
+		proxy_conn *c = w->dead;
+		w->dead       = c->next;
+		nng_free(c, sizeof(*c));
+	}
+}
+
+// One listener per thread on the same port, the kernel spreads the
+// connections.
+static int
+proxy_listen(proxy_worker *w, struct addrinfo *ai)
+{
+	struct epoll_event ev;
+	int                one = 1;
+
+	w->lfd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (w->lfd < 0) {
+		log_err("socket: %s", strerror(errno));
+		return (-1);
+	}
+	setsockopt(w->lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+	setsockopt(w->lfd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+	if (bind(w->lfd, ai->ai_addr, ai->ai_addrlen) != 0 ||
+	    listen(w->lfd, SOMAXCONN) != 0) {
+		log_err("listen on %d: %s", proxy.opt->listen,
+		    strerror(errno));
+		return (-1);
+	}
+	ev.events   = EPOLLIN | EPOLLET;
+	ev.data.ptr = &w->listen;
+	return (epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->lfd, &ev));
+}
+
+static uint64_t
+proxy_sum(int stat)
+{
+	uint64_t sum = 0;
+
+	for (int i = 0; i < proxy.opt->threads; i++) {
+		sum += proxy.workers[i].stats[stat];
+	}
+	return (sum);
+}
+
+int
+nnb_proxy_run(nnb_proxy_opt *opt)
+{
+	struct addrinfo  hints = { .ai_socktype = SOCK_STREAM };
+	struct addrinfo *lai;
+	struct rlimit    rl;
+	char             port[16];
+	uint64_t         up, down, last_up = 0, last_down = 0, t0, us;
+	int              rv;
+
+	proxy.opt = opt;
+	if (proxy_groups_setup(opt) != 0) {
+		fprintf(stderr, "Error: bad per group value list\n");
+		return (NNG_EINVAL);
+	}
+	// six descriptors a connection: two sockets and two pipes
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+	// splice has no MSG_NOSIGNAL; a peer gone mid write is an EPIPE
+	signal(SIGPIPE, SIG_IGN);
+
+	snprintf(port, sizeof(port), "%d", opt->port);
+	if ((rv = getaddrinfo(opt->host, port, &hints, &proxy.broker)) != 0) {
+		log_err("%s: %s", opt->host, gai_strerror(rv));
+		return (NNG_EADDRINVAL);
+	}
+	hints.ai_flags = AI_PASSIVE;
+	snprintf(port, sizeof(port), "%d", opt->listen);
+	if ((rv = getaddrinfo(NULL, port, &hints, &lai)) != 0) {
+		log_err("listen on %d: %s", opt->listen, gai_strerror(rv));
+		return (NNG_EADDRINVAL);
+	}
+
+	proxy.workers = nng_alloc(sizeof(proxy_worker) * opt->threads);
+	if (proxy.workers == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(proxy.workers, 0, sizeof(proxy_worker) * opt->threads);
+	for (int i = 0; i < opt->threads; i++) {
+		proxy_worker *w = &proxy.workers[i];
+
+		w->rand = nnb_clock_us() * (i + 1) | 1;
+		if ((w->epfd = epoll_create1(0)) < 0) {
+			log_err("epoll_create1: %s", strerror(errno));
+			return (NNG_ENOMEM);
+		}
+		if (proxy_listen(w, lai) != 0) {
+			return (NNG_EADDRINUSE);
+		}
+	}
+	freeaddrinfo(lai);
+	for (int i = 0; i < opt->threads; i++) {
+		proxy_worker *w = &proxy.workers[i];
+		if ((rv = nng_thread_create(&w->thr, proxy_loop, w)) != 0) {
+			nng_fatal("nng_thread_create", rv);
+			return (rv);
+		}
+	}
+	printf("proxy: :%d -> %s:%d, %d group(s), delay=%s ms, "
+	       "jitter=%s ms, up=%s B/s, down=%s B/s, drop=%s%%\n",
+	    opt->listen, opt->host, opt->port, opt->groups, opt->delay,
+	    opt->jitter, opt->up_rate, opt->down_rate, opt->drop);
+
+	t0 = nnb_clock_us();
+	for (int s = 0; (opt->duration == 0 || s < opt->duration) &&
+	     !nnb_stopped();
+	     s++) {
+		nng_msleep(1000);
+		up   = proxy_sum(PROXY_UP_BYTES);
+		down = proxy_sum(PROXY_DOWN_BYTES);
+		printf("proxy: conns=%d, up=%.2f(MB/sec), down=%.2f(MB/sec), "
+		       "resets=%llu\n",
+		    (int) proxy.active, (up - last_up) / 1e6,
+		    (down - last_down) / 1e6,
+		    (unsigned long long) proxy_sum(PROXY_RESETS));
+		last_up   = up;
+		last_down = down;
+	}
+	us = nnb_clock_us() - t0;
+
+	proxy.stop = true;
+	for (int i = 0; i < opt->threads; i++) {
+		nng_thread_destroy(proxy.workers[i].thr);
+		close(proxy.workers[i].lfd);
+		close(proxy.workers[i].epfd);
+	}
+	freeaddrinfo(proxy.broker);
+
+	printf("\nproxy: %llu connections, %llu reset, in %.1fs\n",
+	    (unsigned long long) proxy_sum(PROXY_ACCEPTED),
+	    (unsigned long long) proxy_sum(PROXY_RESETS), us / 1e6);
+	printf("relayed: up=%.1f MB, down=%.1f MB\n",
+	    proxy_sum(PROXY_UP_BYTES) / 1e6,
+	    proxy_sum(PROXY_DOWN_BYTES) / 1e6);
+	nng_free(proxy.workers, sizeof(proxy_worker) * opt->threads);
+	return (0);
+}
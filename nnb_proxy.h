@@ -0,0 +1,16 @@
+#ifndef NNB_PROXY_H
+#define NNB_PROXY_H
+#include "nnb_opt.h"
+
+// A TCP relay for running the other modes over a bad link: point them
+// at --listen and every connection is relayed to the broker with delay
+// and jitter added each way, bandwidth capped per direction and reset
+// at random, per connection or for a group of connections at once.
+// TCP hides single packet loss from MQTT, so loss is played as the
+// connection reset a long outage ends in. Bytes are moved with splice
+// through a pipe per direction, which is also where delayed bytes wait,
+// so nothing is copied through user space; a pipe full of delayed bytes
+// stops reads from that side as a real link's window would.
+int nnb_proxy_run(nnb_proxy_opt *opt);
+
+#endif
@@ -0,0 +1,178 @@
+#include "nnb_pump.h"
+#include "nnb_bench.h"
+#include "nnb_util.h"
+
+#define NNB_PUMP_ID_LEN 64
+
+struct nnb_pump_work {
+	nng_aio * aio;
+	nng_ctx   ctx;
+	nnb_pump *pump;
+	int64_t   n; // message waiting for its due time, -1 if none
+};
+
+static void
+pump_send(nnb_pump_work *w, uint64_t n)
+{
+	nnb_pump *p = w->pump;
+
+	nng_aio_set_msg(w->aio, p->cfg.make(n, p->cfg.arg));
+	nng_ctx_send(w->ctx, w->aio);
+}
+
+// Milliseconds until message n is due, 0 when unpaced or late.
+static nng_duration
+pump_delay(nnb_pump *p, uint64_t n)
+{
+	int      rate = p->rate;
+	uint64_t due, now;
+
+	if (rate <= 0 || n < p->base_n) {
+		return (0);
+	}
+	due = p->base_us + (n - p->base_n) * 1000000 / rate;
+	now = nnb_clock_us();
+	return (due > now + 1000 ? (nng_duration) ((due - now) / 1000) : 0);
+}
+
+static void
+pump_next(nnb_pump_work *w)
+{
+	nnb_pump *   p = w->pump;
+	uint64_t     n;
+	nng_duration delay;
+
+	if (p->halted) {
+		return;
+	}
+	n = p->next++;
+	if (p->cfg.total > 0 && n >= (uint64_t) p->cfg.total) {
+		return;
+	}
+	if ((delay = pump_delay(p, n)) > 0) {
+		w->n = (int64_t) n;
+		nng_sleep_aio(delay, w->aio);
+		return;
+	}
+	pump_send(w, n);
+}
+
+static void
+pump_cb(void *arg)
+{
+	nnb_pump_work *w = arg;
+	nng_msg *      msg;
+	int            rv;
+
+	if (w->n >= 0) {
+		// woke up for a paced message
+		uint64_t n = w->n;
+		w->n       = -1;
+		if ((rv = nng_aio_result(w->aio)) == 0) {
+			pump_send(w, n);
+		}
+		return;
+	}
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if ((msg = nng_aio_get_msg(w->aio)) != NULL) {
+			nng_aio_set_msg(w->aio, NULL);
+			nng_msg_free(msg);
+		}
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("pump_cb", rv);
+		++w->pump->failed;
+	} else {
+		++w->pump->acked;
+	}
+	++w->pump->done;
+	pump_next(w);
+}
+
+int
+nnb_pump_start(nnb_pump *p, nnb_pump_cfg *cfg)
+{
+	int n = cfg->clients * cfg->window;
+	int rv;
+
+	p->cfg = *cfg;
+	atomic_init(&p->next, 0);
+	atomic_init(&p->acked, 0);
+	atomic_init(&p->failed, 0);
+	atomic_init(&p->done, 0);
+	atomic_init(&p->rate, cfg->rate);
+	atomic_init(&p->base_n, 0);
+	atomic_init(&p->base_us, nnb_clock_us());
+	atomic_init(&p->halted, false);
+	p->socks = nng_alloc(sizeof(nng_socket) * cfg->clients);
+	p->works = nng_alloc(sizeof(nnb_pump_work) * n);
+	if (p->socks == NULL || p->works == NULL) {
+		return (NNG_ENOMEM);
+	}
+
+	for (int i = 0; i < cfg->clients; i++) {
+		nnb_pump_work *ws = &p->works[i * cfg->window];
+		nng_msg *      msg;
+		char           id[NNB_PUMP_ID_LEN];
+
+		if ((rv = nnb_client_open(
+		         &p->socks[i], cfg->host, cfg->port, cfg->tls)) != 0) {
+			nng_fatal("nng_socket", rv);
+			return (rv);
+		}
+		for (int j = 0; j < cfg->window; j++) {
+			ws[j].pump = p;
+			ws[j].n    = -1;
+			rv = nng_aio_alloc(&ws[j].aio, pump_cb, &ws[j]);
+			if (rv == 0) {
+				rv = nng_ctx_open(&ws[j].ctx, p->socks[i]);
+			}
+			if (rv != 0) {
+				nng_fatal("pump work", rv);
+				return (rv);
+			}
+		}
+		msg = nnb_connect_msg(
+		    cfg->keepalive, true, cfg->username, cfg->password);
+		snprintf(id, sizeof(id), "%s%d", cfg->id_prefix, i);
+		nng_mqtt_msg_set_connect_client_id(msg, id);
+		nnb_dial(p->socks[i], cfg->host, cfg->port, cfg->tls, msg);
+		for (int j = 0; j < cfg->window; j++) {
+			pump_next(&ws[j]);
+		}
+	}
+	return (0);
+}
+
+void
+nnb_pump_rate(nnb_pump *p, int rate)
+{
+	p->rate    = 0; // unpaced while the base moves
+	p->base_us = nnb_clock_us();
+	p->base_n  = p->next;
+	p->rate    = rate;
+}
+
+void
+nnb_pump_halt(nnb_pump *p)
+{
+	p->halted = true;
+}
+
+void
+nnb_pump_stop(nnb_pump *p)
+{
+	int n = p->cfg.clients * p->cfg.window;
+
+	for (int i = 0; i < p->cfg.clients; i++) {
+		nng_close(p->socks[i]);
+	}
+	for (int i = 0; i < n; i++) {
+		nng_aio_free(p->works[i].aio);
+	}
+	nng_free(p->works, sizeof(nnb_pump_work) * n);
+	nng_free(p->socks, sizeof(nng_socket) * p->cfg.clients);
+	p->works = NULL;
+	p->socks = NULL;
+}
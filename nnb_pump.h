@@ -0,0 +1,54 @@
+#ifndef NNB_PUMP_H
+#define NNB_PUMP_H
+#include "nnb_opt.h"
+#include <stdatomic.h>
+
+// Publishes a fixed number of messages as fast as the broker acks them:
+// `clients` connections each keep `window` publishes in flight. Message
+// n is built by make(n, arg); for QoS 1/2 a send completes on the ack.
+// A total of 0 publishes until stopped. With a rate, message n is due
+// (n - base) / rate seconds after the last rate change; works sleep
+// until then, so bursts are at most the window and a millisecond long.
+
+typedef nng_msg *(*nnb_pump_make)(uint64_t n, void *arg);
+
+typedef struct {
+	const char *  host;
+	int           port;
+	tls_opt *     tls;
+	int           keepalive;
+	const char *  username;
+	const char *  password;
+	const char *  id_prefix; // client ids are <id_prefix><i>
+	int           clients;
+	int           window;
+	int           total; // 0 is unbounded
+	int           rate;  // msg/sec over all clients, 0 is unpaced
+	nnb_pump_make make;
+	void *        arg;
+} nnb_pump_cfg;
+
+typedef struct nnb_pump_work nnb_pump_work;
+
+typedef struct {
+	nnb_pump_cfg   cfg;
+	nng_socket *   socks;
+	nnb_pump_work *works;
+	atomic_ullong  next; // 64 bits: a soak at 1M msg/sec passes 2^31
+	atomic_ullong  acked;
+	atomic_ullong  failed;
+	atomic_ullong  done; // acked + failed
+	atomic_int     rate;
+	atomic_ullong  base_n;  // first message of the current rate
+	atomic_ullong  base_us; // nnb_clock_us() at the rate change
+	atomic_bool    halted;
+} nnb_pump;
+
+int  nnb_pump_start(nnb_pump *p, nnb_pump_cfg *cfg);
+void nnb_pump_rate(nnb_pump *p, int rate);
+// Stops handing out messages; those already numbered are still sent, so
+// once done reaches next every message below next has completed.
+void nnb_pump_halt(nnb_pump *p);
+void nnb_pump_stop(nnb_pump *p);
+
+#endif
@@ -0,0 +1,566 @@
+#include "nnb_rawsub.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_crc.h"
+#include "nnb_payload.h"
+#include "nnb_trace.h"
+#include "nnb_util.h"
+#include "nnb_wire.h"
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define RAWSUB_EVENTS 256
+#define RAWSUB_READ_LEN 65536 // per thread, reused by every read
+
+typedef enum {
+	RAWSUB_CONNECTING, // TCP handshake in progress
+	RAWSUB_WRITING,    // CONNECT and SUBSCRIBE partly written
+	RAWSUB_RECV,
+	RAWSUB_DEAD,
+} rawsub_state;
+
+// Where the parser is in the stream. Body bytes are either gathered
+// into field, want of them, or skipped.
+typedef enum {
+	PART_TYPE,
+	PART_LEN,
+	PART_GATHER,
+	PART_SKIP,
+} rawsub_part;
+
+// What the bytes being gathered or skipped are.
+typedef enum {
+	STEP_CONNACK,
+	STEP_SUBACK,
+	STEP_SUBACK_CODE,
+	STEP_TOPIC_LEN,
+	STEP_TOPIC,
+	STEP_PROPS_LEN, // one varint byte per gather
+	STEP_PROPS,
+	STEP_PAYLOAD,  // at most NNB_STAMP_LEN bytes
+	STEP_CRC_BODY, // skipped but run through the CRC, with --crc
+	STEP_CRC,
+	STEP_REST,
+} rawsub_step;
+
+typedef struct {
+	int          fd;
+	int          index;
+	rawsub_state state;
+	uint8_t *    out; // CONNECT followed by SUBSCRIBE
+	size_t       out_len;
+	size_t       out_off;
+	uint64_t     sub_us; // SUBSCRIBE written, usec
+
+	rawsub_part part;
+	rawsub_step step;
+	uint8_t     type;  // first byte of the current packet
+	uint32_t    rem;   // body bytes of the packet not consumed yet
+	uint32_t    n;     // varint shift, bytes to gather or to skip
+	uint32_t    got;   // bytes gathered into field
+	uint32_t    props; // v5 property length being decoded
+	uint32_t    shift;
+	uint32_t    crc;    // --crc, of the payload so far
+	int         pub_id; // from the stamp, -1 if none
+	uint8_t     field[NNB_STAMP_LEN];
+} rawsub_conn;
+
+typedef struct {
+	nng_thread *thr;
+	int         epfd;
+	int         index;
+	int         recv; // PUBLISH packets not yet added to cfg->recv
+	uint8_t *   buf;
+} rawsub_worker;
+
+static struct {
+	nnb_rawsub_cfg cfg;
+	int            threads;
+	rawsub_conn *  conns;
+	rawsub_worker *workers;
+} rawsub;
+
+static void
+rawsub_kill(rawsub_conn *c)
+{
+	if (c->state == RAWSUB_DEAD) {
+		return;
+	}
+	c->state = RAWSUB_DEAD;
+	++*rawsub.cfg.closed;
+	close(c->fd);
+	if (c->out != NULL) {
+		nng_free(c->out, c->out_len);
+		c->out = NULL;
+	}
+}
+
+static void
+rawsub_gather(rawsub_conn *c, rawsub_step step, uint32_t want)
+{
+	c->part = PART_GATHER;
+	c->step = step;
+	c->n    = want < c->rem ? want : c->rem;
+	c->got  = 0;
+}
+
+static int
+rawsub_skip(rawsub_conn *c, rawsub_step step, uint32_t n)
+{
+	if (n > c->rem) {
+		return (-1);
+	}
+	c->part = PART_SKIP;
+	c->step = step;
+	c->n    = n;
+	return (0);
+}
+
+// Picks what to look at in a packet once its remaining length is known.
+static int
+rawsub_packet(rawsub_conn *c)
+{
+	switch (c->type >> 4) {
+	case 2: // CONNACK: flags, then return code or reason code
+		rawsub_gather(c, STEP_CONNACK, 2);
+		return (0);
+	case 3:
+		rawsub_gather(c, STEP_TOPIC_LEN, 2);
+		return (0);
+	case 9: // SUBACK: the code of the only filter is the last byte
+		return (rawsub_skip(c, STEP_SUBACK, c->rem - (c->rem > 0)));
+	default:
+		return (rawsub_skip(c, STEP_REST, c->rem));
+	}
+}
+
+static void
+rawsub_stamp(rawsub_conn *c)
+{
+	nnb_stamp st;
+	uint64_t  now;
+
+	c->pub_id = -1;
+	if (!nnb_stamp_read(c->field, c->got, &st)) {
+		return;
+	}
+	c->pub_id = st.pub_id;
+	now       = nnb_realtime_us();
+	nnb_hist_add(rawsub.cfg.lat, now - st.ts_us);
+	if (nnb_trace_sampled(st.seq)) {
+		nnb_trace_deliver(st.pub_id, st.seq, st.ts_us, now);
+	}
+}
+
+// Starts on the payload, the rest of the packet. With --crc its last
+// NNB_CRC_LEN bytes are the CRC of the others, so the head gathered for
+// the stamp stops short of them.
+static void
+rawsub_payload(rawsub_conn *c)
+{
+	uint32_t head = NNB_STAMP_LEN;
+
+	if (rawsub.cfg.opt->crc && c->rem < NNB_CRC_LEN) {
+		// truncated below the CRC itself
+		nnb_crc_count(false, rawsub.cfg.opt->topic,
+		    strlen(rawsub.cfg.opt->topic), -1);
+		head = 0;
+	} else if (rawsub.cfg.opt->crc && c->rem - NNB_CRC_LEN < head) {
+		head = c->rem - NNB_CRC_LEN;
+	}
+	rawsub_gather(c, STEP_PAYLOAD, head);
+}
+
+// Called when the bytes of a step are all gathered or skipped.
+static int
+rawsub_step_done(rawsub_worker *w, rawsub_conn *c)
+{
+	uint32_t n;
+	uint32_t crc;
+
+	switch (c->step) {
+	case STEP_CONNACK:
+		if (c->got < 2 || c->field[1] != 0) {
+			log_warn("raw sub %d: connect refused, reason code %d",
+			    c->index, c->got < 2 ? -1 : c->field[1]);
+			return (-1);
+		}
+		++*rawsub.cfg.connected;
+		return (rawsub_skip(c, STEP_REST, c->rem));
+	case STEP_SUBACK:
+		rawsub_gather(c, STEP_SUBACK_CODE, 1);
+		return (0);
+	case STEP_SUBACK_CODE:
+		if (c->got < 1 || c->field[0] >= 0x80) {
+			log_warn("raw sub %d: subscribe refused", c->index);
+			return (-1);
+		}
+		nnb_hist_add(rawsub.cfg.suback, nnb_clock_us() - c->sub_us);
+		return (rawsub_skip(c, STEP_REST, c->rem));
+	case STEP_TOPIC_LEN:
+		if (c->got < 2) {
+			return (-1);
+		}
+		n = (uint32_t) c->field[0] << 8 | c->field[1];
+		if ((c->type & 0x06) != 0) {
+			n += 2; // packet id
+		}
+		return (rawsub_skip(c, STEP_TOPIC, n));
+	case STEP_TOPIC:
+		if (rawsub.cfg.opt->version == 5) {
+			c->props = 0;
+			c->shift = 0;
+			rawsub_gather(c, STEP_PROPS_LEN, 1);
+			return (0);
+		}
+		rawsub_payload(c);
+		return (0);
+	case STEP_PROPS_LEN:
+		if (c->got < 1 || c->shift > 21) {
+			return (-1);
+		}
+		c->props |= (uint32_t) (c->field[0] & 0x7f) << c->shift;
+		c->shift += 7;
+		if (c->field[0] & 0x80) {
+			rawsub_gather(c, STEP_PROPS_LEN, 1);
+			return (0);
+		}
+		return (rawsub_skip(c, STEP_PROPS, c->props));
+	case STEP_PROPS:
+		rawsub_payload(c);
+		return (0);
+	case STEP_PAYLOAD:
+		w->recv++;
+		rawsub_stamp(c);
+		if (!rawsub.cfg.opt->crc || c->rem + c->got < NNB_CRC_LEN) {
+			return (rawsub_skip(c, STEP_REST, c->rem));
+		}
+		c->crc = nnb_crc32c(0, c->field, c->got);
+		return (rawsub_skip(c, STEP_CRC_BODY, c->rem - NNB_CRC_LEN));
+	case STEP_CRC_BODY:
+		rawsub_gather(c, STEP_CRC, NNB_CRC_LEN);
+		return (0);
+	case STEP_CRC:
+		crc = (uint32_t) c->field[0] | (uint32_t) c->field[1] << 8 |
+		    (uint32_t) c->field[2] << 16 |
+		    (uint32_t) c->field[3] << 24;
+		// the subscription is the topic as far as --raw knows
+		nnb_crc_count(c->got == NNB_CRC_LEN && crc == c->crc,
+		    rawsub.cfg.opt->topic, strlen(rawsub.cfg.opt->topic),
+		    c->pub_id);
+		return (rawsub_skip(c, STEP_REST, c->rem));
+	case STEP_REST:
+		c->part = PART_TYPE;
+		return (0);
+	}
+	return (-1);
+}
+
+// Consumes len bytes of the stream. A packet may end anywhere, so the
+// parser state carries over to the next read.
+static int
+rawsub_feed(rawsub_worker *w, rawsub_conn *c, const uint8_t *p, size_t len)
+{
+	size_t k;
+
+	for (;;) {
+		switch (c->part) {
+		case PART_TYPE:
+			if (len == 0) {
+				return (0);
+			}
+			c->type = *p++;
+			c->rem  = 0;
+			c->n    = 0;
+			c->part = PART_LEN;
+			len--;
+			break;
+		case PART_LEN:
+			if (len == 0) {
+				return (0);
+			}
+			c->rem |= (uint32_t) (*p & 0x7f) << c->n;
+			c->n += 7;
+			len--;
+			if (*p++ & 0x80) {
+				if (c->n > 21) {
+					return (-1);
+				}
+				break;
+			}
+			if (rawsub_packet(c) != 0) {
+				return (-1);
+			}
+			break;
+		case PART_GATHER:
+			k = c->n - c->got < len ? c->n - c->got : len;
+			memcpy(c->field + c->got, p, k);
+			p += k;
+			len -= k;
+			c->got += k;
+			c->rem -= k;
+			if (c->got < c->n) {
+				return (0);
+			}
+			if (rawsub_step_done(w, c) != 0) {
+				return (-1);
+			}
+			break;
+		case PART_SKIP:
+			k = c->n < len ? c->n : len;
+			if (c->step == STEP_CRC_BODY) {
+				c->crc = nnb_crc32c(c->crc, p, k);
+			}
+			p += k;
+			len -= k;
+			c->n -= k;
+			c->rem -= k;
+			if (c->n > 0) {
+				return (0);
+			}
+			if (rawsub_step_done(w, c) != 0) {
+				return (-1);
+			}
+			break;
+		}
+	}
+}
+
+static void
+rawsub_events(rawsub_worker *w, rawsub_conn *c, uint32_t events)
+{
+	struct epoll_event ev = { .events = events, .data.ptr = c };
+
+	epoll_ctl(w->epfd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+// CONNECT and SUBSCRIBE go out back to back; a client may send before
+// the CONNACK arrives.
+static void
+rawsub_write(rawsub_worker *w, rawsub_conn *c)
+{
+	ssize_t n;
+
+	while (c->out_off < c->out_len) {
+		n = write(c->fd, c->out + c->out_off, c->out_len - c->out_off);
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				rawsub_kill(c);
+			}
+			return;
+		}
+		c->out_off += n;
+	}
+	nng_free(c->out, c->out_len);
+	c->out    = NULL;
+	c->sub_us = nnb_clock_us();
+	c->state  = RAWSUB_RECV;
+	rawsub_events(w, c, EPOLLIN);
+}
+
+static void
+rawsub_read(rawsub_worker *w, rawsub_conn *c)
+{
+	ssize_t n;
+
+	for (;;) {
+		if ((n = read(c->fd, w->buf, RAWSUB_READ_LEN)) == 0) {
+			rawsub_kill(c);
+			break;
+		}
+		if (n < 0) {
+			if (errno != EAGAIN && errno != EINTR) {
+				rawsub_kill(c);
+			}
+			break;
+		}
+		if (rawsub_feed(w, c, w->buf, n) != 0) {
+			log_warn("raw sub %d: malformed packet", c->index);
+			rawsub_kill(c);
+			break;
+		}
+	}
+	// one shared counter update per wakeup, not per message
+	if (w->recv > 0) {
+		*rawsub.cfg.recv += w->recv;
+		w->recv = 0;
+	}
+}
+
+// PINGREQ to every receiving connection of the worker; the PINGRESP is
+// skipped by the parser like any other packet.
+static void
+rawsub_ping(rawsub_worker *w)
+{
+	for (int i = w->index; i < rawsub.cfg.opt->count;
+	     i += rawsub.threads) {
+		rawsub_conn *c = &rawsub.conns[i];
+		if (c->state == RAWSUB_RECV &&
+		    write(c->fd, NNB_WIRE_PINGREQ, 2) < 0 && errno != EAGAIN) {
+			rawsub_kill(c);
+		}
+	}
+}
+
+static void
+rawsub_loop(void *arg)
+{
+	rawsub_worker *    w = arg;
+	struct epoll_event evs[RAWSUB_EVENTS];
+	uint64_t           ping_us = rawsub.cfg.opt->keepalive * 500000ULL;
+	uint64_t           last    = nnb_clock_us();
+	int                n;
+
+	while (!nnb_stopped()) {
+		n = epoll_wait(w->epfd, evs, RAWSUB_EVENTS, 100);
+		for (int i = 0; i < n; i++) {
+			rawsub_conn *c = evs[i].data.ptr;
+			uint32_t     e = evs[i].events;
+			int          err;
+			socklen_t    len = sizeof(err);
+
+			if (c->state == RAWSUB_CONNECTING && (e & EPOLLOUT)) {
+				getsockopt(
+				    c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+				if (err != 0) {
+					rawsub_kill(c);
+					continue;
+				}
+				c->state = RAWSUB_WRITING;
+				rawsub_events(w, c, EPOLLIN | EPOLLOUT);
+			}
+			if (c->state == RAWSUB_WRITING && (e & EPOLLOUT)) {
+				rawsub_write(w, c);
+			}
+			if (c->state != RAWSUB_DEAD &&
+			    (e & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+				rawsub_read(w, c);
+			}
+		}
+		if (ping_us > 0 && nnb_clock_us() - last >= ping_us) {
+			last = nnb_clock_us();
+			rawsub_ping(w);
+		}
+	}
+}
+
+static int
+rawsub_dial(rawsub_conn *c, struct addrinfo *ai, rawsub_worker *w)
+{
+	struct epoll_event ev  = { .events = EPOLLOUT, .data.ptr = c };
+	int                one = 1;
+
+	c->fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK, 0);
+	if (c->fd < 0) {
+		log_err("socket: %s", strerror(errno));
+		return (-1);
+	}
+	setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if (connect(c->fd, ai->ai_addr, ai->ai_addrlen) != 0 &&
+	    errno != EINPROGRESS) {
+		log_err("connect: %s", strerror(errno));
+		close(c->fd);
+		return (-1);
+	}
+	c->state = RAWSUB_CONNECTING;
+	return (epoll_ctl(w->epfd, EPOLL_CTL_ADD, c->fd, &ev));
+}
+
+// CONNECT then SUBSCRIBE of client n, in one buffer.
+static int
+rawsub_out(rawsub_conn *c, int n)
+{
+	nnb_sub_opt *opt      = rawsub.cfg.opt;
+	const char * id       = nnb_ids_get(rawsub.cfg.ids, n);
+	const char * username = opt->username;
+	const char * password = opt->password;
+	uint8_t *    conn;
+	uint8_t *    sub;
+	size_t       conn_len;
+	size_t       sub_len;
+	char         row[NNB_CRED_ROW];
+
+	if (rawsub.cfg.cred->count > 0) {
+		nnb_cred_row(
+		    rawsub.cfg.cred, n, row, &id, &username, &password);
+	}
+	conn = nnb_wire_connect(opt->version, opt->keepalive, opt->clean,
+	    id != NULL ? id : "", username, password, &conn_len);
+	sub  = nnb_wire_subscribe(opt->version, opt->topic, 0, &sub_len);
+	c->out_len = conn_len + sub_len;
+	if (conn == NULL || sub == NULL ||
+	    (c->out = nng_alloc(c->out_len)) == NULL) {
+		return (NNG_ENOMEM);
+	}
+	memcpy(c->out, conn, conn_len);
+	memcpy(c->out + conn_len, sub, sub_len);
+	nng_free(conn, conn_len);
+	nng_free(sub, sub_len);
+	return (0);
+}
+
+int
+nnb_rawsub_start(nnb_rawsub_cfg *cfg)
+{
+	nnb_sub_opt *    opt   = cfg->opt;
+	struct addrinfo  hints = { .ai_socktype = SOCK_STREAM };
+	struct addrinfo *ai;
+	char             port[16];
+	int              rv;
+
+	rawsub.cfg     = *cfg;
+	rawsub.threads = opt->threads;
+	rawsub.conns   = nng_alloc(sizeof(rawsub_conn) * opt->count);
+	rawsub.workers = nng_alloc(sizeof(rawsub_worker) * opt->threads);
+	if (rawsub.conns == NULL || rawsub.workers == NULL) {
+		return (NNG_ENOMEM);
+	}
+	memset(rawsub.conns, 0, sizeof(rawsub_conn) * opt->count);
+	memset(rawsub.workers, 0, sizeof(rawsub_worker) * opt->threads);
+
+	snprintf(port, sizeof(port), "%d", opt->port);
+	if ((rv = getaddrinfo(opt->host, port, &hints, &ai)) != 0) {
+		log_err("%s: %s", opt->host, gai_strerror(rv));
+		return (NNG_EADDRINVAL);
+	}
+	for (int i = 0; i < opt->threads; i++) {
+		rawsub_worker *w = &rawsub.workers[i];
+		w->index         = i;
+		if ((w->buf = nng_alloc(RAWSUB_READ_LEN)) == NULL) {
+			freeaddrinfo(ai);
+			return (NNG_ENOMEM);
+		}
+		if ((w->epfd = epoll_create1(0)) < 0) {
+			log_err("epoll_create1: %s", strerror(errno));
+			freeaddrinfo(ai);
+			return (NNG_ENOMEM);
+		}
+		if ((rv = nng_thread_create(&w->thr, rawsub_loop, w)) != 0) {
+			freeaddrinfo(ai);
+			return (rv);
+		}
+	}
+
+	for (int i = 0; i < opt->count && !nnb_stopped(); i++) {
+		rawsub_conn *c = &rawsub.conns[i];
+
+		c->index = opt->startnumber + i;
+		if ((rv = rawsub_out(c, c->index)) != 0) {
+			freeaddrinfo(ai);
+			return (rv);
+		}
+		if (rawsub_dial(c, ai, &rawsub.workers[i % opt->threads]) !=
+		    0) {
+			c->state = RAWSUB_DEAD;
+			++*cfg->closed;
+		}
+		nng_msleep(opt->interval);
+	}
+	freeaddrinfo(ai);
+	return (0);
+}
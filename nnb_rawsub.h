@@ -0,0 +1,31 @@
+#ifndef NNB_RAWSUB_H
+#define NNB_RAWSUB_H
+#include "nnb_cred.h"
+#include "nnb_hist.h"
+#include "nnb_id.h"
+#include "nnb_opt.h"
+#include <stdatomic.h>
+
+// sub --raw: QoS 0 subscribers on plain TCP sockets served by --threads
+// epoll loops instead of nng. The stream is parsed as it is read and
+// only the fixed header, the topic length and the first NNB_STAMP_LEN
+// payload bytes are ever looked at; nothing is allocated per message.
+// Each thread reads into one buffer it reuses, and a connection keeps
+// just the parser state and the few bytes of a field split between
+// two reads, so memory stays flat however many messages arrive.
+typedef struct {
+	nnb_sub_opt *opt;
+	nnb_ids *    ids;       // client ids
+	nnb_cred *   cred;      // rows override ids and logins when loaded
+	atomic_int * connected; // bumped on CONNACK
+	atomic_int * closed;    // bumped when a connection is lost
+	atomic_int * recv;      // PUBLISH packets received
+	nnb_hist *   suback;    // SUBSCRIBE to SUBACK, usec
+	nnb_hist *   lat;       // stamped publish to delivery, usec
+} nnb_rawsub_cfg;
+
+// Dials every client, pacing them by -i, and returns; the threads keep
+// receiving until the process exits.
+int nnb_rawsub_start(nnb_rawsub_cfg *cfg);
+
+#endif
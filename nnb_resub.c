@@ -0,0 +1,366 @@
+#include "nnb_resub.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_payload.h"
+#include "nnb_pump.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <stdatomic.h>
+
+#define RESUB_WINDOW 32 // in-flight publishes per publisher
+#define RESUB_SLICES 10 // changes are spread over the second in slices
+#define RESUB_ID_LEN 64
+
+typedef enum { RESUB_INIT, RESUB_UNSUB, RESUB_SUB } resub_state;
+
+// The op aio runs one filter change at a time: UNSUBSCRIBE of the
+// current filter, then SUBSCRIBE of the next. busy is claimed by the
+// scheduler and released when the SUBACK arrives.
+typedef struct {
+	int         index;
+	nng_socket  sock;
+	nng_aio *   op_aio;
+	nng_ctx     op_ctx;
+	nng_aio *   recv_aio;
+	nng_ctx     recv_ctx;
+	atomic_bool busy;
+	resub_state state;
+	int         filter; // current position in the ring
+	uint64_t    op_us;  // nnb_clock_us() at the last request
+} resub_client;
+
+static struct {
+	nnb_resub_opt *opt;
+	resub_client * clients;
+	nnb_pump       pump;
+	uint8_t *      payload;
+	uint64_t       seed;
+	atomic_bool    churning;
+	atomic_int     subacked;
+	atomic_int     changes; // completed UNSUBSCRIBE + SUBSCRIBE pairs
+	atomic_int     skipped; // due while the client was still busy
+	atomic_int     refused; // SUBACK with a failure code
+	atomic_llong   recv;
+	nnb_hist       suback_hist;   // SUBSCRIBE to SUBACK, usec
+	nnb_hist       unsuback_hist; // UNSUBSCRIBE to UNSUBACK, usec
+	nnb_hist       base_hist;     // stamp to delivery before churn, usec
+	nnb_hist       churn_hist;    // same, while churning
+} resub;
+
+// Ring filter k of a client; the trailing '#' makes every change
+// touch the wildcard part of the subscription table.
+static void
+resub_filter(char *buf, size_t len, resub_client *c, int k)
+{
+	snprintf(buf, len, "%s/rot/%d/%d/#", resub.opt->topic, c->index, k);
+}
+
+static void
+resub_send(resub_client *c, nng_mqtt_packet_type type, int k)
+{
+	nng_msg *msg;
+	char     filter[NNB_TOPIC_LEN];
+
+	resub_filter(filter, sizeof(filter), c, k);
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, type);
+	if (type == NNG_MQTT_SUBSCRIBE) {
+		nng_mqtt_topic_qos topic_qos[] = {
+			{ .qos     = resub.opt->qos,
+			    .topic = { .buf = (uint8_t *) filter,
+			        .length     = strlen(filter) } },
+		};
+		nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	} else {
+		nng_mqtt_topic topic = { .buf = (uint8_t *) filter,
+			.length              = strlen(filter) };
+		nng_mqtt_msg_set_unsubscribe_topics(msg, &topic, 1);
+	}
+	c->op_us = nnb_clock_us();
+	nng_aio_set_msg(c->op_aio, msg);
+	nng_ctx_send(c->op_ctx, c->op_aio);
+}
+
+static void
+resub_op_cb(void *arg)
+{
+	resub_client *c = arg;
+	nng_msg *     msg;
+	uint64_t      now = nnb_clock_us();
+	uint8_t *     codes;
+	uint32_t      n;
+	int           rv;
+
+	msg = nng_aio_get_msg(c->op_aio);
+	nng_aio_set_msg(c->op_aio, NULL);
+	if ((rv = nng_aio_result(c->op_aio)) != 0) {
+		if (msg != NULL) {
+			nng_msg_free(msg);
+		}
+		if (rv != NNG_ECLOSED && rv != NNG_ECANCELED) {
+			nng_fatal("resub_op_cb", rv);
+			c->busy = false;
+		}
+		return;
+	}
+	if (msg != NULL && c->state != RESUB_UNSUB) {
+		codes = nng_mqtt_msg_get_suback_return_codes(msg, &n);
+		for (uint32_t i = 0; i < n; i++) {
+			if (codes[i] >= 0x80) {
+				++resub.refused;
+			}
+		}
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+
+	switch (c->state) {
+	case RESUB_INIT:
+		++resub.subacked;
+		c->busy = false;
+		break;
+	case RESUB_UNSUB:
+		nnb_hist_add(&resub.unsuback_hist, now - c->op_us);
+		c->filter = (c->filter + 1) % resub.opt->filters;
+		c->state  = RESUB_SUB;
+		resub_send(c, NNG_MQTT_SUBSCRIBE, c->filter);
+		break;
+	case RESUB_SUB:
+		nnb_hist_add(&resub.suback_hist, now - c->op_us);
+		++resub.changes;
+		c->busy = false;
+		break;
+	}
+}
+
+static void
+resub_recv_cb(void *arg)
+{
+	resub_client *c = arg;
+	nng_msg *     msg;
+	nnb_stamp     st;
+	uint8_t *     payload;
+	uint32_t      len;
+	int           rv;
+
+	if ((rv = nng_aio_result(c->recv_aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("resub_recv_cb", rv);
+		nng_ctx_recv(c->recv_ctx, c->recv_aio);
+		return;
+	}
+	if ((msg = nng_aio_get_msg(c->recv_aio)) == NULL) {
+		nng_ctx_recv(c->recv_ctx, c->recv_aio);
+		return;
+	}
+	nng_aio_set_msg(c->recv_aio, NULL);
+	payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+	if (nnb_stamp_read(payload, len, &st)) {
+		++resub.recv;
+		nnb_hist_add(resub.churning ? &resub.churn_hist
+		                            : &resub.base_hist,
+		    nnb_realtime_us() - st.ts_us);
+	}
+	nng_msg_free(msg);
+	nng_ctx_recv(c->recv_ctx, c->recv_aio);
+}
+
+// Connects a client and subscribes to its steady topic and to ring
+// filter 0 in one SUBSCRIBE.
+static int
+resub_connect(resub_client *c)
+{
+	nnb_resub_opt *opt = resub.opt;
+	nng_msg *      msg;
+	char           steady[NNB_TOPIC_LEN];
+	char           filter[NNB_TOPIC_LEN];
+	char           id[RESUB_ID_LEN];
+	int            rv;
+
+	if ((rv = nnb_client_open(
+	         &c->sock, opt->host, opt->port, &opt->tls)) != 0 ||
+	    (rv = nng_aio_alloc(&c->op_aio, resub_op_cb, c)) != 0 ||
+	    (rv = nng_aio_alloc(&c->recv_aio, resub_recv_cb, c)) != 0 ||
+	    (rv = nng_ctx_open(&c->op_ctx, c->sock)) != 0 ||
+	    (rv = nng_ctx_open(&c->recv_ctx, c->sock)) != 0) {
+		nng_fatal("resub_connect", rv);
+		return (rv);
+	}
+	msg = nnb_connect_msg(
+	    opt->keepalive, true, opt->username, opt->password);
+	snprintf(id, sizeof(id), "nnb_resub_%d", c->index);
+	nng_mqtt_msg_set_connect_client_id(msg, id);
+	nnb_dial(c->sock, opt->host, opt->port, &opt->tls, msg);
+
+	snprintf(steady, sizeof(steady), "%s/steady/%d", opt->topic, c->index);
+	resub_filter(filter, sizeof(filter), c, 0);
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) steady,
+		        .length     = strlen(steady) } },
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) filter,
+		        .length     = strlen(filter) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 2);
+	c->busy  = true;
+	c->state = RESUB_INIT;
+	nng_aio_set_msg(c->op_aio, msg);
+	nng_ctx_send(c->op_ctx, c->op_aio);
+	nng_ctx_recv(c->recv_ctx, c->recv_aio);
+	return (0);
+}
+
+// Starts a filter change on a random client unless it is mid-change.
+static void
+resub_one(void)
+{
+	resub_client *c;
+
+	c = &resub.clients[nnb_rand(&resub.seed) % resub.opt->count];
+	if (atomic_exchange(&c->busy, true)) {
+		++resub.skipped;
+		return;
+	}
+	c->state = RESUB_UNSUB;
+	resub_send(c, NNG_MQTT_UNSUBSCRIBE, c->filter);
+}
+
+static nng_msg *
+resub_make(uint64_t n, void *arg)
+{
+	nnb_resub_opt *opt = arg;
+	nng_msg *      msg;
+	nnb_stamp      st = { .pub_id = 0, .seq = n };
+	char           topic[NNB_TOPIC_LEN];
+
+	snprintf(topic, sizeof(topic), "%s/steady/%d", opt->topic,
+	    opt->startnumber + (int) (n % opt->count));
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_payload(msg, resub.payload, opt->size);
+	nng_mqtt_msg_encode(msg);
+	st.ts_us = nnb_realtime_us();
+	nnb_stamp_write(
+	    (uint8_t *) nng_msg_body(msg) + nng_msg_len(msg) - opt->size,
+	    &st);
+	return (msg);
+}
+
+static void
+resub_report(double secs)
+{
+	nnb_resub_opt *opt = resub.opt;
+
+	printf("\nresub: %d filter changes in %.1fs, %.1f/sec (target "
+	       "%d/sec), %d skipped while busy, %d refused\n",
+	    (int) resub.changes, secs, secs > 0 ? resub.changes / secs : 0,
+	    opt->sub_rate, (int) resub.skipped, (int) resub.refused);
+	nnb_hist_summary(&resub.unsuback_hist, "unsuback", "usec");
+	nnb_hist_summary(&resub.suback_hist, "suback", "usec");
+	printf("traffic: %lld published, %lld received\n",
+	    (long long) resub.pump.acked, (long long) resub.recv);
+	nnb_hist_summary(&resub.base_hist, "latency before churn", "usec");
+	nnb_hist_summary(&resub.churn_hist, "latency during churn", "usec");
+}
+
+int
+nnb_resub_run(nnb_resub_opt *opt)
+{
+	nnb_pump_cfg cfg;
+	uint64_t     t0, end;
+	double       carry = 0;
+	int          last  = 0;
+	int          rv;
+
+	resub.opt     = opt;
+	resub.seed    = nnb_clock_us() | 1;
+	resub.clients = nng_alloc(sizeof(resub_client) * opt->count);
+	resub.payload = nng_alloc(opt->size);
+	if (resub.clients == NULL || resub.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(resub.clients, 0, sizeof(resub_client) * opt->count);
+	memset(resub.payload, 'A', opt->size);
+	nnb_hist_init(&resub.suback_hist);
+	nnb_hist_init(&resub.unsuback_hist);
+	nnb_hist_init(&resub.base_hist);
+	nnb_hist_init(&resub.churn_hist);
+
+	for (int i = 0; i < opt->count; i++) {
+		resub.clients[i].index = opt->startnumber + i;
+		if ((rv = resub_connect(&resub.clients[i])) != 0) {
+			return (rv);
+		}
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&resub.subacked, opt->count, "subscribed",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+
+	cfg = (nnb_pump_cfg) {
+		.host      = opt->host,
+		.port      = opt->port,
+		.tls       = &opt->tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_resub_pub_",
+		.clients   = opt->publishers,
+		.window    = RESUB_WINDOW,
+		.total     = 0,
+		.rate      = opt->rate,
+		.make      = resub_make,
+		.arg       = opt,
+	};
+	if ((rv = nnb_pump_start(&resub.pump, &cfg)) != 0) {
+		return (rv);
+	}
+
+	// baseline delivery latency without subscription changes
+	printf("resub: %ds baseline\n", opt->warmup);
+	for (int i = 0; i < opt->warmup && !nnb_stopped(); i++) {
+		nng_msleep(1000);
+	}
+	resub.churning = true;
+
+	t0 = nnb_clock_us();
+	for (int tick = 1; !nnb_stopped() &&
+	     (opt->duration == 0 || tick <= opt->duration * RESUB_SLICES);
+	     tick++) {
+		carry += (double) opt->sub_rate / RESUB_SLICES;
+		for (; carry >= 1; carry -= 1) {
+			resub_one();
+		}
+		nng_msleep(1000 / RESUB_SLICES);
+		if (tick % RESUB_SLICES == 0) {
+			int n = resub.changes;
+			printf("resub: changes=%d/sec, skipped=%d, "
+			       "recv=%lld\n",
+			    n - last, (int) resub.skipped,
+			    (long long) resub.recv);
+			last = n;
+		}
+	}
+
+	end = nnb_clock_us();
+	nnb_pump_stop(&resub.pump);
+	nng_msleep(1000); // let in-flight messages land
+	resub_report((end - t0) / 1e6);
+	for (int i = 0; i < opt->count; i++) {
+		nng_close(resub.clients[i].sock);
+		nng_aio_free(resub.clients[i].op_aio);
+		nng_aio_free(resub.clients[i].recv_aio);
+	}
+	return (0);
+}
@@ -0,0 +1,13 @@
+#ifndef NNB_RESUB_H
+#define NNB_RESUB_H
+#include "nnb_opt.h"
+
+// Subscription churn: -c clients each hold a steady subscription on
+// <topic>/steady/<n> fed by paced stamped publishes, and at --sub-rate
+// per second one of them moves its second filter along a ring of
+// --filters wildcard filters (UNSUBSCRIBE the old, SUBSCRIBE the next).
+// Reports SUBACK and UNSUBACK latency and the steady delivery latency
+// before and during the churn.
+int nnb_resub_run(nnb_resub_opt *opt);
+
+#endif
@@ -0,0 +1,281 @@
+#include "nnb_retain.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_pump.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+
+#define RETAIN_PARALLEL 2
+#define RETAIN_WINDOW 32 // in-flight publishes per publisher
+#define RETAIN_ID_LEN 64
+
+typedef struct retain_client retain_client;
+
+typedef struct {
+	nng_aio *      aio;
+	nng_ctx        ctx;
+	retain_client *client;
+	bool           subscribe; // completion is for the SUBSCRIBE
+} retain_work;
+
+struct retain_client {
+	int         index;
+	nng_socket  sock;
+	retain_work works[RETAIN_PARALLEL];
+	atomic_int  recv;     // retained messages received
+	uint64_t    start_us; // SUBSCRIBE submitted
+	uint64_t    first_us; // first retained message
+};
+
+static struct {
+	nnb_retain_opt *opt;
+	retain_client * clients;
+	uint8_t *       payload;
+	atomic_int      subacked;
+	atomic_int      complete; // clients holding the full set
+	atomic_ullong   recv;
+	nnb_hist        first_hist;    // subscribe to first retained, usec
+	nnb_hist        complete_hist; // subscribe to full set, usec
+} retain;
+
+static void
+retain_cb(void *arg)
+{
+	retain_work *  w = arg;
+	retain_client *c = w->client;
+	nng_msg *      msg;
+	uint64_t       now;
+	int            rv;
+
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("retain_cb", rv);
+		nng_ctx_recv(w->ctx, w->aio);
+		return;
+	}
+	msg = nng_aio_get_msg(w->aio);
+	nng_aio_set_msg(w->aio, NULL);
+	if (w->subscribe) {
+		w->subscribe = false;
+		++retain.subacked;
+	} else if (msg != NULL && nng_mqtt_msg_get_publish_retain(msg)) {
+		int n = ++c->recv;
+		now   = nnb_clock_us();
+		++retain.recv;
+		if (n == 1) {
+			c->first_us = now;
+			nnb_hist_add(&retain.first_hist, now - c->start_us);
+		}
+		if (n == retain.opt->topics) {
+			nnb_hist_add(&retain.complete_hist, now - c->start_us);
+			++retain.complete;
+		}
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+	nng_ctx_recv(w->ctx, w->aio);
+}
+
+static void
+retain_connect(retain_client *c)
+{
+	nnb_retain_opt *opt = retain.opt;
+	nng_msg *       msg;
+	char            buf[NNB_TOPIC_LEN];
+	int             rv;
+
+	if ((rv = nnb_client_open(
+	         &c->sock, opt->host, opt->port, &opt->tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+		return;
+	}
+	for (int i = 0; i < RETAIN_PARALLEL; i++) {
+		retain_work *w = &c->works[i];
+		w->client      = c;
+		w->subscribe   = false;
+		if ((rv = nng_aio_alloc(&w->aio, retain_cb, w)) != 0) {
+			nng_fatal("nng_aio_alloc", rv);
+		}
+		if ((rv = nng_ctx_open(&w->ctx, c->sock)) != 0) {
+			nng_fatal("nng_ctx_open", rv);
+		}
+	}
+
+	msg = nnb_connect_msg(
+	    opt->keepalive, true, opt->username, opt->password);
+	snprintf(buf, sizeof(buf), "nnb_retain_%d", c->index);
+	nng_mqtt_msg_set_connect_client_id(msg, buf);
+	nnb_dial(c->sock, opt->host, opt->port, &opt->tls, msg);
+
+	snprintf(buf, sizeof(buf), "%s/#", opt->topic);
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) buf,
+		        .length     = strlen(buf) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	c->works[0].subscribe = true;
+	c->start_us           = nnb_clock_us();
+	nng_aio_set_msg(c->works[0].aio, msg);
+	nng_ctx_send(c->works[0].ctx, c->works[0].aio);
+	for (int i = 1; i < RETAIN_PARALLEL; i++) {
+		nng_ctx_recv(c->works[i].ctx, c->works[i].aio);
+	}
+}
+
+static void
+retain_close(retain_client *c)
+{
+	nng_close(c->sock);
+	for (int i = 0; i < RETAIN_PARALLEL; i++) {
+		nng_aio_free(c->works[i].aio);
+		c->works[i].aio = NULL;
+	}
+}
+
+static nng_msg *
+retain_make(uint64_t n, bool clear)
+{
+	nnb_retain_opt *opt = retain.opt;
+	nng_msg *       msg;
+	char            topic[NNB_TOPIC_LEN];
+
+	snprintf(topic, sizeof(topic), "%s/%d", opt->topic,
+	    opt->startnumber + (int) n);
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_retain(msg, true);
+	// a zero-length retained payload deletes the retained message
+	nng_mqtt_msg_set_publish_payload(
+	    msg, retain.payload, clear ? 0 : opt->size);
+	nng_mqtt_msg_encode(msg);
+	return (msg);
+}
+
+static nng_msg *
+retain_make_set(uint64_t n, void *arg)
+{
+	return (retain_make(n, false));
+}
+
+static nng_msg *
+retain_make_clear(uint64_t n, void *arg)
+{
+	return (retain_make(n, true));
+}
+
+// Publishes one retained message (or clear) per topic; returns the
+// elapsed time in usec and the pump for its counters.
+static uint64_t
+retain_publish(nnb_pump *pump, nnb_pump_make make, const char *what)
+{
+	nnb_retain_opt *opt = retain.opt;
+	uint64_t        t0  = nnb_clock_us();
+	nnb_pump_cfg    cfg = {
+		.host      = opt->host,
+		.port      = opt->port,
+		.tls       = &opt->tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_retain_pub_",
+		.clients   = opt->publishers,
+		.window    = RETAIN_WINDOW,
+		.total     = opt->topics,
+		.make      = make,
+	};
+
+	if (nnb_pump_start(pump, &cfg) != 0) {
+		return (0);
+	}
+	nnb_wait64(&pump->done, opt->topics, what, opt->timeout);
+	t0 = nnb_clock_us() - t0;
+	nnb_pump_stop(pump);
+	return (t0);
+}
+
+static void
+retain_rate(const char *what, nnb_pump *pump, uint64_t us)
+{
+	printf("%s: %d acked, %d failed in %.3fs, rate=%.0f(msg/sec)\n", what,
+	    (int) pump->acked, (int) pump->failed, us / 1e6,
+	    us ? pump->acked * 1e6 / us : 0.0);
+}
+
+int
+nnb_retain_run(nnb_retain_opt *opt)
+{
+	nnb_pump      populate;
+	nnb_pump      clear;
+	uint64_t      populate_us, clear_us, t0, deliver_us;
+	retain_client probe;
+	int           rv = 0;
+
+	retain.opt     = opt;
+	retain.clients = nng_alloc(sizeof(retain_client) * (opt->count + 1));
+	retain.payload = nng_alloc(opt->size + 1);
+	if (retain.clients == NULL || retain.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(retain.clients, 0, sizeof(retain_client) * (opt->count + 1));
+	memset(retain.payload, 'A', opt->size + 1);
+	nnb_hist_init(&retain.first_hist);
+	nnb_hist_init(&retain.complete_hist);
+
+	// 1. populate the retained store
+	populate_us = retain_publish(&populate, retain_make_set, "populated");
+
+	// 2. subscribers pull the whole retained set
+	t0 = nnb_clock_us();
+	for (int i = 0; i < opt->count; i++) {
+		retain.clients[i].index = opt->startnumber + i;
+		retain_connect(&retain.clients[i]);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&retain.complete, opt->count, "full retained set",
+	        opt->timeout)) {
+		rv = NNG_ETIMEDOUT;
+	}
+	deliver_us = nnb_clock_us() - t0;
+	for (int i = 0; i < opt->count; i++) {
+		retain_close(&retain.clients[i]);
+	}
+
+	// 3. clear the retained topics
+	clear_us = retain_publish(&clear, retain_make_clear, "cleared");
+
+	// a fresh subscriber should now get nothing
+	memset(&probe, 0, sizeof(probe));
+	probe.index     = opt->startnumber + opt->count;
+	retain.subacked = 0;
+	retain_connect(&probe);
+	nnb_wait(&retain.subacked, 1, "probe subscribed", opt->timeout);
+	nng_msleep(1000);
+	retain_close(&probe);
+
+	printf("\n");
+	retain_rate("populate", &populate, populate_us);
+	printf("deliver: %d/%d subscribers got all %d retained in %.3fs, "
+	       "%llu msgs, rate=%.0f(msg/sec)\n",
+	    (int) retain.complete, opt->count, opt->topics,
+	    deliver_us / 1e6, (unsigned long long) retain.recv,
+	    deliver_us ? retain.recv * 1e6 / deliver_us : 0.0);
+	nnb_hist_summary(
+	    &retain.first_hist, "subscribe to first retained", "usec");
+	nnb_hist_summary(
+	    &retain.complete_hist, "subscribe to full set", "usec");
+	retain_rate("clear", &clear, clear_us);
+	printf("clear: %d retained messages left for a new subscriber\n",
+	    (int) probe.recv);
+
+	return (rv);
+}
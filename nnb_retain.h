@@ -0,0 +1,10 @@
+#ifndef NNB_RETAIN_H
+#define NNB_RETAIN_H
+#include "nnb_opt.h"
+
+// Retained store benchmark: bulk populate, subscribe-time delivery of
+// the whole retained set to many wildcard subscribers, and clearing.
+// Returns 0 when every subscriber got the full set.
+int nnb_retain_run(nnb_retain_opt *opt);
+
+#endif
@@ -0,0 +1,350 @@
+#include "nnb_search.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_payload.h"
+#include "nnb_pump.h"
+#include "nnb_util.h"
+#include <limits.h>
+#include <stdatomic.h>
+
+#define SEARCH_PARALLEL 4
+#define SEARCH_WINDOW 64  // in-flight publishes per publisher
+#define SEARCH_STEPS_MAX 64
+#define SEARCH_ACHIEVED 0.95 // of the offered rate the pump must send
+#define SEARCH_ID_LEN 64
+
+typedef struct search_client search_client;
+
+typedef struct {
+	nng_aio *      aio;
+	nng_ctx        ctx;
+	search_client *client;
+	bool           subscribe; // completion is for the SUBSCRIBE
+} search_work;
+
+struct search_client {
+	nng_socket  sock;
+	search_work works[SEARCH_PARALLEL];
+};
+
+typedef struct {
+	int      rate;      // offered, msg/sec
+	double   sent;      // publishes completed per second
+	double   delivered; // per subscriber per second
+	double   loss;      // percent of the window not delivered
+	uint64_t p50, p99, p999; // usec
+	bool     pass;
+	bool     underrun; // the pump could not send the offered rate
+} search_step;
+
+static struct {
+	nnb_search_opt *opt;
+	search_client * clients;
+	nnb_pump        pump;
+	uint8_t *       payload;
+	atomic_int      subacked;
+	// messages n with win_lo <= n < win_hi are measured
+	atomic_llong win_lo;
+	atomic_llong win_hi;
+	atomic_llong recv;
+	nnb_hist     hist; // stamp to delivery, usec
+	search_step  steps[SEARCH_STEPS_MAX];
+	int          nsteps;
+} search;
+
+static void
+search_cb(void *arg)
+{
+	search_work *w = arg;
+	nng_msg *    msg;
+	nnb_stamp    st;
+	uint8_t *    payload;
+	uint32_t     len;
+	int          rv;
+
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("search_cb", rv);
+		nng_ctx_recv(w->ctx, w->aio);
+		return;
+	}
+	msg = nng_aio_get_msg(w->aio);
+	nng_aio_set_msg(w->aio, NULL);
+	if (w->subscribe) {
+		w->subscribe = false;
+		++search.subacked;
+	} else if (msg != NULL) {
+		payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+		if (nnb_stamp_read(payload, len, &st) &&
+		    (long long) st.seq >= search.win_lo &&
+		    (long long) st.seq < search.win_hi) {
+			++search.recv;
+			nnb_hist_add(
+			    &search.hist, nnb_realtime_us() - st.ts_us);
+		}
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+	nng_ctx_recv(w->ctx, w->aio);
+}
+
+static void
+search_connect(search_client *c, int index)
+{
+	nnb_search_opt *opt = search.opt;
+	nng_msg *       msg;
+	char            id[SEARCH_ID_LEN];
+	int             rv;
+
+	if ((rv = nnb_client_open(
+	         &c->sock, opt->host, opt->port, &opt->tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+		return;
+	}
+	for (int i = 0; i < SEARCH_PARALLEL; i++) {
+		search_work *w = &c->works[i];
+		w->client      = c;
+		if ((rv = nng_aio_alloc(&w->aio, search_cb, w)) != 0) {
+			nng_fatal("nng_aio_alloc", rv);
+		}
+		if ((rv = nng_ctx_open(&w->ctx, c->sock)) != 0) {
+			nng_fatal("nng_ctx_open", rv);
+		}
+	}
+
+	msg = nnb_connect_msg(
+	    opt->keepalive, true, opt->username, opt->password);
+	snprintf(id, sizeof(id), "nnb_search_%d", index);
+	nng_mqtt_msg_set_connect_client_id(msg, id);
+	nnb_dial(c->sock, opt->host, opt->port, &opt->tls, msg);
+
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) opt->topic,
+		        .length     = strlen(opt->topic) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	c->works[0].subscribe = true;
+	nng_aio_set_msg(c->works[0].aio, msg);
+	nng_ctx_send(c->works[0].ctx, c->works[0].aio);
+	for (int i = 1; i < SEARCH_PARALLEL; i++) {
+		nng_ctx_recv(c->works[i].ctx, c->works[i].aio);
+	}
+}
+
+static void
+search_close(search_client *c)
+{
+	nng_close(c->sock);
+	for (int i = 0; i < SEARCH_PARALLEL; i++) {
+		nng_aio_free(c->works[i].aio);
+	}
+}
+
+// Message n carries a stamp with seq n, written into the encoded body.
+static nng_msg *
+search_make(uint64_t n, void *arg)
+{
+	nnb_search_opt *opt = arg;
+	nng_msg *       msg;
+	nnb_stamp       st = { .pub_id = 0, .seq = n };
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, opt->topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_payload(msg, search.payload, opt->size);
+	nng_mqtt_msg_encode(msg);
+	st.ts_us = nnb_realtime_us();
+	nnb_stamp_write(
+	    (uint8_t *) nng_msg_body(msg) + nng_msg_len(msg) - opt->size,
+	    &st);
+	return (msg);
+}
+
+// Waits up to ms for every subscriber to receive the whole window.
+static void
+search_drain(long long expect, int ms)
+{
+	for (int i = 0; i < ms / 10 && search.recv < expect; i++) {
+		nng_msleep(10);
+	}
+}
+
+static search_step *
+search_step_run(int rate)
+{
+	nnb_search_opt *opt = search.opt;
+	search_step *   s   = &search.steps[search.nsteps++];
+	long long       lo, hi, expect;
+	uint64_t        acked;
+	int             grace =
+	    opt->slo_p99 * 2 > 1000 ? opt->slo_p99 * 2 : 1000;
+	uint64_t        t0, us;
+
+	memset(s, 0, sizeof(*s));
+	s->rate = rate;
+	nnb_pump_rate(&search.pump, rate);
+	nng_msleep(opt->warmup * 1000);
+
+	// close the window before resetting what it counts
+	search.win_hi = 0;
+	nnb_hist_init(&search.hist);
+	search.recv   = 0;
+	lo            = search.pump.next;
+	acked         = search.pump.acked;
+	t0            = nnb_clock_us();
+	search.win_lo = lo;
+	search.win_hi = LLONG_MAX;
+	nng_msleep(opt->hold * 1000);
+	hi            = search.pump.next;
+	search.win_hi = hi;
+	us            = nnb_clock_us() - t0;
+	s->sent       = (search.pump.acked - acked) * 1e6 / us;
+
+	expect = (hi - lo) * opt->subscribers;
+	search_drain(expect, grace); // ms
+	s->delivered = (double) search.recv / opt->subscribers * 1e6 / us;
+	s->loss      = expect ? 100.0 * (expect - search.recv) / expect : 0;
+	if (s->loss < 0) {
+		s->loss = 0;
+	}
+	s->p50      = nnb_hist_percentile(&search.hist, 50);
+	s->p99      = nnb_hist_percentile(&search.hist, 99);
+	s->p999     = nnb_hist_percentile(&search.hist, 99.9);
+	s->underrun = s->sent < rate * SEARCH_ACHIEVED;
+	s->pass     = !s->underrun && search.recv > 0 &&
+	    s->p99 <= opt->slo_p99 * 1000 && s->loss <= opt->slo_loss;
+
+	printf("rate=%d(msg/sec): sent=%.0f, delivered=%.0f, p50=%.2fms, "
+	       "p99=%.2fms, loss=%.3f%% %s\n",
+	    rate, s->sent, s->delivered, s->p50 / 1e3, s->p99 / 1e3, s->loss,
+	    s->pass ? "PASS" : (s->underrun ? "FAIL (underrun)" : "FAIL"));
+	return (s);
+}
+
+static int
+search_cmp(const void *a, const void *b)
+{
+	return (((const search_step *) a)->rate -
+	    ((const search_step *) b)->rate);
+}
+
+static void
+search_report(int knee)
+{
+	nnb_search_opt *opt = search.opt;
+
+	qsort(search.steps, search.nsteps, sizeof(search_step), search_cmp);
+	printf("\nSLO: p99 <= %.2fms, loss <= %.3f%%, %d publishers, %d "
+	       "subscribers, qos %d, %d bytes\n",
+	    opt->slo_p99, opt->slo_loss, opt->count, opt->subscribers,
+	    opt->qos, opt->size);
+	printf("  offered       sent  delivered   p50(ms)   p99(ms)  "
+	       "p999(ms)   loss(%%)  verdict\n");
+	for (int i = 0; i < search.nsteps; i++) {
+		search_step *s = &search.steps[i];
+		printf("%9d  %9.0f  %9.0f  %8.2f  %8.2f  %8.2f  %8.3f  %s\n",
+		    s->rate, s->sent, s->delivered, s->p50 / 1e3,
+		    s->p99 / 1e3, s->p999 / 1e3, s->loss,
+		    s->pass ? "pass" : (s->underrun ? "underrun" : "fail"));
+	}
+	if (knee > 0) {
+		printf("knee: %d(msg/sec) is the highest rate within the "
+		       "SLO\n",
+		    knee);
+	} else {
+		printf("knee: no rate met the SLO, lower --rate-start\n");
+	}
+}
+
+int
+nnb_search_run(nnb_search_opt *opt)
+{
+	nnb_pump_cfg cfg;
+	int          pass = 0; // highest passing rate
+	int          fail = 0; // lowest failing rate above it
+	int          rate;
+	int          rv;
+
+	search.opt     = opt;
+	search.clients = nng_alloc(sizeof(search_client) * opt->subscribers);
+	search.payload = nng_alloc(opt->size);
+	if (search.clients == NULL || search.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(search.clients, 0, sizeof(search_client) * opt->subscribers);
+	memset(search.payload, 'A', opt->size);
+	nnb_hist_init(&search.hist);
+	search.win_lo = 0;
+	search.win_hi = 0;
+
+	for (int i = 0; i < opt->subscribers; i++) {
+		search_connect(&search.clients[i], opt->startnumber + i);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&search.subacked, opt->subscribers, "subscribed",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+
+	cfg = (nnb_pump_cfg) {
+		.host      = opt->host,
+		.port      = opt->port,
+		.tls       = &opt->tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_search_pub_",
+		.clients   = opt->count,
+		.window    = SEARCH_WINDOW,
+		.total     = 0,
+		.rate      = opt->rate_start,
+		.make      = search_make,
+		.arg       = opt,
+	};
+	if ((rv = nnb_pump_start(&search.pump, &cfg)) != 0) {
+		return (rv);
+	}
+
+	// ramp: double until the SLO breaks
+	for (rate = opt->rate_start; rate <= opt->rate_max && !nnb_stopped();
+	     rate *= 2) {
+		if (search.nsteps >= SEARCH_STEPS_MAX) {
+			break;
+		}
+		if (!search_step_run(rate)->pass) {
+			fail = rate;
+			break;
+		}
+		pass = rate;
+	}
+	// refine: bisect between the last pass and the first fail
+	for (int i = 0; i < opt->refine && fail > 0 && !nnb_stopped() &&
+	     search.nsteps < SEARCH_STEPS_MAX;
+	     i++) {
+		rate = pass + (fail - pass) / 2;
+		if (fail - pass <= pass / 20 || rate == pass) {
+			break; // within 5%
+		}
+		if (search_step_run(rate)->pass) {
+			pass = rate;
+		} else {
+			fail = rate;
+		}
+	}
+
+	nnb_pump_stop(&search.pump);
+	for (int i = 0; i < opt->subscribers; i++) {
+		search_close(&search.clients[i]);
+	}
+	search_report(pass);
+	return (pass > 0 ? 0 : NNG_ETIMEDOUT);
+}
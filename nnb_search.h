@@ -0,0 +1,11 @@
+#ifndef NNB_SEARCH_H
+#define NNB_SEARCH_H
+#include "nnb_opt.h"
+
+// Saturation search: paced publishers and in-process subscribers step
+// the offered rate up, then bisect, to find the highest rate whose
+// delivery latency and loss stay within the SLO. Returns 0 when at
+// least one rate passed.
+int nnb_search_run(nnb_search_opt *opt);
+
+#endif
@@ -0,0 +1,294 @@
+#include "nnb_session.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_proc.h"
+#include "nnb_pump.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <stdatomic.h>
+
+#define SESSION_PARALLEL 2
+#define SESSION_WINDOW 32 // in-flight publishes per publisher
+#define SESSION_ID_LEN 64
+
+typedef struct session_client session_client;
+
+typedef struct {
+	nng_aio *       aio;
+	nng_ctx         ctx;
+	session_client *client;
+	bool            subscribe; // completion is for the SUBSCRIBE
+} session_work;
+
+struct session_client {
+	int          index;
+	nng_socket   sock;
+	session_work works[SESSION_PARALLEL];
+	atomic_int   recv;
+};
+
+static struct {
+	nnb_session_opt *opt;
+	session_client * clients;
+	nnb_pump         pump;
+	uint8_t *        payload;
+	int              total; // messages to queue
+	atomic_int       subacked;
+	atomic_int       recv;
+	atomic_ullong    first_us;
+	atomic_ullong    last_us;
+} session;
+
+static void
+session_cb(void *arg)
+{
+	session_work *  w = arg;
+	session_client *c = w->client;
+	nng_msg *       msg;
+	uint64_t        now;
+	uint64_t        v;
+	int             rv;
+
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("session_cb", rv);
+		nng_ctx_recv(w->ctx, w->aio);
+		return;
+	}
+	msg = nng_aio_get_msg(w->aio);
+	nng_aio_set_msg(w->aio, NULL);
+	if (w->subscribe) {
+		w->subscribe = false;
+		++session.subacked;
+	} else if (msg != NULL) {
+		now = nnb_clock_us();
+		++c->recv;
+		++session.recv;
+		v = 0;
+		atomic_compare_exchange_strong(&session.first_us, &v, now);
+		v = atomic_load(&session.last_us);
+		while (v < now &&
+		    !atomic_compare_exchange_weak(&session.last_us, &v, now))
+			;
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+	nng_ctx_recv(w->ctx, w->aio);
+}
+
+static void
+session_connect(session_client *c, bool subscribe)
+{
+	nnb_session_opt *opt = session.opt;
+	nng_msg *        msg;
+	char             buf[SESSION_ID_LEN + NNB_TOPIC_LEN];
+	int              rv;
+
+	if ((rv = nnb_client_open(
+	         &c->sock, opt->host, opt->port, &opt->tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+		return;
+	}
+	for (int i = 0; i < SESSION_PARALLEL; i++) {
+		session_work *w = &c->works[i];
+		w->client       = c;
+		w->subscribe    = false;
+		if ((rv = nng_aio_alloc(&w->aio, session_cb, w)) != 0) {
+			nng_fatal("nng_aio_alloc", rv);
+		}
+		if ((rv = nng_ctx_open(&w->ctx, c->sock)) != 0) {
+			nng_fatal("nng_ctx_open", rv);
+		}
+	}
+
+	// the same client id on reconnect resumes the session
+	msg = nnb_connect_msg(
+	    opt->keepalive, false, opt->username, opt->password);
+	snprintf(buf, sizeof(buf), "nnb_session_%d", c->index);
+	nng_mqtt_msg_set_connect_client_id(msg, buf);
+	nnb_dial(c->sock, opt->host, opt->port, &opt->tls, msg);
+
+	if (subscribe) {
+		snprintf(buf, sizeof(buf), "%s/%d", opt->topic, c->index);
+		nng_mqtt_topic_qos topic_qos[] = {
+			{ .qos     = opt->qos,
+			    .topic = { .buf = (uint8_t *) buf,
+			        .length     = strlen(buf) } },
+		};
+		nng_mqtt_msg_alloc(&msg, 0);
+		nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+		nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+		c->works[0].subscribe = true;
+		nng_aio_set_msg(c->works[0].aio, msg);
+		nng_ctx_send(c->works[0].ctx, c->works[0].aio);
+	} else {
+		nng_ctx_recv(c->works[0].ctx, c->works[0].aio);
+	}
+	for (int i = 1; i < SESSION_PARALLEL; i++) {
+		nng_ctx_recv(c->works[i].ctx, c->works[i].aio);
+	}
+}
+
+static void
+session_close(session_client *c)
+{
+	nng_close(c->sock);
+	for (int i = 0; i < SESSION_PARALLEL; i++) {
+		nng_aio_free(c->works[i].aio);
+		c->works[i].aio = NULL;
+	}
+}
+
+// Message n of the queueing phase: sessions are filled round-robin.
+static nng_msg *
+session_make(uint64_t n, void *arg)
+{
+	nnb_session_opt *opt = arg;
+	nng_msg *        msg;
+	char             topic[NNB_TOPIC_LEN];
+
+	snprintf(topic, sizeof(topic), "%s/%d", opt->topic,
+	    opt->startnumber + (int) (n % opt->count));
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_payload(msg, session.payload, opt->size);
+	nng_mqtt_msg_encode(msg);
+	return (msg);
+}
+
+static void
+session_report(uint64_t sub_us, uint64_t pub_us, uint64_t drain_start,
+    uint64_t rss0, uint64_t rss1)
+{
+	nnb_session_opt *opt   = session.opt;
+	int              recv  = session.recv;
+	uint64_t         first = session.first_us;
+	uint64_t         last  = session.last_us;
+	int              minr  = INT32_MAX;
+	int              maxr  = 0;
+	int              lack  = 0; // sessions that did not get everything
+
+	for (int i = 0; i < opt->count; i++) {
+		int r = session.clients[i].recv;
+		minr  = r < minr ? r : minr;
+		maxr  = r > maxr ? r : maxr;
+		if (r < opt->queued) {
+			lack++;
+		}
+	}
+
+	printf("\n");
+	printf("subscribe: %d sessions in %.3fs\n", opt->count, sub_us / 1e6);
+	printf("queue: %d acked, %d failed in %.3fs, rate=%.0f(msg/sec)\n",
+	    (int) session.pump.acked, (int) session.pump.failed,
+	    pub_us / 1e6, pub_us ? session.pump.acked * 1e6 / pub_us : 0.0);
+	printf("drain: %d/%d received, per session min=%d max=%d, %d "
+	       "sessions incomplete\n",
+	    recv, session.total, minr, maxr, lack);
+	if (recv > 0) {
+		printf("drain: first queued msg after %.3fs, last after "
+		       "%.3fs\n",
+		    (first - drain_start) / 1e6, (last - drain_start) / 1e6);
+		printf("drain: rate=%.0f(msg/sec) from reconnect, "
+		       "%.0f(msg/sec) first to last\n",
+		    recv * 1e6 / (last - drain_start),
+		    last > first ? (recv - 1) * 1e6 / (last - first) : 0.0);
+	}
+	if (opt->broker_pid > 0) {
+		printf("broker rss: %.1f MB before queueing, %.1f MB after, "
+		       "%.0f bytes per queued message\n",
+		    rss0 / 1048576.0, rss1 / 1048576.0,
+		    session.pump.acked
+		        ? ((double) rss1 - rss0) / session.pump.acked
+		        : 0.0);
+	}
+}
+
+int
+nnb_session_run(nnb_session_opt *opt)
+{
+	nnb_pump_cfg cfg;
+	uint64_t     t0, sub_us, pub_us, drain_start;
+	uint64_t     rss0 = 0;
+	uint64_t     rss1 = 0;
+	int          rv;
+
+	session.opt     = opt;
+	session.total   = opt->count * opt->queued;
+	session.clients = nng_alloc(sizeof(session_client) * opt->count);
+	session.payload = nng_alloc(opt->size + 1);
+	if (session.clients == NULL || session.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(session.clients, 0, sizeof(session_client) * opt->count);
+	memset(session.payload, 'A', opt->size + 1);
+
+	// 1. persistent subscribers
+	t0 = nnb_clock_us();
+	for (int i = 0; i < opt->count; i++) {
+		session.clients[i].index = opt->startnumber + i;
+		session_connect(&session.clients[i], true);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&session.subacked, opt->count, "subscribed",
+	        opt->timeout)) {
+		return (NNG_ETIMEDOUT);
+	}
+	sub_us = nnb_clock_us() - t0;
+
+	// 2. go offline, the broker keeps the sessions
+	for (int i = 0; i < opt->count; i++) {
+		session_close(&session.clients[i]);
+	}
+	nng_msleep(1000);
+	if (opt->broker_pid > 0) {
+		rss0 = nnb_proc_rss(opt->broker_pid);
+	}
+
+	// 3. queue messages for the offline sessions
+	cfg = (nnb_pump_cfg) {
+		.host      = opt->host,
+		.port      = opt->port,
+		.tls       = &opt->tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_session_pub_",
+		.clients   = opt->publishers,
+		.window    = SESSION_WINDOW,
+		.total     = session.total,
+		.make      = session_make,
+		.arg       = opt,
+	};
+	t0 = nnb_clock_us();
+	if ((rv = nnb_pump_start(&session.pump, &cfg)) != 0) {
+		return (rv);
+	}
+	nnb_wait64(&session.pump.done, session.total, "queued", opt->timeout);
+	pub_us = nnb_clock_us() - t0;
+	nnb_pump_stop(&session.pump);
+	if (opt->broker_pid > 0) {
+		nng_msleep(1000);
+		rss1 = nnb_proc_rss(opt->broker_pid);
+	}
+
+	// 4. reconnect and drain
+	drain_start = nnb_clock_us();
+	for (int i = 0; i < opt->count; i++) {
+		session_connect(&session.clients[i], false);
+	}
+	nnb_wait(&session.recv, session.pump.acked, "drained", opt->timeout);
+
+	session_report(sub_us, pub_us, drain_start, rss0, rss1);
+
+	for (int i = 0; i < opt->count; i++) {
+		session_close(&session.clients[i]);
+	}
+	return (session.recv >= session.pump.acked ? 0 : NNG_ETIMEDOUT);
+}
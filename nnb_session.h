@@ -0,0 +1,10 @@
+#ifndef NNB_SESSION_H
+#define NNB_SESSION_H
+#include "nnb_opt.h"
+
+// Persistent session offline-queue drain benchmark. Runs its phases to
+// completion and prints the report; returns 0 when every queued
+// message was drained.
+int nnb_session_run(nnb_session_opt *opt);
+
+#endif
@@ -0,0 +1,412 @@
+#include "nnb_share.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_payload.h"
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+
+#define SHARE_PARALLEL 4
+#define SHARE_DETAIL_MAX 64 // print per-member lines up to this many
+
+typedef struct share_member share_member;
+
+typedef struct {
+	nng_aio *     aio;
+	nng_ctx       ctx;
+	share_member *member;
+	bool          subscribe; // completion is for the SUBSCRIBE
+} share_work;
+
+struct share_member {
+	int           group;
+	int           index;
+	int           n; // client number
+	bool          active;
+	nng_socket    sock;
+	share_work    works[SHARE_PARALLEL];
+	atomic_ullong recv;
+	uint64_t      last_recv; // main thread only
+	uint64_t      step_recv; // recv when the current ramp step began
+	nnb_hist      lat;       // publish to delivery, usec
+};
+
+typedef struct {
+	int    size; // active members per group
+	double rate;
+	double ratio;
+	double gini;
+} share_step;
+
+static struct {
+	nnb_sub_opt * opt;
+	nnb_ids *     ids;
+	nnb_cred *    cred;
+	share_member *members;
+	int           groups;
+	int           size;   // members per group when fully ramped
+	int           active; // members per group the ramp allows now
+	int           ticks;
+	int           step_ticks;
+	share_step *  steps;
+	int           nsteps;
+	share_member *left; // member taken out by churn
+	uint64_t      seed;
+} share;
+
+static void
+share_cb(void *arg)
+{
+	share_work *  w = arg;
+	share_member *m = w->member;
+	nng_msg *     msg;
+	nnb_stamp     st;
+	uint8_t *     payload;
+	uint32_t      len;
+	int           rv;
+
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			// the member left, its socket is gone
+			return;
+		}
+		nng_fatal("share_cb", rv);
+		nng_ctx_recv(w->ctx, w->aio);
+		return;
+	}
+	if ((msg = nng_aio_get_msg(w->aio)) != NULL) {
+		nng_aio_set_msg(w->aio, NULL);
+		if (w->subscribe) {
+			w->subscribe = false;
+		} else {
+			atomic_fetch_add_explicit(
+			    &m->recv, 1, memory_order_relaxed);
+			payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+			if (nnb_stamp_read(payload, len, &st)) {
+				nnb_hist_add(
+				    &m->lat, nnb_realtime_us() - st.ts_us);
+			}
+		}
+		nng_msg_free(msg);
+	} else if (w->subscribe) {
+		w->subscribe = false;
+	}
+	nng_ctx_recv(w->ctx, w->aio);
+}
+
+static void
+share_join(share_member *m)
+{
+	nnb_sub_opt *opt      = share.opt;
+	const char * id       = nnb_ids_get(share.ids, m->n);
+	const char * username = opt->username;
+	const char * password = opt->password;
+	nng_msg *    msg;
+	char         topic[NNB_TOPIC_LEN];
+	char         row[NNB_CRED_ROW];
+	int          rv;
+
+	if ((rv = nnb_client_open(
+	         &m->sock, opt->host, opt->port, &opt->tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+		return;
+	}
+	for (int i = 0; i < SHARE_PARALLEL; i++) {
+		share_work *w = &m->works[i];
+		w->member     = m;
+		w->subscribe  = false;
+		if ((rv = nng_aio_alloc(&w->aio, share_cb, w)) != 0) {
+			nng_fatal("nng_aio_alloc", rv);
+		}
+		if ((rv = nng_ctx_open(&w->ctx, m->sock)) != 0) {
+			nng_fatal("nng_ctx_open", rv);
+		}
+	}
+
+	if (share.cred->count > 0) {
+		nnb_cred_row(share.cred, m->n, row, &id, &username, &password);
+	}
+	msg = nnb_connect_msg(opt->keepalive, opt->clean, username, password);
+	if (id != NULL) {
+		nng_mqtt_msg_set_connect_client_id(msg, id);
+	}
+	nnb_dial(m->sock, opt->host, opt->port, &opt->tls, msg);
+
+	snprintf(topic, sizeof(topic), "$share/g%d/%s", m->group, opt->topic);
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) topic,
+		        .length     = strlen(topic) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+
+	m->active             = true;
+	m->works[0].subscribe = true;
+	nng_aio_set_msg(m->works[0].aio, msg);
+	nng_ctx_send(m->works[0].ctx, m->works[0].aio);
+	for (int i = 1; i < SHARE_PARALLEL; i++) {
+		nng_ctx_recv(m->works[i].ctx, m->works[i].aio);
+	}
+}
+
+static void
+share_leave(share_member *m)
+{
+	m->active = false;
+	nng_close(m->sock);
+	for (int i = 0; i < SHARE_PARALLEL; i++) {
+		// waits for a callback still running on this work
+		nng_aio_free(m->works[i].aio);
+		m->works[i].aio = NULL;
+	}
+}
+
+static int
+cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *) a;
+	uint64_t y = *(const uint64_t *) b;
+	return (x < y ? -1 : x > y);
+}
+
+// Skew of per-member counts: max/min ratio and Gini coefficient
+// (0 is a perfectly even split, (n-1)/n all on one member).
+static void
+share_skew(uint64_t *v, int n, double *ratio, double *gini)
+{
+	double sum  = 0;
+	double wsum = 0;
+
+	*ratio = 0;
+	*gini  = 0;
+	if (n == 0) {
+		return;
+	}
+	qsort(v, n, sizeof(uint64_t), cmp_u64);
+	for (int i = 0; i < n; i++) {
+		sum += v[i];
+		wsum += (double) (i + 1) * v[i];
+	}
+	if (sum == 0) {
+		return;
+	}
+	*ratio = v[0] == 0 ? INFINITY : (double) v[n - 1] / v[0];
+	*gini  = 2 * wsum / (n * sum) - (double) (n + 1) / n;
+}
+
+static void
+share_record_step(void)
+{
+	int         n = share.groups * share.size;
+	int         k = 0;
+	uint64_t *  v;
+	uint64_t    total = 0;
+	double      secs  = share.step_ticks;
+	share_step *steps;
+	share_step *st;
+
+	if (secs == 0 || (v = nng_alloc(sizeof(uint64_t) * n)) == NULL) {
+		return;
+	}
+	for (int i = 0; i < n; i++) {
+		share_member *m = &share.members[i];
+		uint64_t      r = atomic_load(&m->recv);
+		if (m->active) {
+			v[k++] = r - m->step_recv;
+			total += r - m->step_recv;
+		}
+		m->step_recv = r;
+	}
+	steps = realloc(share.steps, sizeof(share_step) * (share.nsteps + 1));
+	if (steps != NULL) {
+		share.steps = steps;
+		st          = &steps[share.nsteps++];
+		st->size    = share.active;
+		st->rate    = total / secs;
+		share_skew(v, k, &st->ratio, &st->gini);
+	}
+	share.step_ticks = 0;
+	nng_free(v, sizeof(uint64_t) * n);
+}
+
+int
+nnb_share_start(nnb_share_cfg *cfg)
+{
+	nnb_sub_opt *opt = cfg->opt;
+	int          n;
+
+	share.opt    = opt;
+	share.ids    = cfg->ids;
+	share.cred   = cfg->cred;
+	share.groups = opt->share_groups;
+	share.size   = opt->share_members;
+	share.active = opt->share_step > 0 ? 1 : share.size;
+	share.seed   = ((uint64_t) nng_random() << 32) | nng_random() | 1;
+
+	n             = share.groups * share.size;
+	share.members = nng_alloc(sizeof(share_member) * n);
+	if (share.members == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(share.members, 0, sizeof(share_member) * n);
+	for (int i = 0; i < n; i++) {
+		share_member *m = &share.members[i];
+		m->group        = i / share.size;
+		m->index        = i % share.size;
+		m->n            = opt->startnumber + i;
+		atomic_init(&m->recv, 0);
+		nnb_hist_init(&m->lat);
+	}
+
+	for (int i = 0; i < n; i++) {
+		share_member *m = &share.members[i];
+		if (m->index < share.active) {
+			share_join(m);
+			nng_msleep(opt->interval);
+		}
+	}
+	return (0);
+}
+
+void
+nnb_share_tick(void)
+{
+	int       n = share.groups * share.size;
+	int       k = 0;
+	uint64_t *v;
+	uint64_t  total = 0;
+	double    ratio, gini;
+
+	if ((v = nng_alloc(sizeof(uint64_t) * n)) == NULL) {
+		return;
+	}
+	for (int i = 0; i < n; i++) {
+		share_member *m = &share.members[i];
+		uint64_t      r = atomic_load(&m->recv);
+		if (m->active) {
+			v[k++] = r - m->last_recv;
+			total += r - m->last_recv;
+		}
+		m->last_recv = r;
+	}
+	share_skew(v, k, &ratio, &gini);
+	nng_free(v, sizeof(uint64_t) * n);
+	if (total != 0) {
+		printf("share: members=%d, rate=%llu(msg/sec), max/min=%.2f, "
+		       "gini=%.3f\n",
+		    k, (unsigned long long) total, ratio, gini);
+	}
+
+	share.ticks++;
+	share.step_ticks++;
+	if (share.opt->share_step > 0 && share.active < share.size &&
+	    share.step_ticks >= share.opt->share_step) {
+		share_record_step();
+		for (int g = 0; g < share.groups; g++) {
+			share_join(
+			    &share.members[g * share.size + share.active]);
+		}
+		share.active++;
+		printf("share: %d members per group\n", share.active);
+	}
+
+	if (share.opt->share_churn > 0 &&
+	    share.ticks % share.opt->share_churn == 0) {
+		if (share.left != NULL) {
+			share_member *m = share.left;
+			share.left      = NULL;
+			share_join(m);
+			printf("share: member g%d/%d rejoined\n", m->group,
+			    m->index);
+		} else {
+			int           i = nnb_rand(&share.seed) % n;
+			share_member *m = &share.members[i];
+			if (m->active) {
+				share_leave(m);
+				share.left = m;
+				printf("share: member g%d/%d left\n", m->group,
+				    m->index);
+			}
+		}
+	}
+}
+
+void
+nnb_share_report(double secs)
+{
+	int       n = share.groups * share.size;
+	uint64_t *v;
+	uint64_t  total = 0;
+	double    ratio, gini;
+	nnb_hist  lat;
+
+	if ((v = nng_alloc(sizeof(uint64_t) * n)) == NULL) {
+		return;
+	}
+	share_record_step();
+
+	for (int i = 0; i < n; i++) {
+		v[i] = atomic_load(&share.members[i].recv);
+		total += v[i];
+	}
+	printf("share: groups=%d, members=%d, recv=%llu in %.1fs, avg "
+	       "rate=%.0f(msg/sec)\n",
+	    share.groups, share.size, (unsigned long long) total, secs,
+	    total / secs);
+
+	for (int g = 0; g < share.groups; g++) {
+		share_member *gm     = &share.members[g * share.size];
+		uint64_t      gtotal = 0;
+
+		nnb_hist_init(&lat);
+		for (int i = 0; i < share.size; i++) {
+			v[i] = atomic_load(&gm[i].recv);
+			gtotal += v[i];
+			nnb_hist_merge(&lat, &gm[i].lat);
+		}
+		share_skew(v, share.size, &ratio, &gini);
+		printf("group g%d: recv=%llu, max/min=%.2f, gini=%.3f\n", g,
+		    (unsigned long long) gtotal, ratio, gini);
+		nnb_hist_summary(&lat, "  latency", "usec");
+		if (n > SHARE_DETAIL_MAX) {
+			continue;
+		}
+		for (int i = 0; i < share.size; i++) {
+			uint64_t r = atomic_load(&gm[i].recv);
+			printf("  g%d/%d: recv=%llu (%.1f%%), p50=%llu, "
+			       "p99=%llu(usec)\n",
+			    g, i, (unsigned long long) r,
+			    gtotal ? 100.0 * r / gtotal : 0.0,
+			    (unsigned long long) nnb_hist_percentile(
+			        &gm[i].lat, 50),
+			    (unsigned long long) nnb_hist_percentile(
+			        &gm[i].lat, 99));
+		}
+	}
+
+	if (share.nsteps > 0) {
+		printf("members/group  rate(msg/sec)  max/min   gini\n");
+		for (int i = 0; i < share.nsteps; i++) {
+			printf("%13d  %13.0f  %7.2f  %5.3f\n",
+			    share.steps[i].size, share.steps[i].rate,
+			    share.steps[i].ratio, share.steps[i].gini);
+		}
+	}
+	nng_free(v, sizeof(uint64_t) * n);
+}
+
+uint64_t
+nnb_share_recv(void)
+{
+	uint64_t total = 0;
+
+	for (int i = 0; i < share.groups * share.size; i++) {
+		total += atomic_load(&share.members[i].recv);
+	}
+	return (total);
+}
@@ -0,0 +1,26 @@
+#ifndef NNB_SHARE_H
+#define NNB_SHARE_H
+#include "nnb_cred.h"
+#include "nnb_id.h"
+#include "nnb_opt.h"
+
+// Shared subscription benchmark: --share-groups consumer groups of
+// --share-members members, each member a client subscribed to
+// $share/g<group>/<topic>.
+
+typedef struct {
+	nnb_sub_opt *opt;
+	nnb_ids *    ids;  // client ids
+	nnb_cred *   cred; // rows override ids and logins when loaded
+} nnb_share_cfg;
+
+// Member i of the groups in order is client -n + i, for its id and
+// --cred-file row; -c is the member count.
+int  nnb_share_start(nnb_share_cfg *cfg);
+void nnb_share_tick(void);
+void nnb_share_report(double secs);
+
+// Messages received by all members so far.
+uint64_t nnb_share_recv(void);
+
+#endif
@@ -0,0 +1,57 @@
+#include "nnb_slab.h"
+#include <nng/nng.h>
+#include <string.h>
+
+void
+nnb_slab_init(nnb_slab *s, size_t size, int per_chunk)
+{
+	memset(s, 0, sizeof(*s));
+	// keep records 8-byte aligned
+	s->size      = (size + 7) & ~(size_t) 7;
+	s->per_chunk = per_chunk;
+}
+
+void *
+nnb_slab_alloc(nnb_slab *s)
+{
+	int idx = s->used % s->per_chunk;
+
+	if (idx == 0 && s->used / s->per_chunk == s->nchunks) {
+		uint8_t *chunk;
+
+		if (s->nchunks == s->cap) {
+			int       cap = s->cap ? s->cap * 2 : 16;
+			uint8_t **chunks;
+
+			if ((chunks = nng_alloc(sizeof(uint8_t *) * cap)) ==
+			    NULL) {
+				return (NULL);
+			}
+			if (s->nchunks > 0) {
+				memcpy(chunks, s->chunks,
+				    sizeof(uint8_t *) * s->nchunks);
+				nng_free(s->chunks, sizeof(uint8_t *) * s->cap);
+			}
+			s->chunks = chunks;
+			s->cap    = cap;
+		}
+		if ((chunk = nng_alloc(s->size * s->per_chunk)) == NULL) {
+			return (NULL);
+		}
+		memset(chunk, 0, s->size * s->per_chunk);
+		s->chunks[s->nchunks++] = chunk;
+	}
+	return (s->chunks[s->used++ / s->per_chunk] + idx * s->size);
+}
+
+size_t
+nnb_slab_used(nnb_slab *s)
+{
+	return (s->size * s->used);
+}
+
+size_t
+nnb_slab_bytes(nnb_slab *s)
+{
+	return (s->size * s->per_chunk * s->nchunks);
+}
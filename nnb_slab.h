@@ -0,0 +1,25 @@
+#ifndef NNB_SLAB_H
+#define NNB_SLAB_H
+#include <stddef.h>
+#include <stdint.h>
+
+// Fixed-size records carved out of large zeroed chunks: no allocator
+// header per record, records of one kind stay contiguous, and pointers
+// stay valid because chunks never move. Not thread safe; clients are
+// created from the main thread.
+typedef struct {
+	size_t    size;      // record size
+	int       per_chunk; // records per chunk
+	int       used;      // records handed out
+	int       nchunks;
+	int       cap;       // slots in chunks
+	uint8_t **chunks;
+} nnb_slab;
+
+void   nnb_slab_init(nnb_slab *s, size_t size, int per_chunk);
+void * nnb_slab_alloc(nnb_slab *s);
+// Bytes in records handed out, and bytes reserved in whole chunks.
+size_t nnb_slab_used(nnb_slab *s);
+size_t nnb_slab_bytes(nnb_slab *s);
+
+#endif
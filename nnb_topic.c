@@ -0,0 +1,176 @@
+#include "nnb_topic.h"
+#include "nnb_util.h"
+#include <nng/mqtt/mqtt_client.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static atomic_int topic_cnt = 0;
+
+// spec is a comma separated fanout list, e.g. "10,10,100".
+int
+nnb_tree_parse(nnb_tree *tree, const char *spec)
+{
+	const char *p = spec;
+	char *      end;
+
+	tree->depth    = 0;
+	tree->leaf_len = 0;
+	tree->leaves   = 1;
+	while (*p != '\0') {
+		long n = strtol(p, &end, 10);
+		if (end == p || n <= 0 || tree->depth == NNB_TREE_MAX_DEPTH) {
+			return (-1);
+		}
+		tree->fanout[tree->depth] = (int) n;
+		tree->width[tree->depth]  = 1;
+		for (long m = n - 1; m >= 10; m /= 10) {
+			tree->width[tree->depth]++;
+		}
+		tree->leaf_len += 1 + tree->width[tree->depth++];
+		tree->leaves *= (uint64_t) n;
+		p = end;
+		if (*p == ',') {
+			p++;
+		} else if (*p != '\0') {
+			return (-1);
+		}
+	}
+	return (tree->depth > 0 ? 0 : -1);
+}
+
+void
+nnb_tree_digits(nnb_tree *tree, uint64_t leaf, int *digits)
+{
+	for (int i = tree->depth - 1; i >= 0; i--) {
+		digits[i] = (int) (leaf % tree->fanout[i]);
+		leaf /= tree->fanout[i];
+	}
+}
+
+int
+nnb_tree_topic(
+    nnb_tree *tree, const char *base, uint64_t leaf, char *buf, size_t len)
+{
+	size_t off = snprintf(buf, len, "%s", base);
+
+	if (off + tree->leaf_len >= len) {
+		return (-1);
+	}
+	nnb_tree_leaf(tree, leaf, buf + off);
+	buf[off + tree->leaf_len] = '\0';
+	return (0);
+}
+
+// Digits are written from the last level backwards, so no division
+// result is needed twice and nothing is formatted.
+void
+nnb_tree_leaf(nnb_tree *tree, uint64_t leaf, char *p)
+{
+	p += tree->leaf_len;
+	for (int i = tree->depth - 1; i >= 0; i--) {
+		uint64_t d = leaf % tree->fanout[i];
+
+		leaf /= tree->fanout[i];
+		for (int w = 0; w < tree->width[i]; w++) {
+			*--p = '0' + d % 10;
+			d /= 10;
+		}
+		*--p = '/';
+	}
+}
+
+// Filters are cut from a random leaf so every filter matches at least
+// one topic of the tree. A '+' replaces one random level, a '#' cuts
+// the path at a random level.
+void
+nnb_filter_gen(nnb_tree *tree, int plus_ratio, int hash_ratio,
+    uint64_t *seed, nnb_filter *f)
+{
+	int r = (int) (nnb_rand(seed) % 100);
+
+	nnb_tree_digits(tree, nnb_rand(seed) % tree->leaves, f->level);
+	f->len = tree->depth;
+	if (r < plus_ratio) {
+		f->kind = FILTER_PLUS;
+		f->level[nnb_rand(seed) % tree->depth] = NNB_LEVEL_PLUS;
+	} else if (r < plus_ratio + hash_ratio) {
+		f->kind = FILTER_HASH;
+		f->len  = (int) (nnb_rand(seed) % tree->depth);
+	} else {
+		f->kind = FILTER_EXACT;
+	}
+}
+
+int
+nnb_filter_render(nnb_tree *tree, nnb_filter *f, const char *base,
+    char *buf, size_t len)
+{
+	size_t off = snprintf(buf, len, "%s", base);
+
+	for (int i = 0; i < f->len && off < len; i++) {
+		if (f->level[i] == NNB_LEVEL_PLUS) {
+			off += snprintf(buf + off, len - off, "/+");
+		} else {
+			off += snprintf(buf + off, len - off, "/%0*d",
+			    tree->width[i], f->level[i]);
+		}
+	}
+	if (f->kind == FILTER_HASH && off < len) {
+		off += snprintf(buf + off, len - off, "/#");
+	}
+	return (off < len ? 0 : -1);
+}
+
+bool
+nnb_filter_match(nnb_filter *f, nnb_tree *tree, const int *digits)
+{
+	if (f->kind != FILTER_HASH && f->len != tree->depth) {
+		return (false);
+	}
+	for (int i = 0; i < f->len; i++) {
+		if (f->level[i] != NNB_LEVEL_PLUS &&
+		    f->level[i] != digits[i]) {
+			return (false);
+		}
+	}
+	return (true);
+}
+
+char *
+nnb_opt_get_topic(char *opt_topic, char *opt_username, nng_msg *msg)
+{
+	char *topic = NULL;
+	if ((topic = strstr(opt_topic, "\%c")) != NULL) {
+		int         len = topic - opt_topic + 1;
+		const char *client_id =
+		    nng_mqtt_msg_get_connect_client_id(msg);
+		size_t size = len + strlen(client_id) + 1;
+		topic       = (char *) nng_alloc(sizeof(char) * size);
+		char *t     = (char *) nng_alloc(sizeof(char) * len);
+		snprintf(t, len, "%s", opt_topic);
+		snprintf(topic, size, "%s%s", t, client_id);
+		nng_free(t, len);
+	} else if ((topic = strstr(opt_topic, "\%u")) != NULL) {
+		int    len      = topic - opt_topic + 1;
+		char * username = opt_username ? opt_username : "undefined";
+		size_t size     = len + strlen(username) + 1;
+		topic           = (char *) nng_alloc(sizeof(char) * size);
+		char *t         = (char *) nng_alloc(sizeof(char) * len);
+		snprintf(t, len, "%s", opt_topic);
+		snprintf(topic, size, "%s%s", t, username);
+		nng_free(t, len);
+	} else if ((topic = strstr(opt_topic, "\%i")) != NULL) {
+		int    len  = topic - opt_topic + 1;
+		size_t size = len + 5;
+		topic       = (char *) nng_alloc(sizeof(char) * size);
+		char *t     = (char *) nng_alloc(sizeof(char) * len);
+		snprintf(t, len, "%s", opt_topic);
+		snprintf(topic, size, "%s%d", t, topic_cnt++);
+		nng_free(t, len);
+	} else {
+		return opt_topic;
+	}
+	return topic;
+}
@@ -0,0 +1,60 @@
+#ifndef NNB_TOPIC_H
+#define NNB_TOPIC_H
+#include <nng/nng.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NNB_TREE_MAX_DEPTH 16
+#define NNB_TOPIC_LEN 256
+
+// A generated topic tree: "<base>/<d0>/<d1>/..." where level i has
+// fanout[i] children named "0".."fanout[i]-1", zero padded to the width
+// of the largest, so every leaf topic has the same length and a leaf
+// can be written over another in place. Publishers and subscribers
+// given the same --tree spec agree on the topic space.
+typedef struct {
+	int      depth;
+	int      fanout[NNB_TREE_MAX_DEPTH];
+	int      width[NNB_TREE_MAX_DEPTH]; // digits of each level's names
+	size_t   leaf_len; // bytes after the base, "/<d0>/<d1>/..."
+	uint64_t leaves;
+} nnb_tree;
+
+typedef enum {
+	FILTER_EXACT,
+	FILTER_PLUS,
+	FILTER_HASH,
+} nnb_filter_kind;
+
+#define NNB_LEVEL_PLUS (-1)
+
+// Compact filter against a tree. For FILTER_HASH only the first len
+// levels are kept and '#' follows them.
+typedef struct {
+	nnb_filter_kind kind;
+	int             len;
+	int             level[NNB_TREE_MAX_DEPTH];
+} nnb_filter;
+
+int  nnb_tree_parse(nnb_tree *tree, const char *spec);
+void nnb_tree_digits(nnb_tree *tree, uint64_t leaf, int *digits);
+int  nnb_tree_topic(nnb_tree *tree, const char *base, uint64_t leaf,
+     char *buf, size_t len);
+
+// Writes the leaf_len bytes following the base of a leaf topic to p,
+// without a terminating NUL.
+void nnb_tree_leaf(nnb_tree *tree, uint64_t leaf, char *p);
+
+void nnb_filter_gen(nnb_tree *tree, int plus_ratio, int hash_ratio,
+    uint64_t *seed, nnb_filter *f);
+int  nnb_filter_render(nnb_tree *tree, nnb_filter *f, const char *base,
+     char *buf, size_t len);
+bool nnb_filter_match(nnb_filter *f, nnb_tree *tree, const int *digits);
+
+// --topic with its first %c (client id of the CONNECT msg), %u
+// (username) or %i (a process-wide counter) expanded into a new
+// nng_alloc string, or opt_topic itself when it has none.
+char *nnb_opt_get_topic(char *opt_topic, char *opt_username, nng_msg *msg);
+
+#endif
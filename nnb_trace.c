@@ -0,0 +1,217 @@
+#include "nnb_trace.h"
+#include "dbg.h"
+#include "nnb_hist.h"
+#include "nnb_util.h"
+#include <nng/nng.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct {
+	bool                 deliver; // subscriber span: start and completed
+	uint32_t             pub_id;
+	uint64_t             seq;
+	atomic_uint_fast64_t mark[MARK_MAX];
+} trace_span;
+
+static const char *stage_names[TRACE_STAGES] = {
+	[TRACE_RENDER]   = "render",
+	[TRACE_STAMP]    = "stamp",
+	[TRACE_SUBMIT]   = "submit",
+	[TRACE_INFLIGHT] = "inflight",
+	[TRACE_DELIVER]  = "deliver",
+};
+
+static struct {
+	int         sample;
+	char        file[256];
+	const char *mode;
+	trace_span *spans;
+	atomic_int  next;
+	atomic_int  dropped;
+} trace;
+
+int
+nnb_trace_init(int sample, const char *file, const char *mode)
+{
+	if (sample <= 0) {
+		return (0);
+	}
+	if ((trace.spans = nng_alloc(sizeof(trace_span) * NNB_TRACE_MAX)) ==
+	    NULL) {
+		return (NNG_ENOMEM);
+	}
+	memset(trace.spans, 0, sizeof(trace_span) * NNB_TRACE_MAX);
+	trace.sample = sample;
+	trace.mode   = mode;
+	if (file != NULL) {
+		snprintf(trace.file, sizeof(trace.file), "%s", file);
+	} else {
+		snprintf(trace.file, sizeof(trace.file),
+		    "nano_bench_%s_trace.json", mode);
+	}
+	return (0);
+}
+
+bool
+nnb_trace_sampled(uint64_t seq)
+{
+	return (trace.sample > 0 && seq % trace.sample == 0);
+}
+
+static int
+trace_reserve(uint32_t pub_id, uint64_t seq, bool deliver)
+{
+	int i = atomic_fetch_add_explicit(&trace.next, 1, memory_order_relaxed);
+
+	if (i >= NNB_TRACE_MAX) {
+		++trace.dropped;
+		return (-1);
+	}
+	trace.spans[i].deliver = deliver;
+	trace.spans[i].pub_id  = pub_id;
+	trace.spans[i].seq     = seq;
+	return (i);
+}
+
+int
+nnb_trace_pub(uint32_t pub_id, uint64_t seq)
+{
+	if (trace.spans == NULL) {
+		return (-1);
+	}
+	return (trace_reserve(pub_id, seq, false));
+}
+
+void
+nnb_trace_mark_set(int span, nnb_trace_mark mark)
+{
+	if (span >= 0) {
+		atomic_store_explicit(&trace.spans[span].mark[mark],
+		    nnb_realtime_us(), memory_order_relaxed);
+	}
+}
+
+void
+nnb_trace_deliver(
+    uint32_t pub_id, uint64_t seq, uint64_t sent_us, uint64_t now_us)
+{
+	int i;
+
+	if (trace.spans == NULL || (i = trace_reserve(pub_id, seq, true)) < 0) {
+		return;
+	}
+	atomic_store_explicit(
+	    &trace.spans[i].mark[MARK_START], sent_us, memory_order_relaxed);
+	atomic_store_explicit(&trace.spans[i].mark[MARK_COMPLETED], now_us,
+	    memory_order_relaxed);
+}
+
+// Stage interval of a span, false while it is still incomplete.
+static bool
+trace_stage(trace_span *s, nnb_trace_stage stage, uint64_t *from,
+    uint64_t *to)
+{
+	uint64_t m[MARK_MAX];
+
+	for (int i = 0; i < MARK_MAX; i++) {
+		m[i] = atomic_load_explicit(&s->mark[i], memory_order_relaxed);
+	}
+	if (s->deliver) {
+		if (stage != TRACE_DELIVER) {
+			return (false);
+		}
+		*from = m[MARK_START];
+		*to   = m[MARK_COMPLETED];
+	} else {
+		switch (stage) {
+		case TRACE_RENDER:
+		case TRACE_STAMP:
+		case TRACE_SUBMIT:
+			*from = m[stage];
+			*to   = m[stage + 1];
+			break;
+		case TRACE_INFLIGHT:
+			// the aio may complete before nng_ctx_send returns
+			*from = m[MARK_STAMPED];
+			*to   = m[MARK_COMPLETED];
+			break;
+		default:
+			return (false);
+		}
+	}
+	if (*from == 0 || *to == 0) {
+		return (false);
+	}
+	if (*to < *from) {
+		*to = *from;
+	}
+	return (true);
+}
+
+static void
+trace_write(int n)
+{
+	FILE *f;
+
+	if ((f = fopen(trace.file, "w")) == NULL) {
+		log_warn("cannot write trace file %s", trace.file);
+		return;
+	}
+	fprintf(f,
+	    "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+	    "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+	    "\"args\":{\"name\":\"nano_bench %s\"}}",
+	    (int) getpid(), trace.mode);
+	for (int i = 0; i < n; i++) {
+		trace_span *s = &trace.spans[i];
+		for (int st = 0; st < TRACE_STAGES; st++) {
+			uint64_t from, to;
+			if (!trace_stage(s, st, &from, &to)) {
+				continue;
+			}
+			fprintf(f,
+			    ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,"
+			    "\"dur\":%llu,\"pid\":%d,\"tid\":%u,"
+			    "\"args\":{\"seq\":%llu}}",
+			    stage_names[st], (unsigned long long) from,
+			    (unsigned long long) (to - from), (int) getpid(),
+			    s->pub_id, (unsigned long long) s->seq);
+		}
+	}
+	fprintf(f, "\n]}\n");
+	fclose(f);
+	printf("trace: written to %s\n", trace.file);
+}
+
+void
+nnb_trace_report(void)
+{
+	nnb_hist hist[TRACE_STAGES];
+	int      n;
+
+	if (trace.spans == NULL) {
+		return;
+	}
+	n = trace.next < NNB_TRACE_MAX ? trace.next : NNB_TRACE_MAX;
+	for (int st = 0; st < TRACE_STAGES; st++) {
+		nnb_hist_init(&hist[st]);
+	}
+	for (int i = 0; i < n; i++) {
+		for (int st = 0; st < TRACE_STAGES; st++) {
+			uint64_t from, to;
+			if (trace_stage(&trace.spans[i], st, &from, &to)) {
+				nnb_hist_add(&hist[st], to - from);
+			}
+		}
+	}
+	printf("trace: 1 in %d sampled, %d spans, %d dropped\n",
+	    trace.sample, n, (int) trace.dropped);
+	for (int st = 0; st < TRACE_STAGES; st++) {
+		if (nnb_hist_total(&hist[st]) > 0) {
+			nnb_hist_summary(&hist[st], stage_names[st], "usec");
+		}
+	}
+	trace_write(n);
+}
@@ -0,0 +1,55 @@
+#ifndef NNB_TRACE_H
+#define NNB_TRACE_H
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sampled per-stage tracing of the publish path. Every --trace'th
+// publish (by stamp sequence, so publishers and subscribers sample the
+// same messages) gets a span of nnb_realtime_us() marks:
+//
+//   render   the frame template copied at the drawn size and the topic
+//            leaf written into it
+//   stamp    stamp and --crc seal written over the payload
+//   submit   time spent inside nng_ctx_send
+//   inflight submit to aio completion: written for QoS 0, PUBACK or
+//            PUBCOMP for QoS 1/2
+//   deliver  stamp time to subscriber delivery (subscriber side)
+//
+// Spans live in a fixed array reserved with one atomic add; stage
+// histograms and the Chrome trace are built from it after the run.
+typedef enum {
+	TRACE_RENDER,
+	TRACE_STAMP,
+	TRACE_SUBMIT,
+	TRACE_INFLIGHT,
+	TRACE_DELIVER,
+	TRACE_STAGES,
+} nnb_trace_stage;
+
+#define NNB_TRACE_MAX 65536 // spans kept, later samples are dropped
+
+// Marks for a publish span, indexed by the stage they begin.
+typedef enum {
+	MARK_START,
+	MARK_RENDERED,
+	MARK_STAMPED,
+	MARK_SUBMITTED,
+	MARK_COMPLETED,
+	MARK_MAX,
+} nnb_trace_mark;
+
+// sample 0 disables tracing. file NULL picks nano_bench_<mode>_trace.json.
+int  nnb_trace_init(int sample, const char *file, const char *mode);
+bool nnb_trace_sampled(uint64_t seq);
+
+// Reserves a publish span, returns -1 when tracing is off or full.
+int  nnb_trace_pub(uint32_t pub_id, uint64_t seq);
+void nnb_trace_mark_set(int span, nnb_trace_mark mark);
+
+void nnb_trace_deliver(
+    uint32_t pub_id, uint64_t seq, uint64_t sent_us, uint64_t now_us);
+
+// Prints per-stage summaries and writes the Chrome trace JSON.
+void nnb_trace_report(void);
+
+#endif
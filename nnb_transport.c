@@ -0,0 +1,369 @@
+#include "nnb_transport.h"
+#include "dbg.h"
+#include "nnb_bench.h"
+#include "nnb_hist.h"
+#include "nnb_payload.h"
+#include "nnb_proc.h"
+#include "nnb_pump.h"
+#include "nnb_util.h"
+#include <limits.h>
+#include <stdatomic.h>
+
+#define XPORT_PARALLEL 4
+#define XPORT_WINDOW 64 // in-flight publishes per publisher
+#define XPORT_MAX 16
+#define XPORT_ID_LEN 64
+#define XPORT_DRAIN 2000 // ms to wait for the window to be delivered
+
+typedef struct xport_client xport_client;
+
+typedef struct {
+	nng_aio *     aio;
+	nng_ctx       ctx;
+	xport_client *client;
+	bool          subscribe; // completion is for the SUBSCRIBE
+} xport_work;
+
+struct xport_client {
+	nng_socket sock;
+	xport_work works[XPORT_PARALLEL];
+};
+
+typedef struct {
+	char        name[8];
+	int         port;
+	bool        ok; // subscribers came up and messages flowed
+	char        url[255];
+	double      sent;      // publishes completed per second
+	double      delivered; // per subscriber per second
+	double      loss;      // percent of the window not delivered
+	double      cpu;       // bench usec per published message
+	uint64_t    p50, p99, p999; // usec
+} xport_result;
+
+static struct {
+	nnb_transport_opt *opt;
+	xport_client *     clients;
+	nnb_pump           pump;
+	uint8_t *          payload;
+	atomic_int         subacked;
+	// messages n with win_lo <= n < win_hi are measured
+	atomic_llong win_lo;
+	atomic_llong win_hi;
+	atomic_llong recv;
+	nnb_hist     hist; // stamp to delivery, usec
+	xport_result results[XPORT_MAX];
+	int          nresults;
+} xport;
+
+static void
+xport_cb(void *arg)
+{
+	xport_work *w = arg;
+	nng_msg *   msg;
+	nnb_stamp   st;
+	uint8_t *   payload;
+	uint32_t    len;
+	int         rv;
+
+	if ((rv = nng_aio_result(w->aio)) != 0) {
+		if (rv == NNG_ECLOSED || rv == NNG_ECANCELED) {
+			return;
+		}
+		nng_fatal("xport_cb", rv);
+		nng_ctx_recv(w->ctx, w->aio);
+		return;
+	}
+	msg = nng_aio_get_msg(w->aio);
+	nng_aio_set_msg(w->aio, NULL);
+	if (w->subscribe) {
+		w->subscribe = false;
+		++xport.subacked;
+	} else if (msg != NULL) {
+		payload = nng_mqtt_msg_get_publish_payload(msg, &len);
+		if (nnb_stamp_read(payload, len, &st) &&
+		    (long long) st.seq >= xport.win_lo &&
+		    (long long) st.seq < xport.win_hi) {
+			++xport.recv;
+			nnb_hist_add(
+			    &xport.hist, nnb_realtime_us() - st.ts_us);
+		}
+	}
+	if (msg != NULL) {
+		nng_msg_free(msg);
+	}
+	nng_ctx_recv(w->ctx, w->aio);
+}
+
+static void
+xport_connect(xport_client *c, int index, int port, tls_opt *tls)
+{
+	nnb_transport_opt *opt = xport.opt;
+	nng_msg *          msg;
+	char               id[XPORT_ID_LEN];
+	int                rv;
+
+	if ((rv = nnb_client_open(&c->sock, opt->host, port, tls)) != 0) {
+		nng_fatal("nng_socket", rv);
+		return;
+	}
+	for (int i = 0; i < XPORT_PARALLEL; i++) {
+		xport_work *w = &c->works[i];
+		w->client     = c;
+		if ((rv = nng_aio_alloc(&w->aio, xport_cb, w)) != 0) {
+			nng_fatal("nng_aio_alloc", rv);
+		}
+		if ((rv = nng_ctx_open(&w->ctx, c->sock)) != 0) {
+			nng_fatal("nng_ctx_open", rv);
+		}
+	}
+
+	msg = nnb_connect_msg(
+	    opt->keepalive, true, opt->username, opt->password);
+	snprintf(id, sizeof(id), "nnb_transport_%d", index);
+	nng_mqtt_msg_set_connect_client_id(msg, id);
+	nnb_dial(c->sock, opt->host, port, tls, msg);
+
+	nng_mqtt_topic_qos topic_qos[] = {
+		{ .qos     = opt->qos,
+		    .topic = { .buf = (uint8_t *) opt->topic,
+		        .length     = strlen(opt->topic) } },
+	};
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_SUBSCRIBE);
+	nng_mqtt_msg_set_subscribe_topics(msg, topic_qos, 1);
+	c->works[0].subscribe = true;
+	nng_aio_set_msg(c->works[0].aio, msg);
+	nng_ctx_send(c->works[0].ctx, c->works[0].aio);
+	for (int i = 1; i < XPORT_PARALLEL; i++) {
+		nng_ctx_recv(c->works[i].ctx, c->works[i].aio);
+	}
+}
+
+static void
+xport_close(xport_client *c)
+{
+	nng_close(c->sock);
+	for (int i = 0; i < XPORT_PARALLEL; i++) {
+		nng_aio_free(c->works[i].aio);
+	}
+	memset(c, 0, sizeof(*c));
+}
+
+// Message n carries a stamp with seq n, written into the encoded body.
+static nng_msg *
+xport_make(uint64_t n, void *arg)
+{
+	nnb_transport_opt *opt = arg;
+	nng_msg *          msg;
+	nnb_stamp          st = { .pub_id = 0, .seq = n };
+
+	nng_mqtt_msg_alloc(&msg, 0);
+	nng_mqtt_msg_set_packet_type(msg, NNG_MQTT_PUBLISH);
+	nng_mqtt_msg_set_publish_topic(msg, opt->topic);
+	nng_mqtt_msg_set_publish_qos(msg, opt->qos);
+	nng_mqtt_msg_set_publish_payload(msg, xport.payload, opt->size);
+	nng_mqtt_msg_encode(msg);
+	st.ts_us = nnb_realtime_us();
+	nnb_stamp_write(
+	    (uint8_t *) nng_msg_body(msg) + nng_msg_len(msg) - opt->size,
+	    &st);
+	return (msg);
+}
+
+// Transport settings for name: TLS, websocket and QUIC flags on a copy
+// of the shared certificates, and the listener port.
+static int
+xport_select(const char *name, size_t len, tls_opt *tls)
+{
+	nnb_transport_opt *opt = xport.opt;
+
+	*tls      = opt->tls;
+	tls->quic = false;
+	if (len == 4 && !strncmp(name, "quic", len)) {
+		tls->quic = true;
+		return (opt->quic_port);
+	} else if (len == 3 && !strncmp(name, "tcp", len)) {
+		tls->enable = false;
+		tls->ws     = false;
+		return (opt->tcp_port);
+	} else if (len == 3 && !strncmp(name, "tls", len)) {
+		tls->enable = true;
+		tls->ws     = false;
+		return (opt->tls_port);
+	} else if (len == 2 && !strncmp(name, "ws", len)) {
+		tls->enable = false;
+		tls->ws     = true;
+		return (opt->ws_port);
+	}
+	tls->enable = true;
+	tls->ws     = true;
+	return (opt->wss_port);
+}
+
+static void
+xport_measure(xport_result *r, tls_opt *tls)
+{
+	nnb_transport_opt *opt = xport.opt;
+	nnb_pump_cfg       cfg;
+	nnb_proc_stat      p0, p1;
+	long long          lo, hi, expect;
+	uint64_t           acked;
+	uint64_t           t0, us;
+
+	nnb_dial_url(r->url, sizeof(r->url), opt->host, r->port, tls);
+	printf("%s: %s\n", r->name, r->url);
+
+	xport.subacked = 0;
+	xport.win_lo   = 0;
+	xport.win_hi   = 0;
+	for (int i = 0; i < opt->subscribers; i++) {
+		xport_connect(
+		    &xport.clients[i], opt->startnumber + i, r->port, tls);
+		nng_msleep(opt->interval);
+	}
+	if (!nnb_wait(&xport.subacked, opt->subscribers, "subscribed",
+	        opt->timeout)) {
+		log_warn("%s: subscribers did not come up, skipped", r->name);
+		goto out;
+	}
+
+	cfg = (nnb_pump_cfg) {
+		.host      = opt->host,
+		.port      = r->port,
+		.tls       = tls,
+		.keepalive = opt->keepalive,
+		.username  = opt->username,
+		.password  = opt->password,
+		.id_prefix = "nnb_transport_pub_",
+		.clients   = opt->count,
+		.window    = XPORT_WINDOW,
+		.total     = 0,
+		.rate      = opt->rate,
+		.make      = xport_make,
+		.arg       = opt,
+	};
+	if (nnb_pump_start(&xport.pump, &cfg) != 0) {
+		goto out;
+	}
+	nng_msleep(opt->warmup * 1000);
+
+	nnb_hist_init(&xport.hist);
+	xport.recv   = 0;
+	lo           = xport.pump.next;
+	acked        = xport.pump.acked;
+	xport.win_lo = lo;
+	xport.win_hi = LLONG_MAX;
+	nnb_proc_sample(0, &p0);
+	t0 = nnb_clock_us();
+	nng_msleep(opt->duration * 1000);
+	hi           = xport.pump.next;
+	xport.win_hi = hi;
+	us           = nnb_clock_us() - t0;
+	nnb_proc_sample(0, &p1);
+	acked   = xport.pump.acked - acked;
+	r->sent = acked * 1e6 / us;
+	r->cpu  = acked > 0 ? (double) (p1.cpu_us - p0.cpu_us) / acked : 0;
+
+	expect = (hi - lo) * opt->subscribers;
+	for (int i = 0; i < XPORT_DRAIN / 10 && xport.recv < expect; i++) {
+		nng_msleep(10);
+	}
+	nnb_pump_stop(&xport.pump);
+
+	r->delivered = (double) xport.recv / opt->subscribers * 1e6 / us;
+	r->loss      = expect ? 100.0 * (expect - xport.recv) / expect : 0;
+	if (r->loss < 0) {
+		r->loss = 0;
+	}
+	r->p50  = nnb_hist_percentile(&xport.hist, 50);
+	r->p99  = nnb_hist_percentile(&xport.hist, 99);
+	r->p999 = nnb_hist_percentile(&xport.hist, 99.9);
+	r->ok   = xport.recv > 0;
+
+	printf("%s: sent=%.0f(msg/sec), delivered=%.0f(msg/sec), "
+	       "p50=%.2fms, p99=%.2fms, loss=%.3f%%, cpu=%.2fus/msg\n",
+	    r->name, r->sent, r->delivered, r->p50 / 1e3, r->p99 / 1e3,
+	    r->loss, r->cpu);
+
+out:
+	for (int i = 0; i < opt->subscribers; i++) {
+		xport_close(&xport.clients[i]);
+	}
+}
+
+// One row per transport; the last two columns are relative to the first
+// transport measured, normally tcp, and show the framing overhead.
+static void
+xport_report(void)
+{
+	nnb_transport_opt *opt  = xport.opt;
+	xport_result *     base = NULL;
+
+	printf("\n%d publishers, %d subscribers, qos %d, %d bytes, ",
+	    opt->count, opt->subscribers, opt->qos, opt->size);
+	if (opt->rate > 0) {
+		printf("%d(msg/sec) offered\n", opt->rate);
+	} else {
+		printf("unpaced\n");
+	}
+	printf("transport   port       sent  delivered   p50(ms)   p99(ms)  "
+	       "p999(ms)   loss(%%)  cpu(us/msg)  +cpu(%%)  +p50(%%)\n");
+	for (int i = 0; i < xport.nresults; i++) {
+		xport_result *r = &xport.results[i];
+		if (!r->ok) {
+			printf("%-9s  %5d  unreachable or nothing delivered\n",
+			    r->name, r->port);
+			continue;
+		}
+		if (base == NULL) {
+			base = r;
+		}
+		printf("%-9s  %5d  %9.0f  %9.0f  %8.2f  %8.2f  %8.2f  %8.3f  "
+		       "%11.2f  %7.1f  %7.1f\n",
+		    r->name, r->port, r->sent, r->delivered, r->p50 / 1e3,
+		    r->p99 / 1e3, r->p999 / 1e3, r->loss, r->cpu,
+		    base->cpu > 0 ? 100.0 * (r->cpu - base->cpu) / base->cpu
+		                  : 0,
+		    base->p50 > 0 ? 100.0 * ((double) r->p50 - base->p50) /
+		            base->p50
+		                  : 0);
+	}
+}
+
+int
+nnb_transport_run(nnb_transport_opt *opt)
+{
+	const char *p;
+	size_t      len;
+	tls_opt     tls;
+	int         rv = 0;
+
+	xport.opt     = opt;
+	xport.clients = nng_alloc(sizeof(xport_client) * opt->subscribers);
+	xport.payload = nng_alloc(opt->size);
+	if (xport.clients == NULL || xport.payload == NULL) {
+		nng_fatal("nng_alloc", NNG_ENOMEM);
+		return (NNG_ENOMEM);
+	}
+	memset(xport.clients, 0, sizeof(xport_client) * opt->subscribers);
+	memset(xport.payload, 'A', opt->size);
+
+	for (p = opt->transports; *p != '\0' && xport.nresults < XPORT_MAX &&
+	     !nnb_stopped();
+	     p += len + (p[len] == ',')) {
+		xport_result *r = &xport.results[xport.nresults++];
+
+		len = strcspn(p, ",");
+		memset(r, 0, sizeof(*r));
+		snprintf(r->name, sizeof(r->name), "%.*s", (int) len, p);
+		r->port = xport_select(p, len, &tls);
+		xport_measure(r, &tls);
+		if (!r->ok) {
+			rv = NNG_ETIMEDOUT;
+		}
+	}
+
+	xport_report();
+	return (rv);
+}
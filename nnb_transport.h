@@ -0,0 +1,12 @@
+#ifndef NNB_TRANSPORT_H
+#define NNB_TRANSPORT_H
+#include "nnb_opt.h"
+
+// Transport comparison: the same paced, stamped publish workload and
+// in-process subscribers run over each of tcp, tls, ws and wss in turn,
+// each against its own listener port. Prints throughput, delivery
+// latency and the bench's own CPU per published message per transport.
+// Returns 0 when every transport was measured.
+int nnb_transport_run(nnb_transport_opt *opt);
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef NNB_UTIL_H
+#define NNB_UTIL_H
+#include <math.h>
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic clock in microseconds, for intervals measured inside one
+// process. nng_clock() only has millisecond resolution.
+static inline uint64_t
+nnb_clock_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+// Wall clock in microseconds, for timestamps compared across processes
+// (publisher and subscriber are usually separate bench runs on one host).
+static inline uint64_t
+nnb_realtime_us(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+// xorshift64* generator. Each caller owns its state so no locking is
+// needed on the send path; the state must never be zero.
+static inline uint64_t
+nnb_rand(uint64_t *state)
+{
+	uint64_t x = *state;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*state = x;
+	return (x * 0x2545F4914F6CDD1DULL);
+}
+
+// Uniform double in [0, 1).
+static inline double
+nnb_rand_double(uint64_t *state)
+{
+	return ((nnb_rand(state) >> 11) * (1.0 / 9007199254740992.0));
+}
+
+// Standard normal deviate (Box-Muller).
+static inline double
+nnb_rand_normal(uint64_t *state)
+{
+	double u1 = 1.0 - nnb_rand_double(state);
+	double u2 = nnb_rand_double(state);
+	return (sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2));
+}
+
+#endif
@@ -0,0 +1,130 @@
+#include "nnb_wire.h"
+#include <nng/nng.h>
+#include <string.h>
+
+size_t
+nnb_wire_varint(uint8_t *p, size_t v)
+{
+	size_t n = 0;
+
+	do {
+		p[n] = v % 128;
+		v /= 128;
+		if (v > 0) {
+			p[n] |= 0x80;
+		}
+		n++;
+	} while (v > 0);
+	return (n);
+}
+
+static uint8_t *
+wire_str(uint8_t *p, const char *s, size_t len)
+{
+	p[0] = len >> 8;
+	p[1] = len & 0xff;
+	memcpy(p + 2, s, len);
+	return (p + 2 + len);
+}
+
+uint8_t *
+nnb_wire_connect(int version, int keepalive, bool clean, const char *id,
+    const char *username, const char *password, size_t *len)
+{
+	const char *name = version == 3 ? "MQIsdp" : "MQTT";
+	size_t      rem;
+	uint8_t     flags = clean ? 0x02 : 0;
+	uint8_t *   buf;
+	uint8_t *   p;
+
+	rem = 2 + strlen(name) + 1 + 1 + 2 + 2 + strlen(id);
+	if (version == 5) {
+		rem += 1; // empty properties
+	}
+	if (username != NULL) {
+		flags |= 0x80;
+		rem += 2 + strlen(username);
+	}
+	if (password != NULL) {
+		flags |= 0x40;
+		rem += 2 + strlen(password);
+	}
+	if ((buf = nng_alloc(rem + 5)) == NULL) {
+		return (NULL);
+	}
+	p    = buf;
+	*p++ = 0x10;
+	p += nnb_wire_varint(p, rem);
+	p    = wire_str(p, name, strlen(name));
+	*p++ = version;
+	*p++ = flags;
+	*p++ = keepalive >> 8;
+	*p++ = keepalive & 0xff;
+	if (version == 5) {
+		*p++ = 0;
+	}
+	p = wire_str(p, id, strlen(id));
+	if (username != NULL) {
+		p = wire_str(p, username, strlen(username));
+	}
+	if (password != NULL) {
+		p = wire_str(p, password, strlen(password));
+	}
+	*len = p - buf;
+	return (buf);
+}
+
+uint8_t *
+nnb_wire_publish(int version, const char *topic, int size, size_t *len)
+{
+	size_t   tlen = strlen(topic);
+	size_t   rem  = 2 + tlen + size;
+	uint8_t *buf;
+	uint8_t *p;
+
+	if (version == 5) {
+		rem += 1; // empty properties
+	}
+	if ((buf = nng_alloc(rem + 5)) == NULL) {
+		return (NULL);
+	}
+	p    = buf;
+	*p++ = 0x30;
+	p += nnb_wire_varint(p, rem);
+	p = wire_str(p, topic, tlen);
+	if (version == 5) {
+		*p++ = 0;
+	}
+	memset(p, 'A', size);
+	p += size;
+	*len = p - buf;
+	return (buf);
+}
+
+uint8_t *
+nnb_wire_subscribe(int version, const char *filter, int qos, size_t *len)
+{
+	size_t   flen = strlen(filter);
+	size_t   rem  = 2 + 2 + flen + 1;
+	uint8_t *buf;
+	uint8_t *p;
+
+	if (version == 5) {
+		rem += 1; // empty properties
+	}
+	if ((buf = nng_alloc(rem + 5)) == NULL) {
+		return (NULL);
+	}
+	p    = buf;
+	*p++ = 0x82;
+	p += nnb_wire_varint(p, rem);
+	*p++ = 0;
+	*p++ = 1;
+	if (version == 5) {
+		*p++ = 0;
+	}
+	p    = wire_str(p, filter, flen);
+	*p++ = qos;
+	*len = p - buf;
+	return (buf);
+}
@@ -0,0 +1,29 @@
+#ifndef NNB_WIRE_H
+#define NNB_WIRE_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hand-encoded MQTT packets for the modes that talk to the broker over
+// plain sockets instead of nng: blast and sub --raw. Buffers come from
+// nng_alloc and are sized exactly, *len bytes.
+
+// Remaining length varint at p, returns its size (1 to 4 bytes).
+size_t nnb_wire_varint(uint8_t *p, size_t v);
+
+// CONNECT for protocol level 3, 4 or 5, no will.
+uint8_t *nnb_wire_connect(int version, int keepalive, bool clean,
+    const char *id, const char *username, const char *password,
+    size_t *len);
+
+// QoS 0 PUBLISH of size 'A' bytes, so no packet id and no ack.
+uint8_t *nnb_wire_publish(
+    int version, const char *topic, int size, size_t *len);
+
+// SUBSCRIBE of one filter with packet id 1.
+uint8_t *nnb_wire_subscribe(
+    int version, const char *filter, int qos, size_t *len);
+
+#define NNB_WIRE_PINGREQ "\xc0\x00"
+
+#endif